@@ -0,0 +1,94 @@
+/**
+ *  CompletionQueue.cpp
+ *
+ *  Benchmark for handing completions from a worker thread over to the
+ *  event loop, with a task posted to the loop for every completion, and
+ *  through the completion queue that coalesces them.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+#include <iostream>
+
+/**
+ *  The number of completions to hand over
+ */
+static const size_t completions = 1000000;
+
+/**
+ *  Post every completion to the loop on its own
+ */
+struct Posted
+{
+    React::Worker *master;
+
+    template <typename F>
+    void operator()(F &&callback) { master->execute(callback); }
+};
+
+/**
+ *  Add every completion to the completion queue
+ */
+struct Queued
+{
+    React::MySQL::CompletionQueue *queue;
+
+    template <typename F>
+    void operator()(F &&callback) { queue->push(std::forward<F>(callback)); }
+};
+
+/**
+ *  Measure the number of completions per second that reach the loop
+ *
+ *  @param  loop        the event loop
+ *  @param  name        name of the measurement
+ *  @param  post        function to hand a completion over with
+ */
+template <typename Post>
+static void measure(React::MainLoop &loop, const char *name, Post post)
+{
+    // the number of completions that ran in the loop
+    size_t done = 0;
+
+    // the loop runs until the last completion is in
+    React::LoopReference reference(&loop);
+
+    // the moment we started
+    auto start = std::chrono::steady_clock::now();
+
+    // the worker thread hands the completions over as fast as it can
+    std::thread worker([&loop, &done, post]() mutable {
+        for (size_t i = 0; i < completions; ++i) post([&loop, &done]() { if (++done == completions) loop.stop(); });
+    });
+
+    // run the completions
+    loop.run();
+
+    // how long did it take?
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    worker.join();
+
+    // report
+    std::cout << name << ": " << (uint64_t)(completions / elapsed.count()) << " completions per second" << std::endl;
+}
+
+/**
+ *  Main procedure
+ */
+int main()
+{
+    // the loop, and the worker to post tasks to it
+    React::MainLoop loop;
+    React::Worker master(&loop);
+
+    // the completion queue that feeds the loop
+    React::MySQL::CompletionQueue queue(&master);
+
+    // hand the completions over in both ways
+    measure(loop, "worker execute  ", Posted{ &master });
+    measure(loop, "completion queue", Queued{ &queue });
+
+    // done
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ *  SubmissionQueue.cpp
+ *
+ *  Benchmark for running tasks in a worker thread, with a generic worker
+ *  and with the submission queue of a connection. It measures the cost
+ *  of submitting a task, and the round trip of a task that the submitter
+ *  waits for, in nanoseconds.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+#include <iostream>
+
+/**
+ *  The number of tasks to submit, and the number of round trips
+ */
+static const size_t tasks = 1000000;
+static const size_t trips = 100000;
+
+/**
+ *  Submit tasks to a generic worker
+ */
+struct Generic
+{
+    React::Worker *worker;
+
+    template <typename F>
+    void operator()(F &&callable) { worker->execute(callable); }
+};
+
+/**
+ *  Submit tasks to the submission queue
+ */
+struct Queued
+{
+    React::MySQL::SubmissionQueue *queue;
+
+    template <typename F>
+    void operator()(F &&callable) { queue->execute(std::forward<F>(callable)); }
+};
+
+/**
+ *  The number of nanoseconds since a moment, per operation
+ *
+ *  @param  start       the moment
+ *  @param  count       the number of operations
+ */
+static uint64_t nanoseconds(std::chrono::steady_clock::time_point start, size_t count)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+/**
+ *  Measure the cost of submitting, and the round trip
+ *
+ *  @param  name        name of the measurement
+ *  @param  submit      function to submit a task with
+ */
+template <typename Submit>
+static void measure(const char *name, Submit submit)
+{
+    // the number of tasks that ran, and whether the last one did
+    size_t done = 0;
+    std::atomic<bool> finished(false);
+
+    // submit all tasks at once, the worker runs them in the meantime
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tasks; ++i) submit([&done]() { ++done; });
+    auto submitted = nanoseconds(start, tasks);
+
+    // wait for the worker to catch up
+    submit([&finished]() { finished.store(true, std::memory_order_release); });
+    while (!finished.load(std::memory_order_acquire)) std::this_thread::yield();
+
+    // now submit tasks one at a time, and wait for each of them
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trips; ++i)
+    {
+        finished.store(false, std::memory_order_relaxed);
+        submit([&finished]() { finished.store(true, std::memory_order_release); });
+        while (!finished.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+    auto trip = nanoseconds(start, trips);
+
+    // report
+    std::cout << name << ": " << submitted << "ns per execute(), " << trip << "ns per round trip" << std::endl;
+}
+
+/**
+ *  Main procedure
+ */
+int main()
+{
+    // a generic worker with a thread of its own
+    React::Worker worker;
+    measure("worker execute  ", Generic{ &worker });
+
+    // the submission queue of a connection
+    React::MySQL::SubmissionQueue queue;
+    measure("submission queue", Queued{ &queue });
+
+    // done
+    return 0;
+}
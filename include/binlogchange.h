@@ -0,0 +1,114 @@
+/**
+ *  BinlogChange.h
+ *
+ *  A change that was read from the binary log of a server: the rows of
+ *  a table that a committed transaction inserted, updated or deleted,
+ *  or a statement that was logged as text.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Binlog change class
+ */
+class BinlogChange
+{
+public:
+    /**
+     *  The kind of change
+     */
+    enum Type
+    {
+        inserted,       // rows were inserted
+        updated,        // rows were updated
+        deleted,        // rows were deleted
+        statement,      // a statement was logged, for example a schema change
+        unknown         // something changed that could not be decoded
+    };
+
+private:
+    /**
+     *  The kind of change
+     */
+    Type _type;
+
+    /**
+     *  The database and the table that changed
+     */
+    std::string _database;
+    std::string _table;
+
+    /**
+     *  The number of rows that changed
+     */
+    size_t _rows;
+
+    /**
+     *  The statement that was logged
+     */
+    std::string _query;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  type        the kind of change
+     *  @param  database    the database that changed
+     *  @param  table       the table that changed
+     *  @param  rows        the number of rows that changed
+     *  @param  query       the statement that was logged
+     */
+    BinlogChange(Type type, std::string database, std::string table, size_t rows, std::string query = std::string()) :
+        _type(type),
+        _database(std::move(database)),
+        _table(std::move(table)),
+        _rows(rows),
+        _query(std::move(query)) {}
+
+    /**
+     *  The kind of change
+     */
+    Type type() const { return _type; }
+
+    /**
+     *  The database that changed
+     *
+     *  For statements this is the default database of the statement,
+     *  the statement itself may change other databases.
+     */
+    const std::string& database() const { return _database; }
+
+    /**
+     *  The table that changed, empty for statements and unknown changes
+     */
+    const std::string& table() const { return _table; }
+
+    /**
+     *  The number of rows that changed
+     *
+     *  This is zero when the rows could not be counted.
+     */
+    size_t rows() const { return _rows; }
+
+    /**
+     *  The statement that was logged, for statement changes
+     */
+    const std::string& query() const { return _query; }
+
+    /**
+     *  Add the rows of another change to the same table
+     *
+     *  @param  rows        the number of rows
+     */
+    void add(size_t rows) { _rows += rows; }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,219 @@
+/**
+ *  BinlogReader.h
+ *
+ *  Class that connects to a server as a replica, and reads the changes
+ *  from its binary log as they are committed. This can be used to keep
+ *  the results in a cache up to date with the writes of other clients.
+ *
+ *  The server should log rows (binlog_format=ROW), and the user needs
+ *  the REPLICATION SLAVE and REPLICATION CLIENT privileges.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class CompletionQueue;
+class SubmissionQueue;
+class InFlight;
+class InFlightCounter;
+
+/**
+ *  Binlog reader class
+ */
+class BinlogReader
+{
+private:
+    /**
+     *  The address of the server, and the user to connect as
+     */
+    std::string _hostname;
+    std::string _username;
+    std::string _password;
+
+    /**
+     *  The id to register with, which should differ from the id
+     *  of the server and that of every other replica
+     */
+    uint32_t _server;
+
+    /**
+     *  The tables to report, by database
+     */
+    std::set<std::pair<std::string, std::string>> _selection;
+
+    /**
+     *  Callback to execute with the changes
+     */
+    std::function<void(std::vector<BinlogChange>&& changes, const std::string& file, uint64_t position)> _changesCallback;
+
+    /**
+     *  Callback to execute on failure
+     */
+    std::function<void(const char *error)> _failureCallback;
+
+    /**
+     *  Is the reader running?
+     */
+    bool _running = false;
+
+    /**
+     *  Should the worker stop reading?
+     */
+    std::shared_ptr<std::atomic<bool>> _stop;
+
+    /**
+     *  The socket the worker is reading the log from, or -1 when it is
+     *  not connected, and the lock to protect it. It is shut down to
+     *  interrupt the worker when it is waiting for the next event.
+     */
+    std::mutex _lock;
+    int _socket = -1;
+
+    /**
+     *  Worker for main thread
+     */
+    Worker _master;
+
+    /**
+     *  The callbacks waiting for the master thread
+     */
+    std::unique_ptr<CompletionQueue> _completions;
+
+    /**
+     *  The operations in flight, to keep the loop alive
+     */
+    std::unique_ptr<InFlightCounter> _inflight;
+
+    /**
+     *  The worker reading the log, with its queue
+     */
+    std::unique_ptr<SubmissionQueue> _worker;
+
+    /**
+     *  Execute a callback in the master thread
+     *
+     *  @param  callback    the callback to execute
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     */
+    void deliver(const std::function<void()>& callback);
+
+    /**
+     *  Read the log until we are stopped
+     *
+     *  @param  reference   the token that keeps the loop alive
+     *  @param  stop        the flag that tells us to stop
+     *  @param  file        the log file to start in
+     *  @param  position    the position to start at
+     *  @param  heartbeat   the interval of the heartbeats, in seconds
+     *  @return the error, or an empty string when we were stopped
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     */
+    std::string read(const InFlight& reference, const std::atomic<bool> &stop, std::string file, uint64_t position, double heartbeat);
+
+public:
+    /**
+     *  Constructor
+     *
+     *  The hostname may include a port ("127.0.0.1:3307"), or be the
+     *  path to a unix socket. The reader connects when it is started.
+     *
+     *  @param  loop        the loop to deliver the changes to
+     *  @param  hostname    the hostname to connect to
+     *  @param  username    the username to login with
+     *  @param  password    the password to authenticate with
+     *  @param  server      the id to register as a replica with
+     *  @param  initialize  do we need to initialize (and cleanup) the mysql library
+     */
+    BinlogReader(Loop *loop, const std::string& hostname, const std::string &username, const std::string& password, uint32_t server, bool initialize = true);
+
+    /**
+     *  Binlog readers cannot be copied
+     */
+    BinlogReader(const BinlogReader& that) = delete;
+
+    /**
+     *  Destructor
+     *
+     *  A reader that is still running is stopped.
+     */
+    virtual ~BinlogReader();
+
+    /**
+     *  Report the changes to a table
+     *
+     *  When no tables are added, the changes to all tables are reported.
+     *  Statements, like schema changes, are reported for every database
+     *  of which tables are reported.
+     *
+     *  @param  database    the database
+     *  @param  table       the table, or empty for all tables in the database
+     *  @throws Exception   when the reader already started
+     */
+    BinlogReader& add(const std::string& database, const std::string& table = std::string());
+
+    /**
+     *  Start reading the log
+     *
+     *  Without a file, the reader starts at the end of the log, and only
+     *  reports changes that are committed from now on. To continue where
+     *  a previous reader left off, pass the file and the position that
+     *  came with the last changes it reported.
+     *
+     *  The server sends a heartbeat when nothing was logged for a while,
+     *  which is also how long it may take for the reader to stop.
+     *
+     *  @param  file        the log file to start in
+     *  @param  position    the position to start at
+     *  @param  heartbeat   the interval of the heartbeats, in seconds
+     *  @throws Exception   when the reader already started
+     */
+    void start(const std::string& file = std::string(), uint64_t position = 4, double heartbeat = 1.0);
+
+    /**
+     *  Stop reading the log
+     *
+     *  Changes that were already read may still be reported.
+     */
+    void stop();
+
+    /**
+     *  Is the reader running?
+     */
+    bool running() const { return _running; }
+
+    /**
+     *  Get a call with the changes of the transactions that committed
+     *
+     *  The changes of every transaction are reported together, possibly
+     *  together with those of other transactions, in the order in which
+     *  they committed. The file and the position are where to continue
+     *  reading after these changes.
+     *
+     *  @param  callback    the callback to execute with the changes
+     */
+    BinlogReader& onChanges(const std::function<void(std::vector<BinlogChange>&& changes, const std::string& file, uint64_t position)>& callback);
+
+    /**
+     *  Get a call when the reader fails
+     *
+     *  The reader is no longer running when this is called, and can be
+     *  started again.
+     *
+     *  @param  callback    the callback to execute on failure
+     */
+    BinlogReader& onFailure(const std::function<void(const char *error)>& callback);
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -60,6 +60,7 @@ public:
      *  double              DOUBLE
      *  std::string         TEXT, CHAR or VARCHAR
      *  std::vector<char>   BLOB, BINARY or VARBINARY
+     *  LongData            BLOB or TEXT, streamed to the server in chunks
      *  std::nullptr_t      NULL
      *
      *  @param  mixed...    variable number of arguments of different type
@@ -71,6 +72,20 @@ public:
         // pass to implementation
         return _statement->execute(std::forward<Arguments>(parameters)...);
     }
+
+    /**
+     *  Execute the statement, and stream one of the columns to a sink
+     *
+     *  @param  column      name of the column to stream
+     *  @param  sink        the sink to pass the column data to
+     *  @param  mixed...    variable number of arguments of different type
+     */
+    template <class ...Arguments>
+    Deferred& stream(const std::string& column, const std::shared_ptr<ColumnSink>& sink, Arguments ...parameters)
+    {
+        // pass to implementation
+        return _statement->stream(column, sink, std::forward<Arguments>(parameters)...);
+    }
 };
 
 /**
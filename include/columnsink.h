@@ -0,0 +1,147 @@
+/**
+ *  ColumnSink.h
+ *
+ *  Destination for a column that is streamed from a prepared
+ *  statement result in chunks, instead of being materialized.
+ *
+ *  Note that the sinks are called from the worker thread, not
+ *  from the thread running the event loop.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Column sink base class
+ */
+class ColumnSink
+{
+private:
+    /**
+     *  The number of bytes to read at once
+     */
+    size_t _chunk;
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  chunk   the number of bytes to read at once
+     */
+    ColumnSink(size_t chunk = 65536) : _chunk(chunk) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~ColumnSink() {}
+
+    /**
+     *  The number of bytes to read at once
+     */
+    size_t chunk() const
+    {
+        return _chunk;
+    }
+
+    /**
+     *  Receive a chunk of data
+     *
+     *  @param  row     index of the row the data belongs to
+     *  @param  buffer  the data
+     *  @param  size    the number of bytes in the buffer
+     *  @return should the rest of the value be streamed too?
+     */
+    virtual bool data(size_t row, const char *buffer, size_t size) = 0;
+
+    /**
+     *  The complete value of a row was passed
+     *
+     *  This is not called for NULL values, nor for values of which
+     *  the sink did not want the rest.
+     *
+     *  @param  row     index of the row
+     */
+    virtual void end(size_t) {}
+};
+
+/**
+ *  Sink writing the data to a file descriptor
+ */
+class DescriptorSink : public ColumnSink
+{
+private:
+    /**
+     *  The file descriptor to write to
+     */
+    int _fd;
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  fd      the file descriptor to write to
+     *  @param  chunk   the number of bytes to read at once
+     */
+    DescriptorSink(int fd, size_t chunk = 65536) : ColumnSink(chunk), _fd(fd) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~DescriptorSink() {}
+
+    /**
+     *  Receive a chunk of data
+     *
+     *  @param  row     index of the row the data belongs to
+     *  @param  buffer  the data
+     *  @param  size    the number of bytes in the buffer
+     *  @return should the rest of the value be streamed too?
+     */
+    virtual bool data(size_t row, const char *buffer, size_t size) override;
+};
+
+/**
+ *  Sink passing the data to a callback
+ */
+class CallbackSink : public ColumnSink
+{
+private:
+    /**
+     *  The callback to pass the data to
+     */
+    std::function<bool(size_t row, const char *buffer, size_t size)> _callback;
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  callback    the callback to pass the data to
+     *  @param  chunk       the number of bytes to read at once
+     */
+    CallbackSink(const std::function<bool(size_t row, const char *buffer, size_t size)>& callback, size_t chunk = 65536) :
+        ColumnSink(chunk), _callback(callback) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~CallbackSink() {}
+
+    /**
+     *  Receive a chunk of data
+     *
+     *  @param  row     index of the row the data belongs to
+     *  @param  buffer  the data
+     *  @param  size    the number of bytes in the buffer
+     *  @return should the rest of the value be streamed too?
+     */
+    virtual bool data(size_t row, const char *buffer, size_t size) override
+    {
+        return _callback(row, buffer, size);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
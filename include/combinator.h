@@ -0,0 +1,266 @@
+/**
+ *  Combinator.h
+ *
+ *  Base class for objects that wait for the outcome of several
+ *  deferred handlers at once, possibly from different connections.
+ *
+ *  The combinator, the bookkeeping for every deferred handler and
+ *  the storage for their results all live in a single allocation,
+ *  which the combinator releases itself once every handler it waits
+ *  for has finished.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class Results;
+
+/**
+ *  Combinator class
+ */
+class Combinator
+{
+protected:
+    /**
+     *  What we keep for every deferred handler
+     */
+    struct Slot
+    {
+        /**
+         *  The combinator the slot belongs to, and its position
+         */
+        Combinator *combinator;
+        size_t index;
+
+        /**
+         *  The handler we wait for
+         */
+        Deferred *deferred;
+
+        /**
+         *  Did the result arrive?
+         */
+        bool filled;
+
+        /**
+         *  Storage for the result
+         */
+        std::aligned_storage<sizeof(Result), alignof(Result)>::type storage;
+
+        /**
+         *  The result in the storage
+         */
+        Result *result() { return reinterpret_cast<Result*>(&storage); }
+    };
+
+    /**
+     *  The slots, stored right after the combinator
+     */
+    Slot *_slots;
+
+    /**
+     *  The number of slots, and the number of handlers still running
+     */
+    size_t _count;
+    size_t _pending;
+
+    /**
+     *  Did we already report the outcome?
+     */
+    bool _finished = false;
+
+    /**
+     *  Callback to execute on failure
+     */
+    std::function<void(const char *error)> _failureCallback;
+
+    /**
+     *  Callback to execute on completion
+     */
+    std::function<void()> _completeCallback;
+
+    /**
+     *  Constructor
+     *
+     *  @param  slots       storage for the slots
+     *  @param  count       the number of slots
+     */
+    Combinator(void *slots, size_t count) :
+        _slots(static_cast<Slot*>(slots)),
+        _count(count),
+        _pending(count) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Combinator()
+    {
+        // destruct the results that arrived
+        for (size_t i = 0; i < _count; ++i) if (_slots[i].filled) _slots[i].result()->~Result();
+    }
+
+    /**
+     *  Allocate a combinator, together with its slots
+     *
+     *  @param  count       the number of slots
+     */
+    template <typename T>
+    static T *allocate(size_t count)
+    {
+        // the slots are placed after the combinator, properly aligned
+        size_t offset = (sizeof(T) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+
+        // allocate everything in one go
+        char *memory = static_cast<char*>(::operator new(offset + count * sizeof(Slot)));
+
+        // construct the combinator
+        return new (memory) T(memory + offset, count);
+    }
+
+    /**
+     *  The deferred handler, from the way it was passed
+     *
+     *  @param  deferred    the handler
+     */
+    static Deferred& handler(Deferred *deferred) { return *deferred; }
+    static Deferred& handler(std::reference_wrapper<Deferred> deferred) { return deferred.get(); }
+
+    /**
+     *  Wait for a deferred handler
+     *
+     *  @param  index       the slot for the handler
+     *  @param  deferred    the handler to wait for
+     *  @throws Exception   when we already wait for the handler
+     */
+    void watch(size_t index, Deferred &deferred)
+    {
+        // a handler only calls a single hook, so we would wait forever for one of its slots
+        if (deferred._resume == &resume && static_cast<Slot*>(deferred._context)->combinator == this) throw Exception("Deferred handler passed more than once");
+
+        // initialize the slot
+        auto &slot = _slots[index];
+        slot.combinator = this;
+        slot.index = index;
+        slot.deferred = &deferred;
+        slot.filled = false;
+
+        // the handler calls us directly when it finishes
+        deferred.onResume(&resume, &slot);
+    }
+
+    /**
+     *  Wait for a range of deferred handlers
+     *
+     *  When the handlers cannot be watched, the combinator is destroyed.
+     *
+     *  @param  begin       the first handler
+     *  @param  end         past the last handler
+     *  @throws Exception   when a handler is passed more than once
+     */
+    template <typename Iterator>
+    void watch(Iterator begin, Iterator end)
+    {
+        // the number of handlers we watch
+        size_t index = 0;
+
+        try
+        {
+            // watch them one by one
+            for (; begin != end; ++begin, ++index) watch(index, handler(*begin));
+        }
+        catch (...)
+        {
+            // the handlers we already watch should no longer call us
+            for (size_t i = 0; i < index; ++i) _slots[i].deferred->onResume(nullptr, nullptr);
+
+            // only those slots were initialized, and no results arrived in them yet
+            _count = index;
+            destroy();
+            throw;
+        }
+    }
+
+    /**
+     *  The hook that is called by the deferred handlers
+     *
+     *  @param  context     the slot of the handler
+     *  @param  result      the result, on success
+     *  @param  error       the error, on failure
+     */
+    static void resume(void *context, Result *result, const char *error)
+    {
+        // the slot and its combinator
+        auto *slot = static_cast<Slot*>(context);
+        auto *combinator = slot->combinator;
+
+        // one handler less to wait for
+        --combinator->_pending;
+
+        // let the implementation process the outcome, unless it was already reported
+        if (!combinator->_finished) combinator->settle(*slot, result, error);
+
+        // when all handlers finished, nobody refers to us anymore
+        if (combinator->_pending == 0) combinator->destroy();
+    }
+
+    /**
+     *  Process the outcome of a handler
+     *
+     *  @param  slot        the slot of the handler
+     *  @param  result      the result, on success
+     *  @param  error       the error, on failure
+     */
+    virtual void settle(Slot &slot, Result *result, const char *error) = 0;
+
+    /**
+     *  Report a failure
+     *
+     *  @param  error       the error
+     */
+    void fail(const char *error)
+    {
+        // this is the outcome
+        _finished = true;
+
+        // execute the callbacks
+        if (_failureCallback)   _failureCallback(error);
+        if (_completeCallback)  _completeCallback();
+    }
+
+    /**
+     *  Destruct the combinator and release its memory
+     */
+    void destroy()
+    {
+        // the memory starts at the most derived object
+        void *memory = dynamic_cast<void*>(this);
+
+        // destruct and release
+        this->~Combinator();
+        ::operator delete(memory);
+    }
+
+    // the results are stored in our slots
+    friend class Results;
+
+public:
+    /**
+     *  We cannot be copied
+     */
+    Combinator(const Combinator& that) = delete;
+
+    /**
+     *  Nor can we be moved
+     */
+    Combinator(Combinator&& that) = delete;
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -18,6 +18,23 @@ namespace React { namespace MySQL {
 
 // forward declaration
 class Statement;
+class StatisticsRecorder;
+class DigestTable;
+class SlowQueryLog;
+class LagMonitor;
+class Tracer;
+class CompletionQueue;
+class SubmissionQueue;
+class InFlight;
+class InFlightCounter;
+class DeferredPool;
+class TransactionWork;
+class TransactionSession;
+class GroupCommit;
+class StreamedResultImpl;
+class ResultCache;
+class SingleFlight;
+class Throttle;
 
 /**
  *  Connection class
@@ -45,15 +62,90 @@ private:
      */
     std::unordered_map<const char *, std::unique_ptr<Statement>> _statements;
 
+    /**
+     *  Statistics about the operations on this connection
+     */
+    std::unique_ptr<StatisticsRecorder> _statistics;
+
+    /**
+     *  Statistics about the queries on this connection, per digest
+     */
+    std::unique_ptr<DigestTable> _digests;
+
+    /**
+     *  Where to report slow queries, owned by the worker
+     */
+    std::unique_ptr<SlowQueryLog> _slowlog;
+
+    /**
+     *  The callbacks waiting for the master thread
+     */
+    std::unique_ptr<LagMonitor> _lag;
+
+    /**
+     *  Unique id of this connection, and the id of the last query, for tracing
+     */
+    uint64_t _id;
+    uint64_t _sequence = 0;
+
+    /**
+     *  The tracer, if tracing is enabled, and the pointer
+     *  that is read by the threads to find out
+     */
+    std::unique_ptr<Tracer> _tracer;
+    std::atomic<Tracer*> _tracing;
+
     /**
      *  Worker for main thread
      */
     Worker _master;
 
     /**
-     *  The worker operating on MySQL
+     *  The callbacks waiting for the master thread
+     */
+    std::unique_ptr<CompletionQueue> _completions;
+
+    /**
+     *  The operations in flight, to keep the loop alive
+     */
+    std::unique_ptr<InFlightCounter> _inflight;
+
+    /**
+     *  The pool for the deferred handlers
      */
-    Worker _worker;
+    std::shared_ptr<DeferredPool> _deferreds;
+
+    /**
+     *  The transactions waiting to be committed together, if enabled
+     */
+    std::unique_ptr<GroupCommit> _group;
+
+    /**
+     *  The cache for the results of reads
+     */
+    std::unique_ptr<ResultCache> _cache;
+
+    /**
+     *  The reads on their way to the server, that identical reads can join
+     */
+    std::unique_ptr<SingleFlight> _flights;
+
+    /**
+     *  The streams that the worker may be waiting on, these are
+     *  stopped on destruction so the worker cannot hang
+     */
+    std::vector<std::weak_ptr<Throttle>> _throttles;
+
+    /**
+     *  The transactions that the worker may be pinned to, these
+     *  are closed on destruction so the worker is released
+     */
+    std::vector<std::weak_ptr<TransactionSession>> _sessions;
+
+    /**
+     *  The worker operating on MySQL, with its queue
+     */
+    std::unique_ptr<SubmissionQueue> _worker;
 
     /**
      *  Retrieve or create a cached prepared statement
@@ -66,18 +158,260 @@ private:
      *  Parse the string and replace all placeholders with
      *  the provided values.
      *
-     *  The callback is executed with the result.
+     *  The callback is executed with the result, with the
+     *  digest of the query template, and with the id of the
+     *  query, which the trace span that was started continues
+     *  under when it is submitted.
      *
      *  @param  query       the query to parse
      *  @param  callback    the callback to give the result
      *  @param  parameters  placeholder values
      *  @param  count       number of placeholder values
      */
-    void prepare(const std::string& query, LocalParameter *parameters, size_t count, const std::function<void(const std::string& query)>& callback);
+    void prepare(const std::string& query, LocalParameter *parameters, size_t count, const std::function<void(std::string&& query, const std::string& digest, uint64_t id)>& callback);
+
+    /**
+     *  Execute a query in the worker thread
+     *
+     *  @param  query       the query to execute
+     *  @param  projection  the columns to materialize
+     *  @param  digest      the digest of the query, or empty to compute it
+     *  @param  deferred    the deferred handler to use, or a nullptr for a new one
+     *  @param  id          the id of a prepared query to continue, or zero for a new one
+     */
+    Deferred& submit(std::string query, const Projection& projection, std::string digest, std::shared_ptr<Deferred> deferred, uint64_t id = 0);
+
+    /**
+     *  Create a deferred handler from the pool
+     */
+    std::shared_ptr<Deferred> allocate();
+
+    /**
+     *  Let a read join an identical read that is on its way
+     *
+     *  A write stops others from joining the reads on their way, so the
+     *  reads that follow see its changes. Queries that neither read the
+     *  data nor change it, like health checks, are sent by themselves.
+     *
+     *  @param  access      what the query does with the data
+     *  @param  query       the query
+     *  @param  variant     the projection or the parameters, that tell identical queries apart
+     *  @param  deferred    the handler of the caller
+     *  @return the handler to send the query with, or a nullptr when it joined another read
+     */
+    std::shared_ptr<Deferred> board(ResultCache::Access access, const std::string& query, const std::string& variant, const std::shared_ptr<Deferred>& deferred);
+
+    /**
+     *  Hand a callback over to the master thread
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  callback    the callback to execute in the master thread
+     *  @param  query       the id of the query the callback is for, if any
+     *  @param  deferred    the deferred the callback is for, if any
+     */
+    void deliver(const std::function<void()>& callback, uint64_t query = 0, const Deferred *deferred = nullptr);
+
+    /**
+     *  The tracer, if tracing is enabled
+     */
+    Tracer *tracer() const
+    {
+        return _tracing.load(std::memory_order_acquire);
+    }
+
+    /**
+     *  Report an operation as failed
+     *
+     *  The error is copied right away, since the
+     *  connection can be reused before the master
+     *  thread gets to run the callback.
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  reference   the token keeping the loop alive
+     *  @param  deferred    the deferred to inform
+     *  @param  error       description of the failure
+     *  @param  query       the id of the failed query, if any
+     */
+    void fail(const InFlight& reference, const std::shared_ptr<Deferred>& deferred, const char *error, uint64_t query = 0);
+
+    /**
+     *  Is a query with the given duration slow?
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  duration    the time spent executing and fetching
+     */
+    bool slow(uint64_t duration) const;
+
+    /**
+     *  Report a slow query
+     *
+     *  This looks up the number of examined rows, explains
+     *  the query if it was sampled and hands the record to
+     *  the callback in the master thread.
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only, after all results
+     *          of the query have been consumed
+     *
+     *  @param  reference   the token keeping the loop alive
+     *  @param  record      the slow query record
+     *  @param  explain     function to explain the query, if possible
+     */
+    void report(const InFlight& reference, SlowQuery&& record, const std::function<std::string()>& explain);
+
+    /**
+     *  Explain a query
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  query       the query to explain
+     *  @return the query plan in json format, or an empty string
+     */
+    std::string explain(const std::string& query);
+
+    /**
+     *  Start a transaction that runs its statements as they are added
+     *
+     *  The worker is pinned to the transaction from the moment it
+     *  gets to it, until the transaction is committed or rolled back.
+     *
+     *  @return the transaction
+     */
+    std::shared_ptr<TransactionSession> begin();
+
+    /**
+     *  Run a query in a transaction that was started with begin()
+     *
+     *  Once a query fails, the transaction is doomed: the queries
+     *  that follow fail with the same error, and it cannot commit.
+     *
+     *  @param  session     the transaction
+     *  @param  query       the query to run
+     *  @return the deferred handler for the query
+     */
+    Deferred& interact(const std::shared_ptr<TransactionSession>& session, std::string query);
+
+    /**
+     *  Commit or roll back a transaction that was started with begin()
+     *
+     *  @param  session     the transaction
+     *  @param  commit      should the transaction be committed?
+     *  @return the deferred handler for the outcome
+     */
+    Deferred& conclude(const std::shared_ptr<TransactionSession>& session, bool commit);
+
+    /**
+     *  Commit or roll back a transaction
+     *
+     *  With group commit enabled, the transaction may
+     *  wait for other transactions to commit with.
+     *
+     *  @param  work        the transaction
+     */
+    void commit(TransactionWork&& work);
+
+    /**
+     *  Commit the transactions waiting in the group
+     */
+    void flush();
+
+    /**
+     *  Run transactions in the worker thread
+     *
+     *  When more than one transaction is passed, they are run
+     *  in a single server transaction, each of them protected
+     *  by a savepoint.
+     *
+     *  @param  group       the transactions
+     */
+    void transact(std::vector<TransactionWork>&& group);
+
+    /**
+     *  Run the transactions in a single server transaction
+     *
+     *  Only the transactions to commit that did not fail and were not
+     *  committed yet are run. A transaction that fails on its own is
+     *  rolled back to its savepoint, and if its policy allows a retry,
+     *  it is set aside to run again after the others are committed, so
+     *  its backoff is not spent while their locks are held. When the server
+     *  transaction as a whole is lost, the error is returned, and none
+     *  of the transactions that were running is marked as failed yet.
+     *  When a statement caused it, the culprit is set to the index of
+     *  its transaction, otherwise to the number of transactions.
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  transactions    the transactions
+     *  @param  code            where to store the error code when the server transaction is lost
+     *  @param  culprit         where to store the transaction that caused the loss
+     *  @param  backoff         where to store the longest backoff of the transactions set aside
+     *  @return the error when the server transaction is lost, or an empty string
+     */
+    std::string run(std::vector<TransactionWork>& transactions, unsigned int& code, size_t& culprit, uint64_t& backoff);
+
+    /**
+     *  Run a query and collect its result sets
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  query       the query to run
+     *  @param  results     where to store the result sets, or a nullptr to discard them
+     *  @param  error       where to store the error
+     *  @return did the query succeed?
+     */
+    bool perform(const std::string& query, std::vector<Result> *results, std::string& error);
+
+    /**
+     *  The GTIDs of the transaction committed by the last query
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @return the GTIDs, or an empty string if they are not tracked
+     */
+    std::string gtids();
+
+    /**
+     *  Run a query and stream its rows to the master thread
+     *
+     *  The rows are read one by one from an unbuffered result, and passed
+     *  to the master thread in batches. When the stream is stopped, no
+     *  more rows are passed, and the rest of the result is read from the
+     *  server and discarded, which the connection needs before it can
+     *  run another query. The callbacks are executed in the master thread, the
+     *  completion callback gets the fields of the result (or a nullptr if
+     *  the query had no result set), which of them hold numbers according
+     *  to their type, and the error, if the query failed.
+     *
+     *  Every batch that is passed is counted by the throttle, and the
+     *  receiver releases it when it is done with the batch. While the
+     *  backlog is full, the worker stops reading, so the server has to
+     *  wait instead of the rows piling up in memory. When the throttle
+     *  is stopped, no more rows are read.
+     *
+     *  @param  query       the query to run
+     *  @param  batch       the number of rows to pass at once
+     *  @param  throttle    the limit on the batches the receiver is not done with
+     *  @param  rows        callback for every batch of rows
+     *  @param  done        callback when the query is done
+     */
+    void stream(std::string query, size_t batch, std::shared_ptr<Throttle> throttle, std::function<void(const std::shared_ptr<StreamedResultImpl>& rows)> rows, std::function<void(const std::shared_ptr<const std::map<std::string, size_t>>& fields, const std::shared_ptr<const std::vector<bool>>& numeric, const char *error)> done);
 public:
     /**
      *  Establish a connection to mysql
      *
+     *  The hostname may include a port ("127.0.0.1:3307"), or be
+     *  the path to the unix socket of the server.
+     *
      *  @param  loop        the loop to bind to
      *  @param  hostname    the hostname to connect to
      *  @param  username    the username to login with
@@ -100,12 +434,158 @@ public:
      */
     void onConnected(const std::function<void(const char *error)>& callback);
 
+    /**
+     *  Retrieve the statistics of this connection
+     *
+     *  This returns a snapshot of the latency histograms and
+     *  traffic counters since the connection was created. To
+     *  aggregate multiple connections, add their snapshots.
+     */
+    Statistics statistics() const;
+
+    /**
+     *  Retrieve the statistics per query digest
+     *
+     *  Queries are grouped by their digest: the query text with all
+     *  literals replaced by placeholders. Queries with placeholders
+     *  are grouped by their template, prepared statements by their
+     *  statement. The digests are sorted by the total time spent
+     *  on them. A limited number of digests is tracked, the queries
+     *  that do not fit are added to a single "(other)" digest.
+     */
+    std::vector<Digest> digests() const;
+
+    /**
+     *  Get a call for every slow query
+     *
+     *  A query or statement is slow when executing and fetching its
+     *  result takes longer than the threshold. The callback is called
+     *  after the result was delivered, with the timings, the number of
+     *  rows sent and examined and, for a sampled fraction of the slow
+     *  queries, the plan from EXPLAIN FORMAT=JSON. The extra queries
+     *  for this run in the worker thread, so keep the threshold high
+     *  enough for slow queries to be rare. Pass an empty callback to
+     *  stop reporting slow queries.
+     *
+     *  @param  threshold   the threshold in seconds
+     *  @param  callback    the callback to report slow queries to
+     *  @param  explain     the fraction of slow queries to explain
+     */
+    void onSlowQuery(double threshold, const std::function<void(const SlowQuery& query)>& callback, double explain = 0.0);
+
+    /**
+     *  The number of callbacks waiting to be run by the event loop
+     *
+     *  Results are handed over from the worker thread to the event
+     *  loop. When the loop is saturated, they pile up here. The time
+     *  they wait is recorded in the handoff histogram of statistics().
+     */
+    size_t backlog() const;
+
+    /**
+     *  The number of operations waiting for the worker, or running
+     *
+     *  This is the load of the connection, pools use it to pick
+     *  the connection that is least busy.
+     */
+    size_t pending() const;
+
+    /**
+     *  Get a call when the event loop starts lagging
+     *
+     *  The callback is called, from the event loop, when a result had
+     *  to wait longer than the threshold before the loop got to it. It
+     *  is called once every time the loop starts lagging: only after a
+     *  result is delivered within the threshold again, it is called on
+     *  the next lagging result. Pass an empty callback to stop.
+     *
+     *  @param  threshold   the threshold in seconds
+     *  @param  callback    the callback with the delay in nanoseconds and the backlog
+     */
+    void onLag(double threshold, const std::function<void(uint64_t delay, size_t backlog)>& callback);
+
+    /**
+     *  Start tracing the queries on this connection
+     *
+     *  For every query a span is written to the file, with the trace id
+     *  of the deferred and the moments the query was enqueued, picked
+     *  up by the worker, executed, fetched and delivered. The phases are
+     *  collected in lock-free buffers and written to the file by a
+     *  background thread. When the buffers are full, phases are lost.
+     *  Tracing stays enabled until the connection is destroyed.
+     *
+     *  @param  filename    the file to write the spans to
+     *  @param  format      the format to write the spans in
+     *  @param  capacity    the number of phases that can be buffered
+     *  @return false if tracing was already enabled, or the file cannot be opened
+     */
+    bool trace(const std::string& filename, TraceFormat format = TraceFormat::json, size_t capacity = 4096);
+
+    /**
+     *  Track the GTIDs of the transactions committed on this connection
+     *
+     *  This enables session_track_gtids on the server (also after a
+     *  reconnect), so the results of writes hold the GTIDs they
+     *  produced. Pass them to a Session, to be able to read your
+     *  own writes from a replica. This needs MySQL 5.7 or later.
+     */
+    void trackGtids();
+
+    /**
+     *  Commit small transactions together
+     *
+     *  Transactions that are committed within the window are merged into
+     *  a single server transaction, so the cost of flushing the log to disk
+     *  is shared. Every transaction in the group is protected by a savepoint,
+     *  so a failing query only rolls back its own transaction, but a failing
+     *  commit fails all of them. Only use this for small, independent writes:
+     *  queries that cause an implicit commit, like schema changes, must not
+     *  be used in grouped transactions. Pass a zero window to disable it.
+     *
+     *  @param  window      how long transactions wait for others, in seconds
+     *  @param  limit       the maximum number of transactions in a group
+     */
+    void groupCommit(double window, size_t limit = 32);
+
+    /**
+     *  The cache for the results of reads
+     *
+     *  The cache is disabled until it gets a capacity. Reads sent with
+     *  query() or execute() are then served from the cache when their
+     *  result is there, without going to the worker thread. Writes on
+     *  this connection remove the results read from the tables they
+     *  write to. Add SQL_NO_CACHE to a query to always send it.
+     */
+    ResultCache& cache();
+
+    /**
+     *  Combine identical reads
+     *
+     *  When a read is sent while an identical read (the same query, with
+     *  the same parameters and projection) is still waiting for the worker
+     *  or running, it is not sent again, but gets the result of the read
+     *  that is on its way. The rows are shared by the results, not copied.
+     *  Anything sent on the connection that is not a read, like a write or
+     *  a transaction, stops later reads from joining the earlier ones, so
+     *  they see its changes. This works for query(), execute() and
+     *  prepared statements, except for statements that stream data.
+     *
+     *  @param  enabled     should identical reads be combined?
+     */
+    void singleFlight(bool enabled = true);
+
     /**
      *  Execute a query
      *
+     *  When a projection is given, only the named columns are
+     *  materialized in the result, all other columns are skipped.
+     *  The query is moved to the worker thread, so pass a temporary
+     *  or use std::move() to avoid copying it.
+     *
      *  @param  query       the query to execute
+     *  @param  projection  the columns to materialize
      */
-    Deferred& query(const std::string& query);
+    Deferred& query(std::string query, const Projection& projection = Projection());
 
     /**
      *  Execute a query with placeholders
@@ -119,6 +599,10 @@ public:
      *  protocol. This comes with some extra network overhead. The query is also
      *  not cached on the server, as is done with prepared statements.
      *
+     *  The placeholders are filled in by the worker, so the result cache is only
+     *  consulted after that trip: a cached result is still passed without going
+     *  to the server, but not without going to the worker.
+     *
      *  The following placeholders are supported:
      *
      *  ?   escape string data and quote when necessary
@@ -134,22 +618,12 @@ public:
         if (sizeof...(parameters) == 0) return this->query(query);
 
         // create the deferred handler
-        auto deferred = std::make_shared<Deferred>();
-
-        // prepare the query, then execute it
-        prepare(query, new LocalParameter[sizeof...(parameters)]{ parameters... }, sizeof...(parameters), [this, deferred](const std::string& query) {
-            // execute query
-            auto &result = this->query(query);
-
-            // pass on the completed event
-            result.onComplete([deferred]() { deferred->complete(); });
-
-            // only register success and failure if necessary
-            if (deferred->requireStatus())
-            {
-                result.onSuccess([deferred](Result&& result)   { deferred->success(std::move(result)); });
-                result.onFailure([deferred](const char *error) { deferred->failure(error); });
-            }
+        auto deferred = allocate();
+
+        // prepare the query, then execute it with the same deferred handler,
+        // grouped under the digest of the template
+        prepare(query, new LocalParameter[sizeof...(parameters)]{ parameters... }, sizeof...(parameters), [this, deferred](std::string&& query, const std::string& digest, uint64_t id) {
+            submit(std::move(query), Projection(), digest, deferred, id);
         });
 
         // return the deferred handler
@@ -161,6 +635,10 @@ public:
      */
     friend class Statement;
     friend class CachedStatement;
+    friend class Transaction;
+    friend class Router;
+    friend class FanOut;
+    friend class Loader;
 };
 
 /**
@@ -0,0 +1,371 @@
+/**
+ *  Coroutine.h
+ *
+ *  Support for C++20 coroutines. This header is not included by
+ *  mysql.h, include it after mysql.h to be able to co_await the
+ *  deferred handlers that are returned by queries and statements:
+ *
+ *      React::MySQL::CoTask<size_t> count(React::MySQL::Connection &connection)
+ *      {
+ *          // the coroutine is resumed in the event loop when the result is in
+ *          auto result = co_await connection.query("SELECT * FROM users");
+ *          co_return result.size();
+ *      }
+ *
+ *  A failed query throws a React::MySQL::Exception. The coroutine is
+ *  resumed directly from the event loop, so it must be started there
+ *  too. Tasks can be awaited by other coroutines, or detached.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  This is only available with C++20
+ */
+#if __cplusplus >= 202002L
+
+/**
+ *  Dependencies
+ */
+#include <coroutine>
+#include <optional>
+#include <exception>
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Awaiter for a deferred handler
+ */
+class DeferredAwaiter
+{
+private:
+    /**
+     *  The deferred handler we are waiting for
+     */
+    Deferred &_deferred;
+
+    /**
+     *  The waiting coroutine
+     */
+    std::coroutine_handle<> _handle;
+
+    /**
+     *  The result, when it arrived
+     */
+    std::optional<Result> _result;
+
+    /**
+     *  The error, when the operation failed
+     */
+    std::optional<std::string> _error;
+
+    /**
+     *  The hook that is called by the deferred handler
+     *
+     *  @param  context     the awaiter
+     *  @param  result      the result, on success
+     *  @param  error       the error, on failure
+     */
+    static void resume(void *context, Result *result, const char *error)
+    {
+        // the awaiter that is waiting
+        auto *self = static_cast<DeferredAwaiter*>(context);
+
+        // store the outcome
+        if (result) self->_result.emplace(std::move(*result));
+        else if (error) self->_error.emplace(error);
+
+        // and continue the coroutine
+        self->_handle.resume();
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  deferred    the deferred handler to wait for
+     */
+    DeferredAwaiter(Deferred &deferred) : _deferred(deferred) {}
+
+    /**
+     *  The result is never available right away
+     */
+    bool await_ready() const noexcept { return false; }
+
+    /**
+     *  Suspend the coroutine until the operation finishes
+     *
+     *  @param  handle      the coroutine to resume
+     */
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        _handle = handle;
+        _deferred.onResume(&resume, this);
+    }
+
+    /**
+     *  The result of the operation
+     *
+     *  @throws Exception   when the operation failed
+     */
+    Result await_resume()
+    {
+        // did the operation fail?
+        if (_error) throw Exception(_error->c_str());
+
+        // the result, or an invalid result when there was no status
+        if (_result) return std::move(*_result);
+        return Result(nullptr);
+    }
+};
+
+/**
+ *  Make deferred handlers awaitable
+ *
+ *  @param  deferred    the deferred handler to wait for
+ */
+inline DeferredAwaiter operator co_await(Deferred &deferred)
+{
+    return DeferredAwaiter(deferred);
+}
+
+// forward declaration
+template <typename T>
+class CoTask;
+
+/**
+ *  The part of the promise that does not depend on the type
+ */
+class CoTaskPromiseBase
+{
+private:
+    /**
+     *  The coroutine that awaits us
+     */
+    std::coroutine_handle<> _continuation;
+
+    /**
+     *  Was the task detached?
+     */
+    bool _detached = false;
+
+    /**
+     *  The exception that escaped the coroutine
+     */
+    std::exception_ptr _exception;
+
+    /**
+     *  Awaiter to run when the coroutine finishes
+     */
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        void await_resume() const noexcept {}
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            // continue the awaiting coroutine, if there is one
+            auto &promise = handle.promise();
+            if (promise._continuation) return promise._continuation;
+
+            // nobody is interested in a detached task, so we clean up ourselves
+            if (promise._detached) handle.destroy();
+            return std::noop_coroutine();
+        }
+    };
+
+    // the task manages the promise
+    template <typename T>
+    friend class CoTask;
+
+public:
+    /**
+     *  Tasks start right away
+     */
+    std::suspend_never initial_suspend() noexcept { return {}; }
+
+    /**
+     *  And stay around until the result is picked up
+     */
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    /**
+     *  Store exceptions that escape the coroutine
+     */
+    void unhandled_exception() { _exception = std::current_exception(); }
+};
+
+/**
+ *  The promise for tasks with a value
+ */
+template <typename T>
+class CoTaskPromise : public CoTaskPromiseBase
+{
+private:
+    /**
+     *  The value
+     */
+    std::optional<T> _value;
+
+    // the task reads the value
+    friend class CoTask<T>;
+
+public:
+    /**
+     *  Create the task
+     */
+    CoTask<T> get_return_object();
+
+    /**
+     *  Store the value
+     *
+     *  @param  value       the value
+     */
+    void return_value(T value) { _value.emplace(std::move(value)); }
+};
+
+/**
+ *  The promise for tasks without a value
+ */
+template <>
+class CoTaskPromise<void> : public CoTaskPromiseBase
+{
+public:
+    /**
+     *  Create the task
+     */
+    CoTask<void> get_return_object();
+
+    /**
+     *  Nothing to store
+     */
+    void return_void() {}
+};
+
+/**
+ *  CoTask class, the result of a coroutine
+ */
+template <typename T = void>
+class CoTask
+{
+public:
+    /**
+     *  The promise type
+     */
+    typedef CoTaskPromise<T> promise_type;
+
+private:
+    /**
+     *  The coroutine
+     */
+    std::coroutine_handle<promise_type> _handle;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  handle      the coroutine
+     */
+    explicit CoTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+    /**
+     *  Move constructor
+     *
+     *  @param  that        the task to move
+     */
+    CoTask(CoTask &&that) noexcept : _handle(that._handle) { that._handle = nullptr; }
+
+    /**
+     *  Tasks cannot be copied
+     */
+    CoTask(const CoTask &that) = delete;
+
+    /**
+     *  Destructor
+     *
+     *  A task that did not finish yet is detached, since an
+     *  operation may still be going to resume it.
+     */
+    ~CoTask()
+    {
+        if (!_handle) return;
+        if (_handle.done()) _handle.destroy();
+        else _handle.promise()._detached = true;
+    }
+
+    /**
+     *  Let the task run without waiting for it, it cleans up itself
+     */
+    void detach()
+    {
+        // a finished task can be cleaned up right away
+        if (_handle && _handle.done()) _handle.destroy();
+        else if (_handle) _handle.promise()._detached = true;
+
+        // we no longer manage the coroutine
+        _handle = nullptr;
+    }
+
+    /**
+     *  Has the task finished?
+     */
+    bool done() const { return !_handle || _handle.done(); }
+
+    /**
+     *  Is the result available?
+     */
+    bool await_ready() const noexcept { return _handle.done(); }
+
+    /**
+     *  Suspend the awaiting coroutine until the task finishes
+     *
+     *  @param  handle      the awaiting coroutine
+     */
+    void await_suspend(std::coroutine_handle<> handle) noexcept { _handle.promise()._continuation = handle; }
+
+    /**
+     *  The result of the task
+     *
+     *  @throws the exception that escaped the task
+     */
+    T await_resume()
+    {
+        // pass on exceptions
+        auto &promise = _handle.promise();
+        if (promise._exception) std::rethrow_exception(promise._exception);
+
+        // pass on the value
+        if constexpr (!std::is_void_v<T>) return std::move(*promise._value);
+    }
+};
+
+/**
+ *  Create the task for a coroutine with a value
+ */
+template <typename T>
+CoTask<T> CoTaskPromise<T>::get_return_object()
+{
+    return CoTask<T>(std::coroutine_handle<CoTaskPromise<T>>::from_promise(*this));
+}
+
+/**
+ *  Create the task for a coroutine without a value
+ */
+inline CoTask<void> CoTaskPromise<void>::get_return_object()
+{
+    return CoTask<void>(std::coroutine_handle<CoTaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ *  End namespace
+ */
+}}
+
+/**
+ *  End of C++20 check
+ */
+#endif
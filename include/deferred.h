@@ -28,6 +28,11 @@ private:
      */
     std::function<void(Result&& result)> _successCallback;
 
+    /**
+     *  Callback to execute on success, with all result sets at once
+     */
+    std::function<void(std::vector<Result>&& results)> _resultsCallback;
+
     /**
      *  Callback to execute on failure
      */
@@ -39,17 +44,44 @@ private:
     std::function<void()> _completeCallback;
 
     /**
-     *  Do we have to go through the trouble of checking for
-     *  success or error? If not, we can save a round-trip
-     *  to the server.
+     *  The trace id, for tracing the query
+     */
+    uint64_t _trace = 0;
+
+    /**
+     *  The handler whose trace id is used instead, when this handler
+     *  sends a query on behalf of another, which outlives the query
      */
-    bool requireStatus()
+    const Deferred *_traced = nullptr;
+
+    /**
+     *  Hook to resume a waiting coroutine, with its context
+     */
+    void (*_resume)(void *context, Result *result, const char *error) = nullptr;
+    void *_context = nullptr;
+
+    /**
+     *  Run the resume hook, if one is installed
+     *
+     *  @param  result      the result, on success
+     *  @param  error       the error, on failure
+     *  @return was a hook installed
+     */
+    bool resume(Result *result, const char *error)
     {
-        // status is only relevant if a success- or failure callback
-        // has been installed, the complete callback is irrelevant.
-        return _successCallback || _failureCallback;
+        // is there a hook at all?
+        if (_resume == nullptr) return false;
+
+        // the hook is only used once
+        auto resume = _resume;
+        _resume = nullptr;
+
+        // run it
+        resume(_context, result, error);
+        return true;
     }
 
+
     /**
      *  Signal that the command finished successfully
      *
@@ -57,31 +89,65 @@ private:
      */
     void success(Result&& result)
     {
+        // a waiting coroutine takes the result
+        if (resume(&result, nullptr)) return;
+
+        // a single result set is passed as a list when the result sets are collected
+        if (_resultsCallback)
+        {
+            std::vector<Result> results;
+            results.push_back(std::move(result));
+            return success(std::move(results));
+        }
+
         // execute the callbacks
         if (_successCallback)   _successCallback(std::move(result));
         if (_completeCallback)  _completeCallback();
     }
 
     /**
-     *  Signal that the operation resulted in failure
+     *  Signal that the command finished successfully, with
+     *  all the result sets it produced
      *
-     *  @param  error       description of the failure reason
+     *  @param  results     the result sets
      */
-    void failure(const char *error)
+    void success(std::vector<Result>&& results)
     {
         // execute the callbacks
-        if (_failureCallback)   _failureCallback(error);
+        if (_resultsCallback)   _resultsCallback(std::move(results));
         if (_completeCallback)  _completeCallback();
     }
 
     /**
-     *  Signal that the operation completed, but without
-     *  indicating whether it resulted in success
+     *  Signal that the command finished, with the result sets it produced
+     *  before it finished or failed
+     *
+     *  @param  results     the result sets
+     *  @param  error       description of the failure reason, if it failed
      */
-    void complete()
+    void finish(std::vector<Result>&& results, const char *error)
     {
-        // execute the callback
-        if (_completeCallback) _completeCallback();
+        // the result sets are passed at once, unless one of them failed
+        if (_resultsCallback) return error ? failure(error) : success(std::move(results));
+
+        // or one by one, followed by the failure
+        for (auto &result : results) success(std::move(result));
+        if (error) failure(error);
+    }
+
+    /**
+     *  Signal that the operation resulted in failure
+     *
+     *  @param  error       description of the failure reason
+     */
+    void failure(const char *error)
+    {
+        // a waiting coroutine takes the error
+        if (resume(nullptr, error)) return;
+
+        // execute the callbacks
+        if (_failureCallback)   _failureCallback(error);
+        if (_completeCallback)  _completeCallback();
     }
 public:
     /**
@@ -89,6 +155,18 @@ public:
      */
     Deferred() {}
 
+    /**
+     *  Destructor
+     *
+     *  A handler that is destroyed before its operation finished, for
+     *  example because its connection was destroyed, fails the code
+     *  that waits for it through a hook, so that it does not wait forever.
+     */
+    ~Deferred()
+    {
+        resume(nullptr, "Operation abandoned");
+    }
+
     /**
      *  We cannot be copied
      */
@@ -111,6 +189,26 @@ public:
         return *this;
     }
 
+    /**
+     *  Register a callback to be executed when the operation succeeds,
+     *  with all result sets that it produced
+     *
+     *  A query with multiple statements (or a call to a stored procedure)
+     *  produces a result set for every statement. With this callback, they
+     *  are collected and passed at once, in order, instead of calling the
+     *  success callback for each of them. Statements without a result set
+     *  are passed as a result holding the affected rows and insert id. The
+     *  complete callback is executed only once, after this callback.
+     *
+     *  @param  callback    the callback to execute on success
+     */
+    Deferred& onResults(const std::function<void(std::vector<Result>&& results)>& callback)
+    {
+        // store callback
+        _resultsCallback = callback;
+        return *this;
+    }
+
     /**
      *  Register a callback to be executed when the operation fails
      *
@@ -136,9 +234,61 @@ public:
         return *this;
     }
 
+    /**
+     *  Install a hook to be called once when the operation finishes,
+     *  instead of the callbacks
+     *
+     *  This is a plain function pointer rather than a std::function,
+     *  so it can resume a coroutine without any allocation. It is
+     *  used by the awaiters in coroutine.h, and is called with the
+     *  result on success, or the error on failure. The outcome is
+     *  always passed, so the hook can be installed after submitting.
+     *
+     *  @param  hook        the function to call
+     *  @param  context     the first argument for the function
+     */
+    Deferred& onResume(void (*hook)(void *context, Result *result, const char *error), void *context)
+    {
+        // store the hook
+        _resume = hook;
+        _context = context;
+        return *this;
+    }
+
+    /**
+     *  Set the trace id
+     *
+     *  When tracing is enabled on the connection, the id is stored
+     *  with the trace span of the query, so it can be correlated
+     *  with the spans of the request that caused the query.
+     *
+     *  @param  id          the trace id
+     */
+    Deferred& trace(uint64_t id)
+    {
+        // store the id
+        _trace = id;
+        return *this;
+    }
+
+    /**
+     *  The trace id
+     */
+    uint64_t trace() const
+    {
+        return _traced ? _traced->trace() : _trace;
+    }
+
     // the connection and statement classes may call private methods
     friend class Connection;
     friend class Statement;
+
+    // combined reads pass their outcome to every caller
+    friend class SingleFlight;
+
+    // combinators recognize the handlers they already wait for
+    friend class Combinator;
+    friend class LoaderBatch;
 };
 
 /**
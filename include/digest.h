@@ -0,0 +1,116 @@
+/**
+ *  Digest.h
+ *
+ *  Aggregate statistics for all queries that share the same
+ *  shape. The shape (the digest) is the query text in which
+ *  all literals are replaced by a question mark, lists of
+ *  literals are collapsed, whitespace and comments are folded
+ *  and keywords are written in uppercase, so the queries
+ *  "SELECT * FROM a WHERE id IN (1, 2, 3)" and
+ *  "select * from a where id in (4,5)" end up as the same
+ *  "SELECT * FROM a WHERE id IN (?+)" digest.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Digest class
+ */
+class Digest
+{
+private:
+    /**
+     *  The normalized query text
+     */
+    std::string _text;
+
+    /**
+     *  The number of executions
+     */
+    uint64_t _calls = 0;
+
+    /**
+     *  The number of failed executions
+     */
+    uint64_t _errors = 0;
+
+    /**
+     *  The total and highest latency, in nanoseconds
+     */
+    uint64_t _latency = 0;
+    uint64_t _max = 0;
+
+    /**
+     *  The number of rows and bytes received
+     */
+    uint64_t _rows = 0;
+    uint64_t _bytes = 0;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  text    the normalized query text
+     */
+    Digest(std::string text) : _text(std::move(text)) {}
+
+    /**
+     *  Normalize a query into its digest
+     *
+     *  @param  query   the query to normalize
+     */
+    static std::string normalize(const std::string& query);
+
+    /**
+     *  The normalized query text
+     */
+    const std::string& text() const { return _text; }
+
+    /**
+     *  The number of executions
+     */
+    uint64_t calls() const { return _calls; }
+
+    /**
+     *  The number of failed executions
+     */
+    uint64_t errors() const { return _errors; }
+
+    /**
+     *  The total time spent executing and fetching, in nanoseconds
+     */
+    uint64_t latency() const { return _latency; }
+
+    /**
+     *  The highest time spent on a single execution, in nanoseconds
+     */
+    uint64_t max() const { return _max; }
+
+    /**
+     *  The average time spent on an execution, in nanoseconds
+     */
+    double mean() const { return _calls ? double(_latency) / _calls : 0.0; }
+
+    /**
+     *  The number of rows received
+     */
+    uint64_t rows() const { return _rows; }
+
+    /**
+     *  The number of bytes of field data received
+     */
+    uint64_t bytes() const { return _bytes; }
+
+    // the table updates the counters
+    friend class DigestTable;
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,211 @@
+/**
+ *  FanOut.h
+ *
+ *  Class for running the same query on a number of connections at
+ *  once, for example on all shards, and merging the rows they return.
+ *  The rows are streamed from the servers, so the results of the
+ *  individual connections are never held in memory completely.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class FanOutMerge;
+
+/**
+ *  Fan-out class
+ */
+class FanOut
+{
+public:
+    /**
+     *  The direction to order rows in
+     */
+    enum Order
+    {
+        ascending,
+        descending
+    };
+
+    /**
+     *  The functions to combine partial aggregates with
+     */
+    enum Aggregate
+    {
+        sum,
+        count,
+        min,
+        max
+    };
+
+private:
+    /**
+     *  The connections to run the query on
+     */
+    std::vector<Connection*> _connections;
+
+    /**
+     *  The number of rows passed from a worker at once
+     */
+    size_t _batch;
+
+    /**
+     *  The number of batches of a connection that can wait for the merge
+     */
+    size_t _backlog;
+
+    /**
+     *  The merge of the rows, shared with the running queries
+     */
+    std::shared_ptr<FanOutMerge> _merge;
+
+    /**
+     *  Make sure the query did not start yet
+     *
+     *  @throws Exception   when the query already started
+     */
+    void configurable() const;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  A connection that is ahead of the others, when the rows are
+     *  merged in order, stops reading rows once its backlog is full.
+     *  The backlog of a connection that is passed more than once is
+     *  not limited, since it runs the queries one after the other.
+     *
+     *  @param  connections the connections to run the query on
+     *  @param  batch       the number of rows passed from a worker at once
+     *  @param  backlog     the number of batches that can wait for the merge
+     */
+    FanOut(std::vector<Connection*> connections, size_t batch = 256, size_t backlog = 16);
+
+    /**
+     *  Fan-outs cannot be copied
+     */
+    FanOut(const FanOut& that) = delete;
+
+    /**
+     *  Destructor
+     *
+     *  A query that is still running is cancelled, which is
+     *  reported to the failure and completion callbacks.
+     */
+    virtual ~FanOut();
+
+    /**
+     *  Merge the rows on a column
+     *
+     *  The query should order its rows the same way, the rows of the
+     *  connections are then merged in order as they come in. This can
+     *  be called more than once to order on more than one column. The
+     *  values of columns with a numeric type are compared as numbers,
+     *  other values bytewise, so collations are not taken into account.
+     *  NULL comes before everything else, as in MySQL.
+     *
+     *  @param  column      the column to order on
+     *  @param  order       the direction to order in
+     *  @throws Exception   when the query already started
+     */
+    FanOut& orderBy(const std::string& column, Order order = ascending);
+
+    /**
+     *  Limit the number of merged rows
+     *
+     *  Once enough rows were merged, the connections stop passing rows.
+     *  The rest of the result is still read from the server to discard
+     *  it, since the connection cannot be used again before that, so
+     *  this saves no work on the servers or the network: to limit that,
+     *  the query itself should have the same limit.
+     *
+     *  @param  rows        the maximum number of rows
+     *  @throws Exception   when the query already started
+     */
+    FanOut& limit(size_t rows);
+
+    /**
+     *  Group the aggregated rows on a column
+     *
+     *  The rows of the connections with the same values for the group
+     *  columns are combined into a single row. Rows are only passed after
+     *  all connections are done.
+     *
+     *  @param  column      the column to group on
+     *  @throws Exception   when the query already started
+     */
+    FanOut& groupBy(const std::string& column);
+
+    /**
+     *  Combine the partial aggregates in a column
+     *
+     *  Partial sums and counts are added, with integer arithmetic as long
+     *  as all values are integers, and for minimums and maximums the
+     *  lowest or highest value is taken. Averages should be computed from
+     *  a sum and a count. Columns that are neither grouped on nor
+     *  aggregated get the value of the first row of their group.
+     *
+     *  @param  column      the column with the partial aggregates
+     *  @param  function    how to combine them
+     *  @throws Exception   when the query already started
+     */
+    FanOut& aggregate(const std::string& column, Aggregate function);
+
+    /**
+     *  Run the query on all connections
+     *
+     *  @param  query       the query to run
+     *  @throws Exception   when the query already started
+     */
+    FanOut& query(std::string query);
+
+    /**
+     *  Stop the query
+     *
+     *  The connections stop reading rows. A query that did not
+     *  complete yet fails with a "Fan-out query cancelled" error,
+     *  after which no more callbacks are executed.
+     */
+    void cancel();
+
+    /**
+     *  Register a callback for every merged row
+     *
+     *  @param  callback    the callback to execute
+     */
+    FanOut& onRow(const std::function<void(ResultRow&& row)>& callback);
+
+    /**
+     *  Register a callback to be executed when the query succeeds,
+     *  the result holds all merged rows
+     *
+     *  @param  callback    the callback to execute
+     */
+    FanOut& onSuccess(const std::function<void(Result&& result)>& callback);
+
+    /**
+     *  Register a callback to be executed when the query fails
+     *  on one of the connections
+     *
+     *  @param  callback    the callback to execute
+     */
+    FanOut& onFailure(const std::function<void(const char *error)>& callback);
+
+    /**
+     *  Register a callback to be executed when the query is finished,
+     *  whether it succeeded or not
+     *
+     *  @param  callback    the callback to execute
+     */
+    FanOut& onComplete(const std::function<void()>& callback);
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,175 @@
+/**
+ *  Histogram.h
+ *
+ *  Snapshot of a latency distribution. Values are stored in
+ *  log-linear buckets (eight buckets per power of two), so the
+ *  relative error on any recorded value is at most 12.5 percent.
+ *
+ *  All values are in nanoseconds.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Histogram class
+ */
+class Histogram
+{
+public:
+    /**
+     *  The number of buckets in a histogram
+     */
+    static const size_t buckets = 496;
+
+private:
+    /**
+     *  The number of values in each bucket
+     */
+    std::vector<uint64_t> _buckets;
+
+    /**
+     *  The number of recorded values
+     */
+    uint64_t _count = 0;
+
+    /**
+     *  The sum of all recorded values
+     */
+    uint64_t _sum = 0;
+
+    /**
+     *  The highest recorded value
+     */
+    uint64_t _max = 0;
+
+public:
+    /**
+     *  Constructor
+     */
+    Histogram() : _buckets(buckets, 0) {}
+
+    /**
+     *  The bucket a value is stored in
+     *
+     *  @param  value   the value to store
+     */
+    static size_t bucket(uint64_t value)
+    {
+        // small values get a bucket of their own
+        if (value < 16) return value;
+
+        // the position of the highest bit, and the three bits below it
+        size_t exponent = 63 - __builtin_clzll(value);
+        size_t mantissa = (value >> (exponent - 3)) & 7;
+
+        // eight buckets for every power of two
+        return 16 + (exponent - 4) * 8 + mantissa;
+    }
+
+    /**
+     *  The highest value that is stored in a bucket
+     *
+     *  @param  bucket  the bucket index
+     */
+    static uint64_t upper(size_t bucket)
+    {
+        // small values get a bucket of their own
+        if (bucket < 16) return bucket;
+
+        // find the power of two and the position within it
+        size_t exponent = 4 + (bucket - 16) / 8;
+        size_t mantissa = (bucket - 16) % 8;
+
+        // the lowest value of the next bucket, minus one
+        return ((9 + mantissa) << (exponent - 3)) - 1;
+    }
+
+    /**
+     *  Record a value
+     *
+     *  @param  value   the value to record
+     */
+    void record(uint64_t value)
+    {
+        // update the bucket and the totals
+        _buckets[bucket(value)] += 1;
+        _count += 1;
+        _sum += value;
+        _max = std::max(_max, value);
+    }
+
+    /**
+     *  The number of recorded values
+     */
+    uint64_t count() const { return _count; }
+
+    /**
+     *  The sum of all recorded values
+     */
+    uint64_t sum() const { return _sum; }
+
+    /**
+     *  The highest recorded value
+     */
+    uint64_t max() const { return _max; }
+
+    /**
+     *  The average of the recorded values
+     */
+    double mean() const { return _count ? double(_sum) / _count : 0.0; }
+
+    /**
+     *  The value below which the given percentage of the values fall
+     *
+     *  @param  percentage  the percentile to retrieve, e.g. 99.9
+     */
+    uint64_t percentile(double percentage) const
+    {
+        // the number of values that should fall below the result
+        uint64_t target = std::ceil(_count * std::min(std::max(percentage, 0.0), 100.0) / 100.0);
+
+        // walk through the buckets until we have seen enough values
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets; ++i)
+        {
+            // skip until we passed the target
+            if ((seen += _buckets[i]) < target || seen == 0) continue;
+
+            // the bucket boundary, but never above the highest value
+            return std::min(upper(i), _max);
+        }
+
+        // we have no (or not enough) values
+        return _max;
+    }
+
+    /**
+     *  Add the values from another histogram
+     *
+     *  @param  that    the histogram to merge into this one
+     */
+    Histogram& operator+=(const Histogram& that)
+    {
+        // merge the buckets and the totals
+        for (size_t i = 0; i < buckets; ++i) _buckets[i] += that._buckets[i];
+        _count += that._count;
+        _sum += that._sum;
+        _max = std::max(_max, that._max);
+
+        // allow chaining
+        return *this;
+    }
+
+    // the recorder fills the buckets directly
+    friend class HistogramRecorder;
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,153 @@
+/**
+ *  Loader.h
+ *
+ *  Class for looking up rows by their key. The keys that are asked for
+ *  within a short window are collected, and sent together in a single
+ *  query, with an IN list. Every caller gets the rows for its own key.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class LoaderBatch;
+
+/**
+ *  Loader class
+ */
+class Loader
+{
+private:
+    /**
+     *  The connection to run the queries on
+     */
+    Connection *_connection;
+
+    /**
+     *  The query before and after the placeholder for the keys
+     */
+    std::string _head;
+    std::string _tail;
+
+    /**
+     *  The digest of the query, the same for every number of keys
+     */
+    std::string _digest;
+
+    /**
+     *  The column the keys are read from
+     */
+    std::string _column;
+
+    /**
+     *  How long keys wait for others, in seconds
+     */
+    double _window;
+
+    /**
+     *  The maximum number of keys in a query
+     */
+    size_t _limit;
+
+    /**
+     *  The maximum number of bytes in a query
+     */
+    size_t _bytes;
+
+    /**
+     *  The keys waiting to be sent
+     */
+    std::shared_ptr<LoaderBatch> _batch;
+
+    /**
+     *  The timer for sending the waiting keys
+     */
+    std::shared_ptr<TimeoutWatcher> _timer;
+
+    /**
+     *  Add a caller for a key
+     *
+     *  @param  key         the key
+     *  @param  integral    is the key a number?
+     */
+    Deferred& add(const std::string& key, bool integral);
+
+    /**
+     *  Send a batch of keys
+     *
+     *  @param  batch       the keys
+     */
+    void send(const std::shared_ptr<LoaderBatch>& batch);
+
+public:
+    /**
+     *  Constructor
+     *
+     *  The query should have a single placeholder, where the list of keys
+     *  is put, for example "SELECT * FROM users WHERE id IN (?)". The keys
+     *  are matched with the values in the column of the rows, bytewise,
+     *  so collations are not taken into account. The limit on the size of
+     *  a query should stay below the max_allowed_packet of the server.
+     *
+     *  @param  connection  the connection to run the queries on
+     *  @param  query       the query with the placeholder for the keys
+     *  @param  column      the column that holds the key of every row
+     *  @param  window      how long keys wait for others, in seconds
+     *  @param  limit       the maximum number of keys in a query
+     *  @param  bytes       the maximum number of bytes in a query
+     *  @throws Exception   when the query does not have a single placeholder
+     */
+    Loader(Connection *connection, const std::string& query, const std::string& column, double window = 0.001, size_t limit = 256, size_t bytes = 1048576);
+
+    /**
+     *  Loaders cannot be copied
+     */
+    Loader(const Loader& that) = delete;
+
+    /**
+     *  Destructor
+     *
+     *  The keys that are still waiting are sent right away.
+     */
+    virtual ~Loader();
+
+    /**
+     *  Look up the rows of a key
+     *
+     *  The result holds the rows that have the key in the column, which
+     *  is an empty result when the key was not found. When more callers
+     *  ask for the same key, it is sent only once. Numbers are sent as
+     *  they are, everything else as an escaped string.
+     *
+     *  @param  key         the key to look up
+     */
+    Deferred& load(const std::string& key)
+    {
+        return add(key, false);
+    }
+
+    /**
+     *  Look up the rows of a numeric key
+     *
+     *  @param  key         the key to look up
+     */
+    template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+    Deferred& load(T key)
+    {
+        return add(std::to_string(key), true);
+    }
+
+    /**
+     *  Send the waiting keys right away
+     */
+    void flush();
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,71 @@
+/**
+ *  LongData.h
+ *
+ *  Prepared statement parameter whose value is produced in
+ *  chunks and streamed to the server before the statement is
+ *  executed, so that it never has to be held in memory in full.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Long data parameter class
+ */
+class LongData
+{
+private:
+    /**
+     *  The producer filling the buffer with the next chunk
+     */
+    std::function<size_t(char *buffer, size_t size)> _producer;
+
+    /**
+     *  The maximum number of bytes to send at once
+     */
+    size_t _chunk;
+public:
+    /**
+     *  Constructor
+     *
+     *  The producer is called from the worker thread with a buffer to
+     *  fill. It returns the number of bytes it wrote to the buffer, and
+     *  zero once the complete value was produced.
+     *
+     *  @param  producer    the producer of the data
+     *  @param  chunk       the maximum number of bytes to send at once
+     */
+    LongData(const std::function<size_t(char *buffer, size_t size)>& producer, size_t chunk = 65536) :
+        _producer(producer),
+        _chunk(chunk)
+    {}
+
+    /**
+     *  The maximum number of bytes to send at once
+     */
+    size_t chunk() const
+    {
+        return _chunk;
+    }
+
+    /**
+     *  Produce the next chunk of data
+     *
+     *  @param  buffer      the buffer to fill
+     *  @param  size        the size of the buffer
+     *  @return the number of bytes produced, zero at the end
+     */
+    size_t produce(char *buffer, size_t size) const
+    {
+        return _producer(buffer, size);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
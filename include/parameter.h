@@ -97,10 +97,25 @@ public:
         buffer_length = value.size();
     }
 
+    /**
+     *  Long data constructor
+     *
+     *  The parameter itself holds no data, the value
+     *  is streamed to the server before execution.
+     */
+    Parameter(const LongData&)
+    {
+        // empty the struct (MySQL dictates it)
+        memset(this, 0, sizeof(*this));
+
+        // set the buffer type
+        buffer_type = MYSQL_TYPE_LONG_BLOB;
+    }
+
     /**
      *  NULL constructor
      */
-    Parameter(std::nullptr_t value)
+    Parameter(std::nullptr_t)
     {
         // empty the struct (MySQL dictates it)
         memset(this, 0, sizeof(*this));
@@ -123,6 +138,28 @@ public:
         // if we have a buffer, free it
         std::free(buffer);
     }
+
+    /**
+     *  The name of the parameter type
+     */
+    const char *type() const
+    {
+        // check the buffer type
+        switch (buffer_type)
+        {
+            case MYSQL_TYPE_TINY:       return is_unsigned ? "unsigned tiny" : "tiny";
+            case MYSQL_TYPE_SHORT:      return is_unsigned ? "unsigned short" : "short";
+            case MYSQL_TYPE_LONG:       return is_unsigned ? "unsigned long" : "long";
+            case MYSQL_TYPE_LONGLONG:   return is_unsigned ? "unsigned longlong" : "longlong";
+            case MYSQL_TYPE_FLOAT:      return "float";
+            case MYSQL_TYPE_DOUBLE:     return "double";
+            case MYSQL_TYPE_STRING:     return "string";
+            case MYSQL_TYPE_BLOB:       return "blob";
+            case MYSQL_TYPE_LONG_BLOB:  return "long data";
+            case MYSQL_TYPE_NULL:       return "null";
+            default:                    return "unknown";
+        }
+    }
 };
 
 /**
@@ -0,0 +1,121 @@
+/**
+ *  Pool.h
+ *
+ *  Class representing a number of connections to the same MySQL or
+ *  MariaDB daemon. Every connection has its own worker thread, so
+ *  queries on the pool run in parallel.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Pool class
+ */
+class Pool
+{
+private:
+    /**
+     *  The connections in the pool
+     */
+    std::vector<std::unique_ptr<Connection>> _connections;
+
+    /**
+     *  Where to start looking for the least busy connection
+     */
+    size_t _next = 0;
+
+public:
+    /**
+     *  Establish the connections
+     *
+     *  @param  loop        the loop to bind to
+     *  @param  hostname    the hostname to connect to
+     *  @param  username    the username to login with
+     *  @param  password    the password to authenticate with
+     *  @param  database    the database to use
+     *  @param  size        the number of connections
+     *  @param  flags       connection flags
+     *  @param  initialize  do we need to initialize (and cleanup) the mysql library
+     */
+    Pool(Loop *loop, const std::string& hostname, const std::string &username, const std::string& password, const std::string& database, size_t size, uint64_t flags = CLIENT_IGNORE_SIGPIPE | CLIENT_MULTI_STATEMENTS, bool initialize = true);
+
+    /**
+     *  Pools cannot be copied
+     */
+    Pool(const Pool& that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Pool();
+
+    /**
+     *  Get a call when a connection succeeds or fails
+     *
+     *  The callback is called once for every connection in the pool.
+     *
+     *  @param  callback    the callback that will be informed of the connection status
+     */
+    void onConnected(const std::function<void(const char *error)>& callback);
+
+    /**
+     *  Track the GTIDs of the transactions committed on all connections
+     */
+    void trackGtids();
+
+    /**
+     *  The number of connections in the pool
+     */
+    size_t size() const;
+
+    /**
+     *  The number of operations waiting or running on all connections
+     */
+    size_t pending() const;
+
+    /**
+     *  Retrieve the connection with the fewest operations in flight
+     *
+     *  Use this to run a transaction or a prepared statement
+     *  on the pool.
+     */
+    Connection& connection();
+
+    /**
+     *  Retrieve the statistics of all connections together
+     */
+    Statistics statistics() const;
+
+    /**
+     *  Execute a query on the least busy connection
+     *
+     *  @param  query       the query to execute
+     *  @param  projection  the columns to materialize
+     */
+    Deferred& query(std::string query, const Projection& projection = Projection())
+    {
+        return connection().query(std::move(query), projection);
+    }
+
+    /**
+     *  Execute a query with placeholders on the least busy connection
+     *
+     *  @param  query       the query to execute
+     *  @param  mixed...    placeholder values
+     */
+    template <class ...Arguments>
+    Deferred& execute(const std::string& query, Arguments ...parameters)
+    {
+        return connection().execute(query, parameters...);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
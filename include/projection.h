@@ -0,0 +1,79 @@
+/**
+ *  Projection.h
+ *
+ *  The set of columns a caller is interested in. Columns
+ *  that fall outside the projection are not materialized
+ *  in the result set.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Projection class
+ */
+class Projection
+{
+private:
+    /**
+     *  The names of the requested columns
+     */
+    std::set<std::string> _columns;
+public:
+    /**
+     *  Empty constructor
+     *
+     *  An empty projection selects all columns
+     */
+    Projection() {}
+
+    /**
+     *  Constructor
+     *
+     *  @param  columns     names of the columns to materialize
+     */
+    Projection(std::initializer_list<std::string> columns) : _columns(columns) {}
+
+    /**
+     *  Constructor
+     *
+     *  @param  columns     names of the columns to materialize
+     */
+    Projection(const std::vector<std::string>& columns) : _columns(columns.begin(), columns.end()) {}
+
+    /**
+     *  Does this projection select all columns?
+     */
+    bool empty() const
+    {
+        return _columns.empty();
+    }
+
+    /**
+     *  The names of the requested columns
+     */
+    const std::set<std::string>& columns() const
+    {
+        return _columns;
+    }
+
+    /**
+     *  Should the given column be materialized?
+     *
+     *  @param  column      name of the column
+     */
+    bool contains(const std::string& column) const
+    {
+        // an empty projection selects everything
+        return _columns.empty() || _columns.count(column);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,67 @@
+/**
+ *  RangeShardMap.h
+ *
+ *  Shard map that divides the hash space in ranges, every range
+ *  belongs to a single shard. To move data, split a range and
+ *  hand one of the halves to another shard.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Range shard map class
+ */
+class RangeShardMap : public ShardMap
+{
+private:
+    /**
+     *  The last hash of every range, with the shard it belongs to
+     */
+    std::vector<std::pair<uint64_t, size_t>> _ranges;
+
+public:
+    /**
+     *  Constructor for an empty map
+     */
+    RangeShardMap() {}
+
+    /**
+     *  Constructor that divides the hash space evenly
+     *
+     *  @param  shards      the number of shards
+     */
+    RangeShardMap(size_t shards);
+
+    /**
+     *  Add a range
+     *
+     *  The range starts right after the range before it, hashes
+     *  after the last range belong to the first range.
+     *
+     *  @param  last        the last hash in the range
+     *  @param  shard       the shard the range belongs to
+     */
+    RangeShardMap& add(uint64_t last, size_t shard);
+
+    /**
+     *  The shard for a hash
+     *
+     *  @param  hash        the hash of the shard key
+     *  @return index of the shard
+     *  @throws Exception   if the map has no ranges
+     */
+    virtual size_t shard(uint64_t hash) const override;
+
+    // the shard for a key
+    using ShardMap::shard;
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -37,6 +37,19 @@ class Result
      */
     uint64_t _insertID = 0;
 
+    /**
+     *  The GTIDs of the transaction that was committed, if tracked
+     */
+    std::string _gtids;
+
+    // the connection and statement classes store the GTIDs
+    friend class Connection;
+    friend class Statement;
+
+    // combined reads share their rows
+    friend class SingleFlight;
+    friend class LoaderBatch;
+
 public:
     /**
      *  Result iterator
@@ -124,6 +137,14 @@ public:
      */
     Result(MYSQL_RES *result);
 
+    /**
+     *  Constructor materializing only some columns
+     *
+     *  @param  result      mysql result
+     *  @param  projection  the columns to materialize
+     */
+    Result(MYSQL_RES *result, const Projection& projection);
+
     /**
      *  Constructor
      */
@@ -173,6 +194,15 @@ public:
      */
     uint64_t insertID() const;
 
+    /**
+     *  The GTIDs of the transaction that was committed by the query
+     *
+     *  This is only filled in when the connection tracks the GTIDs
+     *  (see Connection::trackGtids()), for queries that committed a
+     *  transaction on their own, and for committed transactions.
+     */
+    const std::string& gtids() const;
+
     /**
      *  Get the number of rows in this result
      */
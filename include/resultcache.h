@@ -0,0 +1,283 @@
+/**
+ *  ResultCache.h
+ *
+ *  Cache for the results of queries that read data. Results that are
+ *  found in the cache are passed without going to the worker thread.
+ *  The results are shared by all queries that hit them, and removed
+ *  when they expire, when the cache runs out of space, or when the
+ *  tables they were read from are written.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Dependencies
+ */
+#include <list>
+#include <unordered_map>
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class ResultImpl;
+
+/**
+ *  Result cache class
+ */
+class ResultCache
+{
+private:
+    /**
+     *  What a query does with the data
+     */
+    enum class Access
+    {
+        none,       // nothing we can cache, and nothing that changes data
+        read,       // a read that can be cached
+        write       // a write, to the tables found, or to anything if none were found
+    };
+
+    /**
+     *  A cached result
+     */
+    struct Entry
+    {
+        /**
+         *  The query and projection the result is for
+         */
+        std::string key;
+
+        /**
+         *  The tables the result was read from
+         */
+        std::vector<std::string> tables;
+
+        /**
+         *  The result
+         */
+        std::shared_ptr<ResultImpl> result;
+
+        /**
+         *  The number of bytes the result takes
+         */
+        size_t size;
+
+        /**
+         *  When the result expires, in nanoseconds, or zero if it does not
+         */
+        uint64_t expires;
+    };
+
+    /**
+     *  A query that missed the cache, and whose result can be stored
+     */
+    struct Miss
+    {
+        /**
+         *  The query and projection
+         */
+        std::string key;
+
+        /**
+         *  The tables the query reads from
+         */
+        std::vector<std::string> tables;
+
+        /**
+         *  The number of invalidations before the query was sent
+         */
+        uint64_t version;
+    };
+
+    /**
+     *  The maximum number of bytes to store
+     */
+    size_t _capacity = 0;
+
+    /**
+     *  How long results stay valid, in seconds, or zero for ever
+     */
+    double _ttl = 0.0;
+
+    /**
+     *  The cached results, the most recently used first
+     */
+    std::list<Entry> _entries;
+
+    /**
+     *  The cached results by their query
+     */
+    std::unordered_map<std::string, std::list<Entry>::iterator> _index;
+
+    /**
+     *  The queries of the results read from every table
+     */
+    std::unordered_map<std::string, std::set<std::string>> _tags;
+
+    /**
+     *  The number of bytes stored
+     */
+    size_t _bytes = 0;
+
+    /**
+     *  The number of invalidations so far
+     */
+    uint64_t _version = 0;
+
+    /**
+     *  The number of hits and misses
+     */
+    uint64_t _hits = 0;
+    uint64_t _misses = 0;
+
+    /**
+     *  Remove a cached result
+     *
+     *  @param  entry       the result to remove
+     */
+    void erase(std::list<Entry>::iterator entry);
+
+    /**
+     *  Remove results until they fit in the capacity
+     */
+    void shrink();
+
+    /**
+     *  Look up the result of a query
+     *
+     *  Queries that write invalidate the results read from the tables
+     *  they write to. For queries that read and miss the cache, the
+     *  record to store their result with is filled in.
+     *
+     *  @param  query       the query
+     *  @param  projection  the columns that are materialized
+     *  @param  miss        where to store the record for a missed query
+     *  @return the cached result, or a nullptr
+     */
+    std::shared_ptr<ResultImpl> lookup(const std::string& query, const Projection& projection, std::shared_ptr<Miss>& miss);
+
+    /**
+     *  Store the result of a query that missed the cache
+     *
+     *  The result is not stored when tables were invalidated
+     *  since the query was sent, it may be outdated.
+     *
+     *  @param  miss        the record of the missed query
+     *  @param  result      the result
+     *  @param  size        the number of bytes in the fields of the result
+     */
+    void store(const Miss& miss, const std::shared_ptr<ResultImpl>& result, size_t size);
+
+    /**
+     *  Invalidate the tables written by a query
+     *
+     *  @param  query       the query
+     */
+    void written(const std::string& query);
+
+    /**
+     *  Invalidate the tables written by a query
+     *
+     *  @param  tables      the tables, or none when we do not know which
+     */
+    void invalidate(const std::vector<std::string>& tables);
+
+    /**
+     *  Find out what a query does with the data
+     *
+     *  @param  query       the query to check
+     *  @param  tables      where to store the tables read or written
+     */
+    static Access classify(const std::string& query, std::vector<std::string>& tables);
+
+    /**
+     *  The connection and statements use the cache
+     */
+    friend class Connection;
+    friend class Statement;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  The cache is disabled until a capacity is set.
+     */
+    ResultCache() {}
+
+    /**
+     *  The cache cannot be copied
+     */
+    ResultCache(const ResultCache& that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~ResultCache() {}
+
+    /**
+     *  Set the maximum number of bytes to store
+     *
+     *  A capacity of zero disables the cache. When the cache is full,
+     *  the results that were used least recently are removed.
+     *
+     *  @param  bytes       the maximum number of bytes
+     */
+    ResultCache& capacity(size_t bytes);
+
+    /**
+     *  Set how long results stay valid
+     *
+     *  Only tables written through the same connection invalidate the
+     *  results read from them, so this limits how long writes by other
+     *  clients go unnoticed. This applies to results stored from now on.
+     *
+     *  @param  seconds     the time to live, or zero to keep results until they are invalidated
+     */
+    ResultCache& ttl(double seconds);
+
+    /**
+     *  Remove the results read from a table
+     *
+     *  @param  table       name of the table, without the database
+     */
+    void invalidate(const std::string& table);
+
+    /**
+     *  Remove all results
+     */
+    void clear();
+
+    /**
+     *  Is the cache enabled?
+     */
+    bool enabled() const { return _capacity > 0; }
+
+    /**
+     *  The number of cached results
+     */
+    size_t size() const { return _entries.size(); }
+
+    /**
+     *  The number of bytes stored
+     */
+    size_t bytes() const { return _bytes; }
+
+    /**
+     *  The number of queries served from the cache
+     */
+    uint64_t hits() const { return _hits; }
+
+    /**
+     *  The number of queries that could have been served from the
+     *  cache, but were sent to the server
+     */
+    uint64_t misses() const { return _misses; }
+};
+
+/**
+ *  End namespace
+ */
+}}
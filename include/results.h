@@ -0,0 +1,64 @@
+/**
+ *  Results.h
+ *
+ *  The results of several queries that were combined with whenAll(),
+ *  in the order in which the deferred handlers were passed.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Results class
+ */
+class Results
+{
+private:
+    /**
+     *  The combinator holding the results
+     */
+    Combinator *_combinator;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  combinator  the combinator holding the results
+     */
+    Results(Combinator *combinator) : _combinator(combinator) {}
+
+    /**
+     *  The number of results
+     */
+    size_t size() const
+    {
+        return _combinator->_count;
+    }
+
+    /**
+     *  Retrieve the result at the given position
+     *
+     *  The result may be moved out, it stays valid until
+     *  the callback that received the results returns.
+     *
+     *  @param  index   position of the result
+     *  @throws Exception
+     */
+    Result& operator [] (size_t index)
+    {
+        // check whether the result exists
+        if (index >= _combinator->_count) throw Exception("Invalid result index");
+
+        // retrieve the result
+        return *_combinator->_slots[index].result();
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
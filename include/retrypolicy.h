@@ -0,0 +1,91 @@
+/**
+ *  RetryPolicy.h
+ *
+ *  Policy for retrying a transaction that failed because of lock
+ *  contention: when it ran into a deadlock (ER_LOCK_DEADLOCK) or
+ *  waited too long for a lock (ER_LOCK_WAIT_TIMEOUT), the transaction
+ *  is rolled back and run again by the worker, after a random backoff
+ *  that doubles with every retry.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Retry policy class
+ */
+class RetryPolicy
+{
+private:
+    /**
+     *  The maximum number of retries
+     */
+    size_t _attempts;
+
+    /**
+     *  The backoff before the first retry, in seconds
+     */
+    double _backoff;
+
+    /**
+     *  The maximum backoff, in seconds
+     */
+    double _maximum;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  attempts    the maximum number of retries
+     *  @param  backoff     the backoff before the first retry, in seconds
+     *  @param  maximum     the maximum backoff, in seconds
+     */
+    RetryPolicy(size_t attempts = 0, double backoff = 0.005, double maximum = 0.5) :
+        _attempts(attempts),
+        _backoff(backoff),
+        _maximum(maximum) {}
+
+    /**
+     *  The maximum number of retries
+     */
+    size_t attempts() const { return _attempts; }
+
+    /**
+     *  Is an error worth retrying for?
+     *
+     *  @param  code        the error code from the server
+     */
+    bool retryable(unsigned int code) const
+    {
+        // deadlocks (ER_LOCK_DEADLOCK) and lock wait timeouts (ER_LOCK_WAIT_TIMEOUT)
+        return code == 1213 || code == 1205;
+    }
+
+    /**
+     *  The backoff before a retry
+     *
+     *  The backoff is picked at random up to a limit, that doubles with
+     *  every retry, so transactions that ran into each other spread out.
+     *
+     *  @param  retry       the number of retries done before
+     *  @param  fraction    random value between zero and one
+     *  @return the backoff in nanoseconds
+     */
+    uint64_t delay(size_t retry, double fraction) const
+    {
+        // the limit doubles with every retry
+        double limit = std::min(_maximum, _backoff * std::pow(2.0, (double)retry));
+
+        // pick a moment before the limit
+        return (uint64_t)(fraction * limit * 1000000000.0);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
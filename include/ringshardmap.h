@@ -0,0 +1,70 @@
+/**
+ *  RingShardMap.h
+ *
+ *  Shard map using consistent hashing. Every shard gets a number of
+ *  points on a ring of hashes, and a key belongs to the shard with
+ *  the first point at or after its hash. When a shard is added, it
+ *  only takes keys from the other shards, about an equal share from
+ *  each of them, and the other keys stay where they are.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Ring shard map class
+ */
+class RingShardMap : public ShardMap
+{
+private:
+    /**
+     *  The points on the ring, sorted, with the shard they belong to
+     */
+    std::vector<std::pair<uint64_t, size_t>> _points;
+
+public:
+    /**
+     *  Constructor for an empty ring
+     */
+    RingShardMap() {}
+
+    /**
+     *  Constructor with a number of shards
+     *
+     *  @param  shards      the number of shards
+     *  @param  points      the number of points for every shard
+     */
+    RingShardMap(size_t shards, size_t points = 128);
+
+    /**
+     *  Add a shard to the ring
+     *
+     *  More points give a more even spread of the keys. To give a
+     *  shard a bigger share of the keys, give it more points.
+     *
+     *  @param  shard       the shard to add
+     *  @param  points      the number of points for the shard
+     */
+    RingShardMap& add(size_t shard, size_t points = 128);
+
+    /**
+     *  The shard for a hash
+     *
+     *  @param  hash        the hash of the shard key
+     *  @return index of the shard
+     *  @throws Exception   if the ring is empty
+     */
+    virtual size_t shard(uint64_t hash) const override;
+
+    // the shard for a key
+    using ShardMap::shard;
+};
+
+/**
+ *  End namespace
+ */
+}}
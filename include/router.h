@@ -0,0 +1,201 @@
+/**
+ *  Router.h
+ *
+ *  Class that splits reads and writes over a primary server and its
+ *  replicas. Writes, locking reads and everything that is not clearly
+ *  a read go to the primary. Plain reads go to the replica that is
+ *  expected to answer fastest, given its measured latency and load,
+ *  as long as it does not lag behind the primary too much.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class Replica;
+
+/**
+ *  Router class
+ */
+class Router
+{
+private:
+    /**
+     *  The loop we work with
+     */
+    Loop *_loop;
+
+    /**
+     *  The pool of connections to the primary
+     */
+    Pool *_primary;
+
+    /**
+     *  The replicas, shared with the probes that are on their way
+     */
+    std::vector<std::shared_ptr<Replica>> _replicas;
+
+    /**
+     *  The maximum replication lag for reads, in seconds, zero for no maximum
+     */
+    double _lag = 0.0;
+
+    /**
+     *  The query to measure the replication lag, empty to use the replica status
+     */
+    std::string _query;
+
+    /**
+     *  How long a replica may take to apply the writes of a session, in seconds
+     */
+    double _timeout = 0.05;
+
+    /**
+     *  The timer for probing the replicas
+     */
+    std::shared_ptr<IntervalWatcher> _timer;
+
+    /**
+     *  Measure the latency and replication lag of all replicas
+     */
+    void probe();
+
+    /**
+     *  The replica expected to answer fastest
+     *
+     *  @return the replica, or a nullptr if no replica can take reads
+     */
+    Replica *select();
+
+public:
+    /**
+     *  Constructor
+     *
+     *  The router does not take ownership of the pools,
+     *  they should outlive the router.
+     *
+     *  The router lets the primary track the GTIDs of the transactions
+     *  committed on it, so they can be added to sessions.
+     *
+     *  @param  loop        the loop to bind to
+     *  @param  primary     the pool of connections to the primary
+     */
+    Router(Loop *loop, Pool *primary);
+
+    /**
+     *  Routers cannot be copied
+     */
+    Router(const Router& that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Router();
+
+    /**
+     *  Add a replica
+     *
+     *  @param  replica     the pool of connections to the replica
+     */
+    void add(Pool *replica);
+
+    /**
+     *  Start measuring the latency and replication lag of the replicas
+     *
+     *  Every interval, a probe is sent to every replica. By default, the
+     *  lag is taken from Seconds_Behind_Source (or Seconds_Behind_Master)
+     *  in the replica status, and a server that does not replicate at all
+     *  is taken to have no lag. Alternatively, pass a query that returns
+     *  the lag in seconds, e.g. from a heartbeat table. Replicas that lag
+     *  more than the maximum, or that do not replicate anymore, get no
+     *  reads until they catch up. Pass a zero interval to stop probing.
+     *
+     *  @param  interval    the time between probes, in seconds
+     *  @param  lag         the maximum lag for reads, in seconds, zero for no maximum
+     *  @param  query       the query to measure the lag with
+     */
+    void monitor(double interval, double lag, const std::string& query = std::string());
+
+    /**
+     *  Set how long a replica may take to apply the writes of a session
+     *
+     *  @param  timeout     the time in seconds
+     */
+    void timeout(double timeout);
+
+    /**
+     *  Is a query a plain read, that can run on a replica?
+     *
+     *  @param  query       the query to check
+     */
+    static bool readonly(const std::string& query);
+
+    /**
+     *  Retrieve a connection to the primary
+     *
+     *  Use this to run transactions and prepared statements.
+     */
+    Connection& writer();
+
+    /**
+     *  Retrieve the connection to the replica expected to answer fastest
+     *
+     *  If there is no replica that can take reads, a
+     *  connection to the primary is returned instead.
+     */
+    Connection& reader();
+
+    /**
+     *  Execute a query on the primary or on a replica
+     *
+     *  @param  query       the query to execute
+     *  @param  projection  the columns to materialize
+     */
+    Deferred& query(std::string query, const Projection& projection = Projection())
+    {
+        // find out where the query should go
+        auto &connection = readonly(query) ? reader() : writer();
+
+        // and send it there
+        return connection.query(std::move(query), projection);
+    }
+
+    /**
+     *  Execute a query for a session on the primary or on a replica
+     *
+     *  A read is sent to a replica only after it has applied all writes of
+     *  the session, if it does not get there within the timeout the read
+     *  goes to the primary instead. Add the results of writes (and commits)
+     *  to the session, to make sure they are seen by later reads.
+     *
+     *  @param  query       the query to execute
+     *  @param  session     the session the query is for
+     *  @param  projection  the columns to materialize
+     */
+    Deferred& query(std::string query, const Session& session, const Projection& projection = Projection());
+
+    /**
+     *  Execute a query with placeholders on the primary or on a replica
+     *
+     *  @param  query       the query to execute
+     *  @param  mixed...    placeholder values
+     */
+    template <class ...Arguments>
+    Deferred& execute(const std::string& query, Arguments ...parameters)
+    {
+        // find out where the query should go
+        auto &connection = readonly(query) ? reader() : writer();
+
+        // and send it there
+        return connection.execute(query, parameters...);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,69 @@
+/**
+ *  Session.h
+ *
+ *  Consistency token for reading your own writes from replicas. The
+ *  session collects the GTIDs of the transactions committed by the
+ *  writes of, for example, a single user. A router only sends reads
+ *  for the session to a replica that has applied all of them.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Session class
+ */
+class Session
+{
+private:
+    /**
+     *  The highest transaction number seen for every source
+     */
+    std::map<std::string, uint64_t> _sources;
+
+public:
+    /**
+     *  Constructor
+     */
+    Session() {}
+
+    /**
+     *  Add the transaction committed by a write
+     *
+     *  @param  result      the result of the write
+     */
+    void update(const Result& result);
+
+    /**
+     *  Add the transactions in a GTID set
+     *
+     *  @param  gtids       the GTID set
+     */
+    void update(const std::string& gtids);
+
+    /**
+     *  Did the session commit anything yet?
+     */
+    bool empty() const
+    {
+        return _sources.empty();
+    }
+
+    /**
+     *  The GTID set a replica must have applied to serve the session
+     *
+     *  For every source, all transactions up to the last one of the
+     *  session are included, since a replica that applies transactions
+     *  in parallel may have applied a later one before an earlier one.
+     */
+    std::string gtids() const;
+};
+
+/**
+ *  End namespace
+ */
+}}
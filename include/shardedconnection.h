@@ -0,0 +1,145 @@
+/**
+ *  ShardedConnection.h
+ *
+ *  Class for data that is split over a number of shards, with a pool
+ *  of connections for every shard. Every query carries a shard key,
+ *  which decides the shard it runs on.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Sharded connection class
+ */
+class ShardedConnection
+{
+private:
+    /**
+     *  The pools for the shards
+     */
+    std::vector<Pool*> _shards;
+
+    /**
+     *  The map from keys to shards
+     */
+    std::shared_ptr<const ShardMap> _map;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  The sharded connection does not take ownership of the
+     *  pools, they should outlive the sharded connection.
+     *
+     *  @param  shards      the pools for the shards
+     *  @param  map         the map from keys to shards
+     */
+    ShardedConnection(std::vector<Pool*> shards, std::shared_ptr<const ShardMap> map);
+
+    /**
+     *  Sharded connections cannot be copied
+     */
+    ShardedConnection(const ShardedConnection& that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~ShardedConnection();
+
+    /**
+     *  Install a new shard map
+     *
+     *  Queries that were already sent keep running where they were
+     *  sent, new queries are routed with the new map. To add a shard,
+     *  add its pool first, then install a map that uses it.
+     *
+     *  @param  map         the map from keys to shards
+     */
+    void map(std::shared_ptr<const ShardMap> map);
+
+    /**
+     *  The current shard map
+     */
+    const std::shared_ptr<const ShardMap>& map() const;
+
+    /**
+     *  Add the pool for a shard
+     *
+     *  @param  shard       the pool for the shard
+     *  @return index of the shard
+     */
+    size_t add(Pool *shard);
+
+    /**
+     *  The pool for a shard key
+     *
+     *  @param  key         the shard key
+     *  @throws Exception   if the map refers to a shard that does not exist
+     */
+    Pool& pool(const std::string& key);
+
+    /**
+     *  The least busy connection for a shard key
+     *
+     *  Use this to run transactions on a shard.
+     *
+     *  @param  key         the shard key
+     *  @throws Exception   if the map refers to a shard that does not exist
+     */
+    Connection& connection(const std::string& key)
+    {
+        return pool(key).connection();
+    }
+
+    /**
+     *  Retrieve a cached statement for a shard key
+     *
+     *  As with all cached statements, the statement should be a string
+     *  literal, since statements are cached by their address.
+     *
+     *  @param  key         the shard key
+     *  @param  statement   the statement to execute
+     *  @throws Exception   if the map refers to a shard that does not exist
+     */
+    CachedStatement statement(const std::string& key, const char *statement)
+    {
+        return CachedStatement(&connection(key), statement);
+    }
+
+    /**
+     *  Execute a query on the shard for a key
+     *
+     *  @param  key         the shard key
+     *  @param  query       the query to execute
+     *  @param  projection  the columns to materialize
+     *  @throws Exception   if the map refers to a shard that does not exist
+     */
+    Deferred& query(const std::string& key, std::string query, const Projection& projection = Projection())
+    {
+        return connection(key).query(std::move(query), projection);
+    }
+
+    /**
+     *  Execute a query with placeholders on the shard for a key
+     *
+     *  @param  key         the shard key
+     *  @param  query       the query to execute
+     *  @param  mixed...    placeholder values
+     *  @throws Exception   if the map refers to a shard that does not exist
+     */
+    template <class ...Arguments>
+    Deferred& execute(const std::string& key, const std::string& query, Arguments ...parameters)
+    {
+        return connection(key).execute(query, parameters...);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
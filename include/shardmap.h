@@ -0,0 +1,61 @@
+/**
+ *  ShardMap.h
+ *
+ *  Base class for mapping shard keys to shards. Keys are hashed, and
+ *  the implementation decides which shard a hash belongs to. Shard maps
+ *  are immutable once they are in use: to change the mapping, build a
+ *  new map and install it on the sharded connection.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Shard map class
+ */
+class ShardMap
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~ShardMap() {}
+
+    /**
+     *  Hash a shard key
+     *
+     *  This is 64-bit FNV-1a, with the bits mixed afterwards so
+     *  that keys that differ only at the end still spread evenly.
+     *
+     *  @param  key         the shard key
+     */
+    static uint64_t hash(const std::string& key);
+
+    /**
+     *  The shard for a hash
+     *
+     *  @param  hash        the hash of the shard key
+     *  @return index of the shard
+     */
+    virtual size_t shard(uint64_t hash) const = 0;
+
+    /**
+     *  The shard for a key
+     *
+     *  @param  key         the shard key
+     *  @return index of the shard
+     */
+    size_t shard(const std::string& key) const
+    {
+        return shard(hash(key));
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
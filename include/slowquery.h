@@ -0,0 +1,142 @@
+/**
+ *  SlowQuery.h
+ *
+ *  Information about a query or statement that took
+ *  longer to run than the configured threshold
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Slow query class
+ */
+class SlowQuery
+{
+private:
+    /**
+     *  The query as it was sent, or the statement template
+     */
+    std::string _query;
+
+    /**
+     *  The digest of the query
+     */
+    std::string _digest;
+
+    /**
+     *  The parameter types, for prepared statements
+     */
+    std::vector<std::string> _parameters;
+
+    /**
+     *  The time spent per phase, in nanoseconds
+     */
+    uint64_t _queued;
+    uint64_t _execution;
+    uint64_t _fetch;
+
+    /**
+     *  The number of rows sent to and examined by the server
+     */
+    uint64_t _sent;
+    int64_t _examined = -1;
+
+    /**
+     *  The query plan, when sampled
+     */
+    std::string _explain;
+
+    /**
+     *  The error, if the query failed
+     */
+    std::string _error;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  query       the query or statement template
+     *  @param  digest      the digest of the query
+     *  @param  parameters  the parameter types
+     *  @param  queued      time spent before the query was sent to the server
+     *  @param  execution   time spent executing the query
+     *  @param  fetch       time spent fetching the result
+     *  @param  sent        number of rows received
+     *  @param  error       the error, or a nullptr on success
+     */
+    SlowQuery(std::string query, std::string digest, std::vector<std::string> parameters, uint64_t queued, uint64_t execution, uint64_t fetch, uint64_t sent, const char *error) :
+        _query(std::move(query)),
+        _digest(std::move(digest)),
+        _parameters(std::move(parameters)),
+        _queued(queued),
+        _execution(execution),
+        _fetch(fetch),
+        _sent(sent),
+        _error(error ? error : "") {}
+
+    /**
+     *  The query as it was sent, or the template of a prepared statement
+     */
+    const std::string& query() const { return _query; }
+
+    /**
+     *  The digest of the query
+     */
+    const std::string& digest() const { return _digest; }
+
+    /**
+     *  The types of the parameters, for prepared statements
+     */
+    const std::vector<std::string>& parameters() const { return _parameters; }
+
+    /**
+     *  The time spent waiting before the query was sent to the server
+     */
+    uint64_t queued() const { return _queued; }
+
+    /**
+     *  The time the server spent executing the query
+     */
+    uint64_t execution() const { return _execution; }
+
+    /**
+     *  The time spent fetching the result
+     */
+    uint64_t fetch() const { return _fetch; }
+
+    /**
+     *  The number of rows sent by the server
+     */
+    uint64_t rowsSent() const { return _sent; }
+
+    /**
+     *  The number of rows examined by the server, this is
+     *  read from the performance schema, and is negative
+     *  when the performance schema is not available.
+     */
+    int64_t rowsExamined() const { return _examined; }
+
+    /**
+     *  The query plan in json format, or an empty
+     *  string if the query was not sampled
+     */
+    const std::string& explain() const { return _explain; }
+
+    /**
+     *  The error, or an empty string on success
+     */
+    const std::string& error() const { return _error; }
+
+    // the connection fills in the server side information
+    friend class Connection;
+};
+
+/**
+ *  End namespace
+ */
+}}
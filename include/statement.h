@@ -40,6 +40,23 @@ private:
      */
     std::function<void(const char *error)> _prepareCallback;
 
+    /**
+     *  The columns to materialize in the result
+     */
+    Projection _projection;
+
+    /**
+     *  The digest of the statement
+     */
+    std::string _digest;
+
+    /**
+     *  The tables the statement reads or writes, and what it does with
+     *  them, which is found out once instead of for every execution
+     */
+    std::vector<std::string> _tables;
+    ResultCache::Access _access;
+
     /**
      *  The number of parameters in this statement
      */
@@ -56,9 +73,9 @@ private:
      *  @note:  This function is to be executed from
      *          worker context only
      *
-     *  @param  reference   The loop reference to stay alive
+     *  @param  reference   The token keeping the loop alive
      */
-    void initialize(const std::shared_ptr<React::LoopReference> &reference);
+    void initialize(const InFlight &reference);
 
     /**
      *  Execute statement with given parameters
@@ -68,18 +85,103 @@ private:
      *
      *  @param  parameters  The parameters to retry with
      *  @param  count       The number of parameters
-     *  @param  reference   The loop reference
+     *  @param  reference   The token keeping the loop alive
      *  @param  deferred    The previously created deferred handler
+     *  @param  column      Name of the column to stream, if any
+     *  @param  sink        The sink to stream the column to, if any
+     *  @param  streams     The long data parameters and their index
+     *  @param  submitted   The moment the statement was submitted
+     *  @param  id          The id of the execution, for tracing
+     */
+    void execute(Parameter *parameters, size_t count, const InFlight &reference, const std::shared_ptr<Deferred> &deferred, const std::string &column, const std::shared_ptr<ColumnSink> &sink, const std::vector<std::pair<unsigned int, LongData>> &streams, uint64_t submitted, uint64_t id);
+
+    /**
+     *  Explain the statement with the given parameters
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  parameters  The parameters to explain with
+     *  @return the query plan in json format, or an empty string
+     */
+    std::string explain(Parameter *parameters);
+
+    /**
+     *  Report a slow execution of the statement
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  parameters  The parameters the statement was executed with
+     *  @param  count       The number of parameters
+     *  @param  reference   The token keeping the loop alive
+     *  @param  queued      Time spent before the statement was sent to the server
+     *  @param  execution   Time spent executing the statement
+     *  @param  fetch       Time spent fetching the result
+     *  @param  rows        The number of rows received
+     *  @param  error       The error, or a nullptr on success
+     *  @param  explainable Can the statement be explained with these parameters
+     */
+    void report(Parameter *parameters, size_t count, const InFlight &reference, uint64_t queued, uint64_t execution, uint64_t fetch, uint64_t rows, const char *error, bool explainable);
+
+    /**
+     *  Submit the statement for execution in the worker thread
+     *
+     *  @param  parameters  The parameters to execute with
+     *  @param  count       The number of parameters
+     *  @param  column      Name of the column to stream, if any
+     *  @param  sink        The sink to stream the column to, if any
+     *  @param  streams     The long data parameters and their index
      */
-    void execute(Parameter *parameters, size_t count, const std::shared_ptr<React::LoopReference> &reference, const std::shared_ptr<Deferred> &deferred);
+    Deferred& submit(Parameter *parameters, size_t count, const std::string &column, const std::shared_ptr<ColumnSink> &sink, const std::vector<std::pair<unsigned int, LongData>> &streams);
+
+    /**
+     *  Send the long data parameters to the server
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  streams     The long data parameters and their index
+     *  @return did we succeed in sending all data
+     */
+    bool send(const std::vector<std::pair<unsigned int, LongData>> &streams);
+
+    /**
+     *  Collect the long data parameters from the arguments
+     *
+     *  @param  streams     The long data parameters collected so far
+     *  @param  index       The index of the next argument
+     *  @param  mixed...    The remaining arguments
+     */
+    static void collect(std::vector<std::pair<unsigned int, LongData>> &, unsigned int) {}
+
+    template <class Argument, class ...Arguments>
+    static void collect(std::vector<std::pair<unsigned int, LongData>> &streams, unsigned int index, const Argument &, const Arguments &...arguments)
+    {
+        // not a long data parameter, skip to the next
+        collect(streams, index + 1, arguments...);
+    }
+
+    template <class ...Arguments>
+    static void collect(std::vector<std::pair<unsigned int, LongData>> &streams, unsigned int index, const LongData &argument, const Arguments &...arguments)
+    {
+        // remember the long data parameter and where it lives
+        streams.emplace_back(index, argument);
+        collect(streams, index + 1, arguments...);
+    }
 public:
     /**
      *  Constructor
      *
+     *  When a projection is given, only the named columns are
+     *  materialized in the result. The other columns are bound
+     *  with zero-length buffers, so their data is never copied.
+     *
      *  @param  connection  the connection to run the statement on
      *  @param  statement   the statement to execute
+     *  @param  projection  the columns to materialize
      */
-    Statement(Connection *connection, std::string statement);
+    Statement(Connection *connection, std::string statement, Projection projection = Projection());
 
     /**
      *  Copy constructor
@@ -126,6 +228,7 @@ public:
      *  double              DOUBLE
      *  std::string         TEXT, CHAR or VARCHAR
      *  std::vector<char>   BLOB, BINARY or VARBINARY
+     *  LongData            BLOB or TEXT, streamed to the server in chunks
      *  std::nullptr_t      NULL
      *
      *  @param  mixed...    variable number of arguments of different type
@@ -134,21 +237,39 @@ public:
     template <class ...Arguments>
     Deferred& execute(Arguments ...params)
     {
-        // create the deferred handler
-        auto deferred = std::make_shared<Deferred>();
+        // find the parameters that are streamed separately
+        std::vector<std::pair<unsigned int, LongData>> streams;
+        collect(streams, 0, params...);
 
-        // keep the loop alive while the callback runs
-        auto reference = std::make_shared<React::LoopReference>(_connection->_loop);
-
-        // allocate the parameters
-        auto count = sizeof...(params);
-        auto *parameters = new Parameter[sizeof...(params)]{ params... };
+        // allocate the parameters and pass them to the worker
+        return submit(new Parameter[sizeof...(params)]{ params... }, sizeof...(params), std::string(), nullptr, streams);
+    }
 
-        // execute statement in worker thread
-        _connection->_worker.execute([this, reference, parameters, count, deferred]() { execute(parameters, count, reference, deferred); });
+    /**
+     *  Execute the statement, and stream one of the columns to a sink
+     *
+     *  The named column is not materialized in the result. Instead, the
+     *  value of every row is read in chunks (of the size the sink asks
+     *  for) and passed to the sink, so even huge BLOB or TEXT values never
+     *  need a buffer bigger than a single chunk. The result that is passed
+     *  to the success callback holds the other columns, in which the
+     *  streamed column is NULL.
+     *
+     *  Note that the sink is called from the worker thread.
+     *
+     *  @param  column      name of the column to stream
+     *  @param  sink        the sink to pass the column data to
+     *  @param  mixed...    variable number of arguments of different type
+     */
+    template <class ...Arguments>
+    Deferred& stream(const std::string& column, const std::shared_ptr<ColumnSink>& sink, Arguments ...params)
+    {
+        // find the parameters that are streamed separately
+        std::vector<std::pair<unsigned int, LongData>> streams;
+        collect(streams, 0, params...);
 
-        // return the deferred handler
-        return *deferred;
+        // allocate the parameters and pass them to the worker
+        return submit(new Parameter[sizeof...(params)]{ params... }, sizeof...(params), column, sink, streams);
     }
 };
 
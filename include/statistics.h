@@ -0,0 +1,160 @@
+/**
+ *  Statistics.h
+ *
+ *  Snapshot of the statistics of a connection: latency
+ *  histograms for every phase a query goes through, and
+ *  counters for the traffic it caused.
+ *
+ *  Snapshots of several connections (e.g. the members of a
+ *  pool) can be added together to get aggregate statistics.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Statistics class
+ */
+class Statistics
+{
+private:
+    /**
+     *  Time spent waiting for the worker to pick up a query
+     */
+    Histogram _queued;
+
+    /**
+     *  Time the server spent executing a query
+     */
+    Histogram _execution;
+
+    /**
+     *  Time spent fetching the result
+     */
+    Histogram _fetch;
+
+    /**
+     *  Time between the worker handing over a
+     *  result and the callback being invoked
+     */
+    Histogram _handoff;
+
+    /**
+     *  The number of queries and statements executed
+     */
+    uint64_t _queries = 0;
+
+    /**
+     *  The number of rows received
+     */
+    uint64_t _rows = 0;
+
+    /**
+     *  The number of bytes of field data received
+     */
+    uint64_t _bytes = 0;
+
+    /**
+     *  The number of failed operations
+     */
+    uint64_t _errors = 0;
+
+    /**
+     *  The number of times the connection was reestablished
+     */
+    uint64_t _reconnects = 0;
+
+    /**
+     *  The number of times a transaction was retried
+     */
+    uint64_t _retries = 0;
+
+public:
+    /**
+     *  Time spent waiting for the worker to pick up a query
+     */
+    const Histogram& queued() const { return _queued; }
+
+    /**
+     *  Time the server spent executing a query
+     */
+    const Histogram& execution() const { return _execution; }
+
+    /**
+     *  Time spent fetching the result
+     */
+    const Histogram& fetch() const { return _fetch; }
+
+    /**
+     *  Time between the worker handing over a
+     *  result and the callback being invoked
+     */
+    const Histogram& handoff() const { return _handoff; }
+
+    /**
+     *  The number of queries and statements executed
+     */
+    uint64_t queries() const { return _queries; }
+
+    /**
+     *  The number of rows received
+     */
+    uint64_t rows() const { return _rows; }
+
+    /**
+     *  The number of bytes of field data received
+     */
+    uint64_t bytes() const { return _bytes; }
+
+    /**
+     *  The number of failed operations
+     */
+    uint64_t errors() const { return _errors; }
+
+    /**
+     *  The number of times the connection was reestablished
+     */
+    uint64_t reconnects() const { return _reconnects; }
+
+    /**
+     *  The number of times a transaction was retried
+     */
+    uint64_t retries() const { return _retries; }
+
+    /**
+     *  Add the statistics of another connection
+     *
+     *  @param  that    the statistics to add
+     */
+    Statistics& operator+=(const Statistics& that)
+    {
+        // merge all histograms
+        _queued     += that._queued;
+        _execution  += that._execution;
+        _fetch      += that._fetch;
+        _handoff    += that._handoff;
+
+        // and all counters
+        _queries    += that._queries;
+        _rows       += that._rows;
+        _bytes      += that._bytes;
+        _errors     += that._errors;
+        _reconnects += that._reconnects;
+        _retries    += that._retries;
+
+        // allow chaining
+        return *this;
+    }
+
+    // the recorder creates the snapshots
+    friend class StatisticsRecorder;
+};
+
+/**
+ *  End namespace
+ */
+}}
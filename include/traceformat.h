@@ -0,0 +1,35 @@
+/**
+ *  TraceFormat.h
+ *
+ *  The formats in which query traces can be written. Every span
+ *  holds the trace id of the deferred, the connection id, the query
+ *  id and the moments (in nanoseconds since the epoch) the query was
+ *  enqueued, picked up by the worker, executed, fetched and delivered.
+ *  Phases that did not happen are zero.
+ *
+ *  json    one json object per line
+ *  binary  eight 64-bit integers in host byte order per span, in
+ *          the order: trace, connection, query, enqueue, start,
+ *          execute, fetch and deliver
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  The trace formats
+ */
+enum class TraceFormat
+{
+    json,
+    binary
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,130 @@
+/**
+ *  Transaction.h
+ *
+ *  Class for running a number of statements in a transaction
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+// forward declaration
+class TransactionWork;
+class TransactionSession;
+
+/**
+ *  Transaction class
+ */
+class Transaction
+{
+private:
+    /**
+     *  The connection the transaction runs on
+     */
+    Connection *_connection;
+
+    /**
+     *  The statements collected so far, or a nullptr
+     *  when the transaction was already finished
+     */
+    std::unique_ptr<TransactionWork> _work;
+
+    /**
+     *  The transaction on the server, when the statements
+     *  are run as they are added instead of at the commit
+     */
+    std::shared_ptr<TransactionSession> _session;
+
+    /**
+     *  Hand the transaction to the connection
+     *
+     *  @param  commit      should the transaction be committed?
+     */
+    Deferred& finish(bool commit);
+public:
+    /**
+     *  Start a transaction
+     *
+     *  @param  connection  the connection to run the transaction on
+     */
+    Transaction(Connection *connection);
+
+    /**
+     *  Transactions cannot be copied
+     */
+    Transaction(const Transaction& that) = delete;
+
+    /**
+     *  Destructor
+     *
+     *  A transaction that was not committed is rolled back.
+     */
+    virtual ~Transaction();
+
+    /**
+     *  Add a query to the transaction
+     *
+     *  The query is run right away, and the deferred handler gets its
+     *  result before the transaction is committed. From the moment the
+     *  worker starts the transaction, until it is committed or rolled
+     *  back, the worker runs nothing else, so no other queries on the
+     *  connection can end up in it: do not wait for such queries before
+     *  finishing the transaction. Once a query fails, the queries that
+     *  follow fail as well, and the transaction can only be rolled back.
+     *
+     *  With group commit enabled, or with a retry policy, the queries
+     *  are not sent right away: they are all sent together when the
+     *  transaction is committed. The deferred handler is then informed
+     *  after the transaction was committed, or fails when the
+     *  transaction is rolled back.
+     *
+     *  @param  query       the query to execute
+     *  @throws Exception   when the transaction was already finished
+     */
+    Deferred& query(std::string query);
+
+    /**
+     *  Retry the transaction when it fails because of lock contention
+     *
+     *  When the transaction runs into a deadlock or a lock wait timeout,
+     *  it is rolled back and run again by the worker, after a backoff,
+     *  until it succeeds or the retries run out. The deferred handlers
+     *  are only informed of the final outcome. To be able to run them
+     *  again, the queries are collected and sent when the transaction
+     *  is committed, so the policy must be set before the first query.
+     *
+     *  @param  policy      the retry policy
+     *  @throws Exception   when the transaction was already finished, or a query was already sent
+     */
+    Transaction& retry(const RetryPolicy& policy);
+
+    /**
+     *  Commit the transaction
+     *
+     *  The deferred handler gets a result with the number of rows
+     *  affected by all queries, or the error that caused the
+     *  transaction to be rolled back.
+     *
+     *  @throws Exception   when the transaction was already finished
+     */
+    Deferred& commit();
+
+    /**
+     *  Roll back the transaction
+     *
+     *  The queries that were run are undone. Queries that were
+     *  collected are not sent to the server, their deferred
+     *  handlers fail.
+     *
+     *  @throws Exception   when the transaction was already finished
+     */
+    Deferred& rollback();
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,177 @@
+/**
+ *  WhenAll.h
+ *
+ *  Wait for several queries, possibly on different connections, and
+ *  get all their results in one callback:
+ *
+ *      React::MySQL::whenAll(users.query("SELECT * FROM users"), orders.query("SELECT * FROM orders"))
+ *          .onSuccess([](React::MySQL::Results&& results) { ... })
+ *          .onFailure([](const char *error) { ... });
+ *
+ *  The deferred handlers are taken over: their own callbacks are no
+ *  longer executed. The first failure is reported right away, the
+ *  results of the other queries are then discarded.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  WhenAll class
+ */
+class WhenAll : public Combinator
+{
+private:
+    /**
+     *  Callback to execute when all queries succeeded
+     */
+    std::function<void(Results&& results)> _successCallback;
+
+    /**
+     *  Constructor
+     *
+     *  @param  slots       storage for the slots
+     *  @param  count       the number of slots
+     */
+    WhenAll(void *slots, size_t count) : Combinator(slots, count) {}
+
+    /**
+     *  Process the outcome of a handler
+     *
+     *  @param  slot        the slot of the handler
+     *  @param  result      the result, on success
+     *  @param  error       the error, on failure
+     */
+    virtual void settle(Slot &slot, Result *result, const char *error) override
+    {
+        // the first failure is the outcome
+        if (error) return fail(error);
+
+        // store the result, an operation without status gives an invalid result
+        if (result) new (&slot.storage) Result(std::move(*result));
+        else new (&slot.storage) Result(nullptr);
+        slot.filled = true;
+
+        // are we still waiting for other results?
+        if (_pending > 0) return;
+
+        // this is the outcome
+        _finished = true;
+
+        // execute the callbacks
+        if (_successCallback)   _successCallback(Results(this));
+        if (_completeCallback)  _completeCallback();
+    }
+
+    /**
+     *  Wait for a range of deferred handlers
+     *
+     *  @param  begin       the first handler
+     *  @param  end         past the last handler
+     *  @param  count       the number of handlers
+     *  @throws Exception
+     */
+    template <typename Iterator>
+    static WhenAll& create(Iterator begin, Iterator end, size_t count)
+    {
+        // without handlers there would be nothing to wait for
+        if (count == 0) throw Exception("No deferred handlers to wait for");
+
+        // allocate the combinator and its slots
+        auto *combinator = allocate<WhenAll>(count);
+
+        // and watch all handlers
+        combinator->watch(begin, end);
+
+        // done
+        return *combinator;
+    }
+
+    // the combinator constructs us
+    friend class Combinator;
+
+    // the functions that create us
+    friend WhenAll& whenAll(std::initializer_list<std::reference_wrapper<Deferred>> deferreds);
+    friend WhenAll& whenAll(const std::vector<Deferred*>& deferreds);
+
+public:
+    /**
+     *  Register a callback to be executed when all queries succeed
+     *
+     *  @param  callback    the callback to execute on success
+     */
+    WhenAll& onSuccess(const std::function<void(Results&& results)>& callback)
+    {
+        // store callback
+        _successCallback = callback;
+        return *this;
+    }
+
+    /**
+     *  Register a callback to be executed when one of the queries fails
+     *
+     *  @param  callback    the callback to execute on failure
+     */
+    WhenAll& onFailure(const std::function<void(const char *error)>& callback)
+    {
+        // store callback
+        _failureCallback = callback;
+        return *this;
+    }
+
+    /**
+     *  Register a callback to be executed when the outcome is known,
+     *  whether successful or not.
+     *
+     *  @param  callback    the callback to execute when the operation completes
+     */
+    WhenAll& onComplete(const std::function<void()>& callback)
+    {
+        // store callback
+        _completeCallback = callback;
+        return *this;
+    }
+};
+
+/**
+ *  Wait for all deferred handlers in a list
+ *
+ *  @param  deferreds   the handlers to wait for
+ *  @throws Exception
+ */
+inline WhenAll& whenAll(std::initializer_list<std::reference_wrapper<Deferred>> deferreds)
+{
+    return WhenAll::create(deferreds.begin(), deferreds.end(), deferreds.size());
+}
+
+/**
+ *  Wait for all deferred handlers in a vector
+ *
+ *  @param  deferreds   the handlers to wait for
+ *  @throws Exception
+ */
+inline WhenAll& whenAll(const std::vector<Deferred*>& deferreds)
+{
+    return WhenAll::create(deferreds.begin(), deferreds.end(), deferreds.size());
+}
+
+/**
+ *  Wait for all deferred handlers that are passed
+ *
+ *  @param  deferred    the first handler to wait for
+ *  @param  deferreds   the other handlers
+ */
+template <typename ...Deferreds>
+WhenAll& whenAll(Deferred& deferred, Deferreds&... deferreds)
+{
+    return whenAll({ std::ref(deferred), std::ref(deferreds)... });
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,169 @@
+/**
+ *  WhenAny.h
+ *
+ *  Wait for several queries, possibly on different connections, and
+ *  get the outcome of whichever finishes first:
+ *
+ *      React::MySQL::whenAny(primary.query("SELECT ..."), replica.query("SELECT ..."))
+ *          .onSuccess([](size_t index, React::MySQL::Result&& result) { ... })
+ *          .onFailure([](const char *error) { ... });
+ *
+ *  The deferred handlers are taken over: their own callbacks are no
+ *  longer executed. The outcome of the first query to finish, success
+ *  or failure, is reported, the outcome of the others is discarded.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  WhenAny class
+ */
+class WhenAny : public Combinator
+{
+private:
+    /**
+     *  Callback to execute when the first query succeeded
+     */
+    std::function<void(size_t index, Result&& result)> _successCallback;
+
+    /**
+     *  Constructor
+     *
+     *  @param  slots       storage for the slots
+     *  @param  count       the number of slots
+     */
+    WhenAny(void *slots, size_t count) : Combinator(slots, count) {}
+
+    /**
+     *  Process the outcome of a handler
+     *
+     *  @param  slot        the slot of the handler
+     *  @param  result      the result, on success
+     *  @param  error       the error, on failure
+     */
+    virtual void settle(Slot &slot, Result *result, const char *error) override
+    {
+        // a failure is the outcome
+        if (error) return fail(error);
+
+        // and so is a result
+        _finished = true;
+
+        // execute the callbacks, an operation without status gives an invalid result
+        if (_successCallback)   _successCallback(slot.index, result ? std::move(*result) : Result(nullptr));
+        if (_completeCallback)  _completeCallback();
+    }
+
+    /**
+     *  Wait for a range of deferred handlers
+     *
+     *  @param  begin       the first handler
+     *  @param  end         past the last handler
+     *  @param  count       the number of handlers
+     *  @throws Exception
+     */
+    template <typename Iterator>
+    static WhenAny& create(Iterator begin, Iterator end, size_t count)
+    {
+        // without handlers there would be nothing to wait for
+        if (count == 0) throw Exception("No deferred handlers to wait for");
+
+        // allocate the combinator and its slots
+        auto *combinator = allocate<WhenAny>(count);
+
+        // and watch all handlers
+        combinator->watch(begin, end);
+
+        // done
+        return *combinator;
+    }
+
+    // the combinator constructs us
+    friend class Combinator;
+
+    // the functions that create us
+    friend WhenAny& whenAny(std::initializer_list<std::reference_wrapper<Deferred>> deferreds);
+    friend WhenAny& whenAny(const std::vector<Deferred*>& deferreds);
+
+public:
+    /**
+     *  Register a callback to be executed when the first query to finish succeeds
+     *
+     *  @param  callback    the callback to execute on success
+     */
+    WhenAny& onSuccess(const std::function<void(size_t index, Result&& result)>& callback)
+    {
+        // store callback
+        _successCallback = callback;
+        return *this;
+    }
+
+    /**
+     *  Register a callback to be executed when the first query to finish fails
+     *
+     *  @param  callback    the callback to execute on failure
+     */
+    WhenAny& onFailure(const std::function<void(const char *error)>& callback)
+    {
+        // store callback
+        _failureCallback = callback;
+        return *this;
+    }
+
+    /**
+     *  Register a callback to be executed when the outcome is known,
+     *  whether successful or not.
+     *
+     *  @param  callback    the callback to execute when the operation completes
+     */
+    WhenAny& onComplete(const std::function<void()>& callback)
+    {
+        // store callback
+        _completeCallback = callback;
+        return *this;
+    }
+};
+
+/**
+ *  Wait for the first of the deferred handlers in a list
+ *
+ *  @param  deferreds   the handlers to wait for
+ *  @throws Exception
+ */
+inline WhenAny& whenAny(std::initializer_list<std::reference_wrapper<Deferred>> deferreds)
+{
+    return WhenAny::create(deferreds.begin(), deferreds.end(), deferreds.size());
+}
+
+/**
+ *  Wait for the first of the deferred handlers in a vector
+ *
+ *  @param  deferreds   the handlers to wait for
+ *  @throws Exception
+ */
+inline WhenAny& whenAny(const std::vector<Deferred*>& deferreds)
+{
+    return WhenAny::create(deferreds.begin(), deferreds.end(), deferreds.size());
+}
+
+/**
+ *  Wait for the first of the deferred handlers that are passed
+ *
+ *  @param  deferred    the first handler to wait for
+ *  @param  deferreds   the other handlers
+ */
+template <typename ...Deferreds>
+WhenAny& whenAny(Deferred& deferred, Deferreds&... deferreds)
+{
+    return whenAny({ std::ref(deferred), std::ref(deferreds)... });
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -19,18 +19,50 @@
 #include <cstring>
 #include <ctime>
 #include <vector>
+#include <set>
+#include <map>
 #include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <mutex>
 
 /**
  *  Other include files
  */
 #include <reactcpp/mysql/deferred.h>
 #include <reactcpp/mysql/exception.h>
+#include <reactcpp/mysql/projection.h>
+#include <reactcpp/mysql/columnsink.h>
+#include <reactcpp/mysql/histogram.h>
+#include <reactcpp/mysql/statistics.h>
+#include <reactcpp/mysql/digest.h>
+#include <reactcpp/mysql/slowquery.h>
+#include <reactcpp/mysql/traceformat.h>
 #include <reactcpp/mysql/resultfield.h>
 #include <reactcpp/mysql/resultrow.h>
 #include <reactcpp/mysql/result.h>
+#include <reactcpp/mysql/combinator.h>
+#include <reactcpp/mysql/results.h>
+#include <reactcpp/mysql/whenall.h>
+#include <reactcpp/mysql/whenany.h>
+#include <reactcpp/mysql/longdata.h>
 #include <reactcpp/mysql/parameter.h>
 #include <reactcpp/mysql/localparameter.h>
+#include <reactcpp/mysql/resultcache.h>
 #include <reactcpp/mysql/connection.h>
 #include <reactcpp/mysql/statement.h>
 #include <reactcpp/mysql/cachedstatement.h>
+#include <reactcpp/mysql/retrypolicy.h>
+#include <reactcpp/mysql/transaction.h>
+#include <reactcpp/mysql/pool.h>
+#include <reactcpp/mysql/session.h>
+#include <reactcpp/mysql/router.h>
+#include <reactcpp/mysql/shardmap.h>
+#include <reactcpp/mysql/rangeshardmap.h>
+#include <reactcpp/mysql/ringshardmap.h>
+#include <reactcpp/mysql/shardedconnection.h>
+#include <reactcpp/mysql/fanout.h>
+#include <reactcpp/mysql/binlogchange.h>
+#include <reactcpp/mysql/binlogreader.h>
+#include <reactcpp/mysql/loader.h>
@@ -0,0 +1,80 @@
+/**
+ *  Address.h
+ *
+ *  The address of a server, as it is passed to the connections: a
+ *  hostname, optionally followed by a port ("127.0.0.1:3307"), or the
+ *  path to the unix socket of the server.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Address class
+ */
+class Address
+{
+private:
+    /**
+     *  The host to connect to
+     */
+    std::string _host;
+
+    /**
+     *  The unix socket to connect to
+     */
+    std::string _socket;
+
+    /**
+     *  The port to connect to, or zero for the default
+     */
+    unsigned int _port = 0;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  hostname    the hostname, with an optional port, or the path to a socket
+     */
+    Address(const std::string& hostname) : _host(hostname)
+    {
+        // is this the path to a socket?
+        if (!_host.empty() && _host[0] == '/')
+        {
+            _socket.swap(_host);
+            return;
+        }
+
+        // a single colon separates the port, addresses with more colons are IPv6
+        auto colon = _host.find(':');
+        if (colon == std::string::npos || colon != _host.rfind(':')) return;
+
+        // split off the port
+        _port = std::strtoul(_host.c_str() + colon + 1, nullptr, 10);
+        _host.resize(colon);
+    }
+
+    /**
+     *  The host to connect to
+     */
+    const char *host() const { return _host.c_str(); }
+
+    /**
+     *  The unix socket to connect to, or a nullptr
+     */
+    const char *socket() const { return _socket.empty() ? nullptr : _socket.c_str(); }
+
+    /**
+     *  The port to connect to, or zero for the default
+     */
+    unsigned int port() const { return _port; }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,775 @@
+/**
+ *  BinlogDecoder.h
+ *
+ *  Decodes the events of a binary log stream into changes. The row
+ *  events are not decoded completely: the values are skipped, only the
+ *  rows are counted. The changes of a transaction are collected until
+ *  the transaction commits, rolled back transactions never show up.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Binlog decoder class
+ */
+class BinlogDecoder
+{
+private:
+    /**
+     *  The event types we look at
+     */
+    enum Event
+    {
+        query               =   2,
+        rotate              =   4,
+        format              =  15,
+        xid                 =  16,
+        tablemap            =  19,
+        write1              =  23,
+        update1             =  24,
+        delete1             =  25,
+        write2              =  30,
+        update2             =  31,
+        delete2             =  32,
+        partial             =  39,
+        payload             =  40
+    };
+
+    /**
+     *  The column types that need attention
+     */
+    enum Column
+    {
+        tinyint             =   1,
+        smallint            =   2,
+        integer             =   3,
+        floatnumber         =   4,
+        doublenumber        =   5,
+        null                =   6,
+        timestamp           =   7,
+        bigint              =   8,
+        mediumint           =   9,
+        date                =  10,
+        time                =  11,
+        datetime            =  12,
+        year                =  13,
+        newdate             =  14,
+        varchar             =  15,
+        bit                 =  16,
+        timestamp2          =  17,
+        datetime2           =  18,
+        time2               =  19,
+        vector              = 242,
+        json                = 245,
+        newdecimal          = 246,
+        enumeration         = 247,
+        set                 = 248,
+        tinyblob            = 249,
+        mediumblob          = 250,
+        longblob            = 251,
+        blob                = 252,
+        varstring           = 253,
+        string              = 254,
+        geometry            = 255
+    };
+
+    /**
+     *  A table that was mapped by the log
+     */
+    struct Table
+    {
+        /**
+         *  The database and the name of the table
+         */
+        std::string database;
+        std::string name;
+
+        /**
+         *  Are changes to the table reported?
+         */
+        bool selected;
+
+        /**
+         *  The types of the columns, and their metadata
+         */
+        std::vector<uint8_t> types;
+        std::vector<uint16_t> metadata;
+    };
+
+    /**
+     *  The tables to report, by database, an empty name for all tables
+     *  of a database, or nothing at all to report everything
+     */
+    std::set<std::pair<std::string, std::string>> _selection;
+
+    /**
+     *  Do the events end with a checksum?
+     */
+    bool _checksum;
+
+    /**
+     *  The tables mapped by the log, by their id
+     */
+    std::unordered_map<uint64_t, Table> _tables;
+
+    /**
+     *  The changes of the running transaction
+     */
+    std::vector<BinlogChange> _pending;
+
+    /**
+     *  The changes of the committed transactions
+     */
+    std::vector<BinlogChange> _committed;
+
+    /**
+     *  Are we inside a transaction that was started with a statement?
+     */
+    bool _transaction = false;
+
+    /**
+     *  The log file and the position after the last event
+     */
+    std::string _file;
+    uint64_t _position = 0;
+
+    /**
+     *  The error, when an event could not be decoded
+     */
+    std::string _error;
+
+    /**
+     *  Read a little endian integer
+     *
+     *  @param  data        the integer
+     *  @param  bytes       the number of bytes
+     */
+    static uint64_t read(const unsigned char *data, size_t bytes)
+    {
+        // the result
+        uint64_t result = 0;
+
+        // add the bytes, the last one is the most significant
+        while (bytes-- > 0) result = (result << 8) | data[bytes];
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Read a length encoded integer
+     *
+     *  @param  data        the integer, moved past it
+     *  @param  end         the end of the data
+     *  @param  value       where to store the integer
+     *  @return did the integer fit in the data?
+     */
+    static bool packed(const unsigned char *&data, const unsigned char *end, uint64_t &value)
+    {
+        // there should be at least a first byte
+        if (data >= end) return false;
+
+        // the first byte tells how many bytes follow
+        size_t bytes = *data < 251 ? 0 : *data == 252 ? 2 : *data == 253 ? 3 : *data == 254 ? 8 : 0;
+
+        // and the value is a single byte, or the bytes that follow
+        if (end - data < (ptrdiff_t)(bytes + 1)) return false;
+        value = bytes ? read(data + 1, bytes) : *data;
+
+        // skip the integer
+        data += bytes + 1;
+        return true;
+    }
+
+    /**
+     *  Calculate the checksum of an event
+     *
+     *  @param  data        the event
+     *  @param  size        the number of bytes
+     */
+    static uint32_t crc32(const unsigned char *data, size_t size)
+    {
+        // the table for the polynomial, filled in once
+        static const std::vector<uint32_t> table = []() {
+            // the values for every byte
+            std::vector<uint32_t> table(256);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                // divide the byte by the polynomial
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; ++bit) value = (value >> 1) ^ (value & 1 ? 0xEDB88320 : 0);
+                table[i] = value;
+            }
+            return table;
+        }();
+
+        // process the bytes
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+        // done
+        return crc ^ 0xFFFFFFFF;
+    }
+
+    /**
+     *  The number of bytes a decimal takes
+     *
+     *  @param  precision   the number of digits
+     *  @param  scale       the number of digits after the point
+     */
+    static size_t decimal(size_t precision, size_t scale)
+    {
+        // the bytes for the digits that do not fill a group of nine
+        static const size_t bytes[] = { 0, 1, 1, 2, 2, 3, 3, 4, 4, 4 };
+
+        // the digits before the point
+        size_t integral = precision > scale ? precision - scale : 0;
+
+        // every group of nine digits takes four bytes
+        return integral / 9 * 4 + bytes[integral % 9] + scale / 9 * 4 + bytes[scale % 9];
+    }
+
+    /**
+     *  The number of bytes a value takes
+     *
+     *  @param  type        the type of the column
+     *  @param  metadata    the metadata of the column
+     *  @param  data        the value
+     *  @param  end         the end of the data
+     *  @param  size        where to store the number of bytes
+     *  @return could the value be measured?
+     */
+    static bool measure(uint8_t type, uint16_t metadata, const unsigned char *data, const unsigned char *end, size_t &size)
+    {
+        // the number of bytes before the value that hold its length
+        size_t prefix = 0;
+
+        // check the type
+        switch (type) {
+        case tinyint:       size = 1; break;
+        case smallint:      size = 2; break;
+        case mediumint:     size = 3; break;
+        case integer:       size = 4; break;
+        case bigint:        size = 8; break;
+        case floatnumber:   size = metadata; break;
+        case doublenumber:  size = metadata; break;
+        case null:          size = 0; break;
+        case timestamp:     size = 4; break;
+        case date:          size = 3; break;
+        case newdate:       size = 3; break;
+        case time:          size = 3; break;
+        case datetime:      size = 8; break;
+        case year:          size = 1; break;
+        case timestamp2:    size = 4 + (metadata + 1) / 2; break;
+        case datetime2:     size = 5 + (metadata + 1) / 2; break;
+        case time2:         size = 3 + (metadata + 1) / 2; break;
+        case bit:           size = (metadata >> 8) + ((metadata & 0xFF) ? 1 : 0); break;
+        case newdecimal:    size = decimal(metadata >> 8, metadata & 0xFF); break;
+        case enumeration:   size = metadata & 0xFF; break;
+        case set:           size = metadata & 0xFF; break;
+        case varchar:       prefix = metadata > 255 ? 2 : 1; break;
+        case varstring:     prefix = metadata > 255 ? 2 : 1; break;
+        case tinyblob:      prefix = metadata; break;
+        case mediumblob:    prefix = metadata; break;
+        case longblob:      prefix = metadata; break;
+        case blob:          prefix = metadata; break;
+        case geometry:      prefix = metadata; break;
+        case json:          prefix = metadata; break;
+        case vector:        prefix = metadata; break;
+        case string:
+            // enums and sets are logged as strings, with the number of bytes in the metadata
+            if ((metadata >> 8) == enumeration || (metadata >> 8) == set) { size = metadata & 0xFF; break; }
+
+            // the maximum length is spread over both bytes of the metadata
+            prefix = (((metadata >> 4) & 0x300) ^ 0x300) + (metadata & 0xFF) > 255 ? 2 : 1;
+            break;
+        default:
+            // we do not know the type
+            return false;
+        }
+
+        // values with a length prefix
+        if (prefix > 0)
+        {
+            // the prefix should be there
+            if (prefix > 4 || end - data < (ptrdiff_t)prefix) return false;
+
+            // and is followed by the value
+            size = prefix + read(data, prefix);
+        }
+
+        // the value should be there too
+        return end - data >= (ptrdiff_t)size;
+    }
+
+    /**
+     *  Skip the values of a row image
+     *
+     *  @param  table       the table of the row
+     *  @param  columns     the number of columns
+     *  @param  present     the bitmap of the columns in the image
+     *  @param  data        the image, moved past it
+     *  @param  end         the end of the data
+     *  @return could the image be skipped?
+     */
+    static bool skip(const Table &table, size_t columns, const unsigned char *present, const unsigned char *&data, const unsigned char *end)
+    {
+        // the columns in the image
+        size_t count = 0;
+        for (size_t i = 0; i < columns; ++i) if (present[i / 8] & (1 << (i % 8))) ++count;
+
+        // the image starts with a bitmap of the columns that are NULL
+        const unsigned char *nulls = data;
+        if (end - data < (ptrdiff_t)((count + 7) / 8)) return false;
+        data += (count + 7) / 8;
+
+        // skip the values
+        for (size_t i = 0, index = 0; i < columns; ++i)
+        {
+            // columns that are not in the image have no value
+            if (!(present[i / 8] & (1 << (i % 8)))) continue;
+
+            // nor do the columns that are NULL
+            bool isnull = nulls[index / 8] & (1 << (index % 8));
+            ++index;
+            if (isnull) continue;
+
+            // measure the value
+            size_t size;
+            if (!measure(table.types[i], table.metadata[i], data, end, size)) return false;
+
+            // and skip it
+            data += size;
+        }
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Are the changes to a table reported?
+     *
+     *  @param  database    the database
+     *  @param  table       the table, or empty for the database as a whole
+     */
+    bool selected(const std::string &database, const std::string &table) const
+    {
+        // report everything when nothing was selected
+        if (_selection.empty()) return true;
+
+        // the database may be selected as a whole
+        if (_selection.count(std::make_pair(database, std::string()))) return true;
+
+        // check the table
+        if (!table.empty()) return _selection.count(std::make_pair(database, table)) > 0;
+
+        // statements are reported when any table of the database is selected
+        auto iter = _selection.lower_bound(std::make_pair(database, std::string()));
+        return iter != _selection.end() && iter->first == database;
+    }
+
+    /**
+     *  Record a change of the running transaction
+     *
+     *  Changes to the same table follow each other in the log, for
+     *  every few thousand rows, so these are combined.
+     *
+     *  @param  type        the kind of change
+     *  @param  database    the database
+     *  @param  table       the table
+     *  @param  rows        the number of rows
+     */
+    void change(BinlogChange::Type type, const std::string &database, const std::string &table, size_t rows)
+    {
+        // combine the change with the previous one, if possible
+        if (!_pending.empty() && !table.empty() && _pending.back().type() == type && _pending.back().database() == database && _pending.back().table() == table) _pending.back().add(rows);
+
+        // or record a new change
+        else _pending.emplace_back(type, database, table, rows);
+    }
+
+    /**
+     *  The running transaction commits
+     */
+    void commit()
+    {
+        // the changes are committed
+        _committed.insert(_committed.end(), std::make_move_iterator(_pending.begin()), std::make_move_iterator(_pending.end()));
+        _pending.clear();
+
+        // the transaction is over
+        _transaction = false;
+    }
+
+    /**
+     *  Store an error
+     *
+     *  @param  error       the error
+     *  @return false
+     */
+    bool fail(const char *error)
+    {
+        // store the error
+        _error = error;
+        return false;
+    }
+
+    /**
+     *  Process a format description event
+     *
+     *  @param  data        the body of the event
+     *  @param  end         the end of the event, including the checksum
+     *  @return do the events end with a checksum?
+     */
+    bool describe(const unsigned char *data, const unsigned char *end)
+    {
+        // the version of the server, padded to fifty bytes
+        if (end - data < 52) return false;
+        std::string version((const char *)data + 2, strnlen((const char *)data + 2, 50));
+
+        // parse the version
+        unsigned int major = 0, minor = 0, patch = 0;
+        sscanf(version.c_str(), "%u.%u.%u", &major, &minor, &patch);
+
+        // servers before 5.6.1 do not know about checksums
+        if (major * 10000 + minor * 100 + patch < 50601) return false;
+
+        // the algorithm is stored before the checksum itself, one stands for crc32
+        return end - data >= 57 && end[-5] == 1;
+    }
+
+    /**
+     *  Process a table map event
+     *
+     *  @param  data        the body of the event
+     *  @param  end         the end of the body
+     *  @return could the event be decoded?
+     */
+    bool map(const unsigned char *data, const unsigned char *end)
+    {
+        // the id of the table, followed by flags
+        if (end - data < 9) return fail("Invalid table map event");
+        uint64_t id = read(data, 6);
+        data += 8;
+
+        // the database, terminated by a zero
+        size_t length = *data++;
+        if (end - data < (ptrdiff_t)(length + 2)) return fail("Invalid table map event");
+        std::string database((const char *)data, length);
+        data += length + 1;
+
+        // the table, terminated by a zero
+        length = *data++;
+        if (end - data < (ptrdiff_t)(length + 1)) return fail("Invalid table map event");
+        std::string name((const char *)data, length);
+        data += length + 1;
+
+        // the types of the columns
+        uint64_t columns;
+        if (!packed(data, end, columns) || end - data < (ptrdiff_t)columns) return fail("Invalid table map event");
+        std::vector<uint8_t> types(data, data + columns);
+        data += columns;
+
+        // the metadata of the columns
+        uint64_t size;
+        if (!packed(data, end, size) || end - data < (ptrdiff_t)size) return fail("Invalid table map event");
+        const unsigned char *metadata = data, *last = data + size;
+
+        // the metadata takes zero, one or two bytes, depending on the type
+        std::vector<uint16_t> values(columns, 0);
+        for (size_t i = 0; i < columns; ++i)
+        {
+            // check the type
+            switch (types[i]) {
+            case floatnumber:
+            case doublenumber:
+            case tinyblob:
+            case mediumblob:
+            case longblob:
+            case blob:
+            case geometry:
+            case json:
+            case vector:
+            case timestamp2:
+            case datetime2:
+            case time2:
+                // a single byte
+                if (metadata >= last) return fail("Invalid table map event");
+                values[i] = *metadata++;
+                break;
+            case bit:
+            case varchar:
+            case varstring:
+                // two bytes, the first is the least significant
+                if (last - metadata < 2) return fail("Invalid table map event");
+                values[i] = read(metadata, 2);
+                metadata += 2;
+                break;
+            case newdecimal:
+            case string:
+            case enumeration:
+            case set:
+                // two bytes, the first is the most significant
+                if (last - metadata < 2) return fail("Invalid table map event");
+                values[i] = (metadata[0] << 8) | metadata[1];
+                metadata += 2;
+                break;
+            }
+        }
+
+        // the table may have been mapped before
+        Table &table = _tables[id];
+        table.selected = selected(database, name);
+        table.database = std::move(database);
+        table.name = std::move(name);
+        table.types = std::move(types);
+        table.metadata = std::move(values);
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Process a rows event
+     *
+     *  @param  event       the type of event
+     *  @param  data        the body of the event
+     *  @param  end         the end of the body
+     *  @return could the event be decoded?
+     */
+    bool rows(uint8_t event, const unsigned char *data, const unsigned char *end)
+    {
+        // the kind of change
+        auto type = event == write1 || event == write2 ? BinlogChange::inserted : event == delete1 || event == delete2 ? BinlogChange::deleted : BinlogChange::updated;
+
+        // the id of the table, followed by flags
+        if (end - data < 8) return fail("Invalid rows event");
+        uint64_t id = read(data, 6);
+        data += 8;
+
+        // newer events have extra data, which includes its own length
+        if (event >= write2)
+        {
+            // skip the extra data
+            if (end - data < 2) return fail("Invalid rows event");
+            size_t extra = read(data, 2);
+            if (extra < 2 || end - data < (ptrdiff_t)extra) return fail("Invalid rows event");
+            data += extra;
+        }
+
+        // the table should have been mapped
+        auto iter = _tables.find(id);
+        if (iter == _tables.end())
+        {
+            // we do not know what changed
+            change(BinlogChange::unknown, std::string(), std::string(), 0);
+            return true;
+        }
+
+        // and we should be interested in it
+        const Table &table = iter->second;
+        if (!table.selected) return true;
+
+        // the number of columns
+        uint64_t columns;
+        if (!packed(data, end, columns)) return fail("Invalid rows event");
+
+        // the columns in the images, updates have a before and an after image
+        size_t bitmap = (columns + 7) / 8;
+        const unsigned char *before = data, *after = data;
+        if (type == BinlogChange::updated) after += bitmap;
+        if (end - after < (ptrdiff_t)bitmap) return fail("Invalid rows event");
+        data = after + bitmap;
+
+        // count the rows, unless we cannot skip over the values
+        size_t count = 0;
+        bool known = event != partial && columns <= table.types.size();
+        while (known && data < end)
+        {
+            // skip the image, and the after image of updates
+            known = skip(table, columns, before, data, end);
+            if (known && type == BinlogChange::updated) known = skip(table, columns, after, data, end);
+
+            // one more row
+            if (known) ++count;
+        }
+
+        // record the change
+        change(type, table.database, table.name, known ? count : 0);
+        return true;
+    }
+
+    /**
+     *  Process a query event
+     *
+     *  @param  data        the body of the event
+     *  @param  end         the end of the body
+     *  @return could the event be decoded?
+     */
+    bool statement(const unsigned char *data, const unsigned char *end)
+    {
+        // the fixed part holds the length of the database and the status variables
+        if (end - data < 13) return fail("Invalid query event");
+        size_t length = data[8];
+        size_t variables = read(data + 11, 2);
+        data += 13;
+
+        // the database, terminated by a zero, follows the status variables
+        if (end - data < (ptrdiff_t)(variables + length + 1)) return fail("Invalid query event");
+        std::string database((const char *)data + variables, length);
+        data += variables + length + 1;
+
+        // and the rest is the query
+        std::string query((const char *)data, end - data);
+
+        // transactions start with a statement
+        if (query == "BEGIN")
+        {
+            // the changes that follow are part of the transaction
+            _transaction = true;
+            return true;
+        }
+
+        // the statement changed something, unless it ends the transaction
+        bool ends = query == "COMMIT" || query.compare(0, 8, "ROLLBACK") == 0;
+        if (!ends && selected(database, std::string())) _pending.emplace_back(BinlogChange::statement, std::move(database), std::string(), 0, std::move(query));
+
+        // changes to tables that cannot roll back are logged even when the
+        // transaction rolls back, and statements outside a transaction,
+        // like schema changes, commit by themselves
+        if (ends || !_transaction) commit();
+
+        // done
+        return true;
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  selection   the tables to report, or nothing to report everything
+     *  @param  checksum    do the events end with a checksum?
+     */
+    BinlogDecoder(std::set<std::pair<std::string, std::string>> selection, bool checksum) :
+        _selection(std::move(selection)), _checksum(checksum) {}
+
+    /**
+     *  Process an event
+     *
+     *  @param  data        the event
+     *  @param  size        the number of bytes
+     *  @return could the event be processed?
+     */
+    bool process(const unsigned char *data, size_t size)
+    {
+        // every event starts with the same header
+        if (size < 19) return fail("Invalid binlog event");
+        uint8_t type = data[4];
+        uint64_t position = read(data + 13, 4);
+
+        // the format description tells whether the events have a checksum
+        bool checksum = type == format ? describe(data + 19, data + size) : _checksum;
+        if (type == format) _checksum = checksum;
+
+        // check the checksum
+        if (checksum)
+        {
+            // the checksum takes the last four bytes
+            if (size < 23) return fail("Invalid binlog event");
+            size -= 4;
+
+            // and should match the event
+            if (crc32(data, size) != read(data + size, 4)) return fail("Binlog event checksum mismatch");
+        }
+
+        // the body of the event
+        const unsigned char *body = data + 19, *end = data + size;
+
+        // remember where we are, events made up by the server have no position
+        if (position > 0) _position = position;
+
+        // check the type of event
+        switch (type) {
+        case rotate:
+            // the log switches to another file
+            if (end - body < 8) return fail("Invalid rotate event");
+            _position = read(body, 8);
+            _file.assign((const char *)body + 8, end - body - 8);
+            return true;
+
+        case tablemap:
+            // a table is mapped
+            return map(body, end);
+
+        case write1:
+        case update1:
+        case delete1:
+        case write2:
+        case update2:
+        case delete2:
+        case partial:
+            // rows changed
+            return rows(type, body, end);
+
+        case query:
+            // a statement was logged
+            return statement(body, end);
+
+        case xid:
+            // the transaction commits
+            commit();
+            return true;
+
+        case payload:
+            // the transaction was compressed, we do not know what changed
+            change(BinlogChange::unknown, std::string(), std::string(), 0);
+            commit();
+            return true;
+
+        default:
+            // other events do not change anything
+            return true;
+        }
+    }
+
+    /**
+     *  Did transactions commit?
+     */
+    bool committed() const { return !_committed.empty(); }
+
+    /**
+     *  Take the changes of the transactions that committed
+     */
+    std::vector<BinlogChange> take()
+    {
+        // the changes
+        std::vector<BinlogChange> result;
+        result.swap(_committed);
+        return result;
+    }
+
+    /**
+     *  The log file
+     */
+    const std::string &file() const { return _file; }
+
+    /**
+     *  The position after the last event
+     */
+    uint64_t position() const { return _position; }
+
+    /**
+     *  The error, when an event could not be processed
+     */
+    const std::string &error() const { return _error; }
+};
+
+/**
+ *  End namespace
+ */
+}}
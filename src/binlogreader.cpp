@@ -0,0 +1,354 @@
+/**
+ *  BinlogReader.cpp
+ *
+ *  Class that connects to a server as a replica, and reads the changes
+ *  from its binary log as they are committed.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+#include "library.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Run a query that returns a single row
+ *
+ *  @param  connection  the connection to run the query on
+ *  @param  query       the query to run
+ *  @param  values      where to store the values of the row
+ *  @return was the query successful?
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ */
+static bool fetch(MYSQL *connection, const char *query, std::vector<std::string> &values)
+{
+    // run the query
+    if (mysql_query(connection, query) != 0) return false;
+
+    // retrieve the result, if there is one
+    MYSQL_RES *result = mysql_store_result(connection);
+    if (result == nullptr) return mysql_field_count(connection) == 0;
+
+    // store the values of the first row
+    MYSQL_ROW row = mysql_fetch_row(result);
+    for (unsigned int i = 0; row && i < mysql_num_fields(result); ++i) values.emplace_back(row[i] ? row[i] : "");
+
+    // done with the result
+    mysql_free_result(result);
+    return true;
+}
+
+/**
+ *  Constructor
+ *
+ *  @param  loop        the loop to deliver the changes to
+ *  @param  hostname    the hostname to connect to
+ *  @param  username    the username to login with
+ *  @param  password    the password to authenticate with
+ *  @param  server      the id to register as a replica with
+ *  @param  initialize  do we need to initialize (and cleanup) the mysql library
+ */
+BinlogReader::BinlogReader(Loop *loop, const std::string& hostname, const std::string &username, const std::string& password, uint32_t server, bool initialize) :
+    _hostname(hostname),
+    _username(username),
+    _password(password),
+    _server(server),
+    _master(loop),
+    _completions(new CompletionQueue(&_master)),
+    _inflight(new InFlightCounter(loop, _completions.get())),
+    _worker(new SubmissionQueue())
+{
+    // initialize the library if necessary
+    if (initialize) init();
+}
+
+/**
+ *  Destructor
+ */
+BinlogReader::~BinlogReader()
+{
+    // stop reading
+    stop();
+
+    // clean up mysql data when the worker stops
+    _worker->execute([]() { mysql_thread_end(); });
+
+    // wait for the worker, which no longer waits for the server
+    _worker.reset();
+
+    // the callbacks that never ran hold tokens for the counter, which
+    // is destroyed before the queue, so they are released right now
+    _completions->clear();
+}
+
+/**
+ *  Execute a callback in the master thread
+ *
+ *  @param  callback    the callback to execute
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ */
+void BinlogReader::deliver(const std::function<void()>& callback)
+{
+    // run the callback together with the other waiting callbacks
+    _completions->push([callback]() { callback(); });
+}
+
+/**
+ *  Report the changes to a table
+ *
+ *  @param  database    the database
+ *  @param  table       the table, or empty for all tables in the database
+ *  @throws Exception   when the reader already started
+ */
+BinlogReader& BinlogReader::add(const std::string& database, const std::string& table)
+{
+    // the worker uses the tables
+    if (_running) throw Exception("Binlog reader already started");
+
+    // add the table
+    _selection.emplace(database, table);
+
+    // allow chaining
+    return *this;
+}
+
+/**
+ *  Start reading the log
+ *
+ *  @param  file        the log file to start in
+ *  @param  position    the position to start at
+ *  @param  heartbeat   the interval of the heartbeats, in seconds
+ *  @throws Exception   when the reader already started
+ */
+void BinlogReader::start(const std::string& file, uint64_t position, double heartbeat)
+{
+    // we can only read once at a time
+    if (_running) throw Exception("Binlog reader already started");
+
+    // we are running now, with a new flag to stop us
+    _running = true;
+    _stop = std::make_shared<std::atomic<bool>>(false);
+
+    // keep the loop alive while we are reading
+    InFlight reference(_inflight.get());
+
+    // read the log in the worker thread
+    _worker->execute(std::bind([this, reference, file, position, heartbeat](const std::shared_ptr<std::atomic<bool>> &stop) {
+        // read until we are stopped or fail
+        auto error = read(reference, *stop, file, position, heartbeat);
+
+        // we are no longer running, and report why
+        deliver([this, reference, error]() {
+            // the reader can be started again
+            _running = false;
+
+            // report the failure
+            if (!error.empty() && _failureCallback) _failureCallback(error.c_str());
+        });
+    }, _stop));
+}
+
+/**
+ *  Stop reading the log
+ */
+void BinlogReader::stop()
+{
+    // are we reading at all?
+    if (!_stop) return;
+
+    // tell the worker to stop reading
+    _stop->store(true);
+
+    // it may be waiting for the next event, which we interrupt
+    std::lock_guard<std::mutex> lock(_lock);
+    if (_socket >= 0) shutdown(_socket, SHUT_RDWR);
+}
+
+/**
+ *  Read the log until we are stopped
+ *
+ *  @param  reference   the token that keeps the loop alive
+ *  @param  stop        the flag that tells us to stop
+ *  @param  file        the log file to start in
+ *  @param  position    the position to start at
+ *  @param  heartbeat   the interval of the heartbeats, in seconds
+ *  @return the error, or an empty string when we were stopped
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ */
+std::string BinlogReader::read(const InFlight& reference, const std::atomic<bool> &stop, std::string file, uint64_t position, double heartbeat)
+{
+#if MYSQL_VERSION_ID >= 50700 && !defined(MARIADB_BASE_VERSION)
+    // initialize connection object
+    MYSQL *connection = mysql_init(nullptr);
+    if (connection == nullptr) return "Unable to initialize connection";
+
+    // the server sends heartbeats, so we give up when a few of them are missed
+    unsigned int timeout = (unsigned int)std::max(1.0, std::ceil(heartbeat * 4.0));
+    mysql_options(connection, MYSQL_OPT_READ_TIMEOUT, &timeout);
+
+    // connect to the server
+    Address address(_hostname);
+    if (mysql_real_connect(connection, address.host(), _username.c_str(), _password.c_str(), nullptr, address.port(), address.socket(), 0) == nullptr)
+    {
+        // could not connect
+        std::string error(mysql_error(connection));
+        mysql_close(connection);
+        return error;
+    }
+
+    // the events end with a checksum when the server is configured to do so
+    std::vector<std::string> checksum, status;
+    bool success = fetch(connection, "SELECT @@global.binlog_checksum", checksum);
+
+    // let the server know we understand the checksums, newer servers use other names
+    if (success) success = fetch(connection, "SET @master_binlog_checksum = @@global.binlog_checksum, @source_binlog_checksum = @@global.binlog_checksum", status);
+
+    // and ask for heartbeats, in nanoseconds
+    std::string period = std::to_string((uint64_t)(heartbeat * 1000000000));
+    if (success) success = fetch(connection, ("SET @master_heartbeat_period = " + period + ", @source_heartbeat_period = " + period).c_str(), status);
+
+    // without a file we start at the end of the log, older servers use another statement
+    if (success && file.empty()) success = fetch(connection, "SHOW BINARY LOG STATUS", status) || fetch(connection, "SHOW MASTER STATUS", status);
+    if (success && file.empty() && status.size() < 2)
+    {
+        // the server does not log
+        mysql_close(connection);
+        return "Binary logging is not enabled";
+    }
+
+    // use the position of the server
+    if (success && file.empty())
+    {
+        // the file and the position are the first two columns
+        file = status[0];
+        position = std::strtoull(status[1].c_str(), nullptr, 10);
+    }
+
+    // register as a replica and start streaming
+    MYSQL_RPL rpl = {};
+    rpl.file_name_length = file.size();
+    rpl.file_name = file.c_str();
+    rpl.start_position = position;
+    rpl.server_id = _server;
+    if (!success || mysql_binlog_open(connection, &rpl) != 0)
+    {
+        // could not start
+        std::string error(mysql_error(connection));
+        mysql_close(connection);
+        return error;
+    }
+
+    // from now on we can be interrupted, unless we were already stopped
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _socket = connection->net.fd;
+    }
+
+    // the decoder, which finds out about checksums from the log itself
+    BinlogDecoder decoder(_selection, !checksum.empty() && checksum[0] == "CRC32");
+
+    // the error that stopped us
+    std::string error;
+
+    // read events until we are stopped
+    while (!stop.load())
+    {
+        // fetch the next event
+        if (mysql_binlog_fetch(connection, &rpl) != 0)
+        {
+            // we are not interested in errors after being stopped
+            if (!stop.load()) error = mysql_error(connection);
+            break;
+        }
+
+        // the server has nothing more to send
+        if (rpl.size == 0)
+        {
+            // the connection was closed
+            error = "Binlog stream ended";
+            break;
+        }
+
+        // process the event, which follows a status byte
+        if (!decoder.process(rpl.buffer + 1, rpl.size - 1))
+        {
+            // the event could not be decoded
+            error = decoder.error();
+            break;
+        }
+
+        // wait until transactions commit
+        if (!decoder.committed()) continue;
+
+        // the changes, and where to continue after them
+        auto changes = std::make_shared<std::vector<BinlogChange>>(decoder.take());
+        std::string current(decoder.file());
+        uint64_t next = decoder.position();
+
+        // pass them to the master thread
+        deliver([this, reference, changes, current, next]() {
+            // report the changes
+            if (_changesCallback) _changesCallback(std::move(*changes), current, next);
+        });
+    }
+
+    // the socket is about to be closed, so it should no longer be shut down
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _socket = -1;
+    }
+
+    // done with the connection
+    mysql_binlog_close(connection, &rpl);
+    mysql_close(connection);
+
+    // done
+    return error;
+#else
+    // the client library cannot stream the log
+    return "Binlog streaming is not supported by this client library";
+#endif
+}
+
+/**
+ *  Get a call with the changes of the transactions that committed
+ *
+ *  @param  callback    the callback to execute with the changes
+ */
+BinlogReader& BinlogReader::onChanges(const std::function<void(std::vector<BinlogChange>&& changes, const std::string& file, uint64_t position)>& callback)
+{
+    // store callback for later
+    _changesCallback = callback;
+
+    // allow chaining
+    return *this;
+}
+
+/**
+ *  Get a call when the reader fails
+ *
+ *  @param  callback    the callback to execute on failure
+ */
+BinlogReader& BinlogReader::onFailure(const std::function<void(const char *error)>& callback)
+{
+    // store callback for later
+    _failureCallback = callback;
+
+    // allow chaining
+    return *this;
+}
+
+/**
+ *  End namespace
+ */
+}}
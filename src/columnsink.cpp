@@ -0,0 +1,51 @@
+/**
+ *  ColumnSink.cpp
+ *
+ *  Destination for a column that is streamed from a prepared
+ *  statement result in chunks, instead of being materialized.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+#include <unistd.h>
+#include <cerrno>
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Receive a chunk of data
+ *
+ *  @param  row     index of the row the data belongs to
+ *  @param  buffer  the data
+ *  @param  size    the number of bytes in the buffer
+ *  @return should the rest of the value be streamed too?
+ */
+bool DescriptorSink::data(size_t row, const char *buffer, size_t size)
+{
+    // write until the complete chunk is out
+    while (size > 0)
+    {
+        // write as much as possible
+        auto written = write(_fd, buffer, size);
+
+        // retry when interrupted, give up on other errors
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) return false;
+
+        // move past the written data
+        buffer += written;
+        size -= written;
+    }
+
+    // the chunk was written
+    return true;
+}
+
+/**
+ *  End namespace
+ */
+}}
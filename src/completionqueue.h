@@ -0,0 +1,207 @@
+/**
+ *  CompletionQueue.h
+ *
+ *  Queue of callbacks that the worker hands over to the master
+ *  thread. Instead of posting a task to the master for every
+ *  callback, the callbacks are added to a lock-free queue and the
+ *  master is only woken up when it is not already going to drain
+ *  it. A burst of results thus costs a single wakeup. To keep the
+ *  loop responsive, a bounded number of callbacks is run per
+ *  wakeup, after which the master is woken up again for the rest.
+ *  When the queue is full, callbacks go to a locked overflow list
+ *  instead, so that a worker never has to wait for the master.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Completion queue class
+ */
+class CompletionQueue
+{
+private:
+    /**
+     *  The worker for the master thread
+     */
+    Worker *_master;
+
+    /**
+     *  The callbacks waiting for the master
+     */
+    LockFreeQueue<Task> _callbacks;
+
+    /**
+     *  Lock for the overflow list
+     */
+    std::mutex _mutex;
+
+    /**
+     *  The callbacks that did not fit in the queue, these are
+     *  always newer than the callbacks in the queue
+     */
+    std::deque<Task> _overflow;
+
+    /**
+     *  Are there callbacks in the overflow list?
+     */
+    std::atomic<bool> _overflowing;
+
+    /**
+     *  The callbacks taken from the overflow list that were not run yet,
+     *  these are older than the callbacks in the queue
+     *
+     *  @note:  This member is only accessed from master context
+     */
+    std::deque<Task> _backlog;
+
+    /**
+     *  Is the master going to drain the queue?
+     */
+    std::atomic<bool> _notified;
+
+    /**
+     *  The maximum number of callbacks to run per wakeup
+     */
+    size_t _batch;
+
+    /**
+     *  Wake up the master, unless it is already going to drain the queue
+     */
+    void notify()
+    {
+        // check whether the master was already notified
+        if (_notified.exchange(true, std::memory_order_acq_rel)) return;
+
+        // let the master drain the queue
+        _master->execute([this]() { drain(); });
+    }
+
+    /**
+     *  Run the waiting callbacks
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     */
+    void drain()
+    {
+        // from now on, new callbacks need a new notification
+        _notified.store(false, std::memory_order_release);
+
+        // run a limited number of callbacks
+        for (size_t i = 0; i < _batch; ++i)
+        {
+            // the next callback to run
+            Task callback;
+            if (!next(callback)) return;
+
+            // run it
+            callback();
+        }
+
+        // if callbacks are left, we come back in the next iteration
+        if (!_backlog.empty() || !_callbacks.empty() || _overflowing.load(std::memory_order_acquire)) notify();
+    }
+
+    /**
+     *  Take the oldest waiting callback
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     *
+     *  @param  callback    where to store the callback
+     *  @return was there a callback
+     */
+    bool next(Task &callback)
+    {
+        // the callbacks taken from the overflow list go first
+        if (!_backlog.empty())
+        {
+            callback = std::move(_backlog.front());
+            _backlog.pop_front();
+            return true;
+        }
+
+        // then the callbacks in the queue
+        if (_callbacks.pop(callback)) return true;
+
+        // the queue is empty, so the overflow list holds the oldest callbacks
+        if (!_overflowing.load(std::memory_order_acquire)) return false;
+
+        // take them from the list
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _backlog.swap(_overflow);
+            _overflowing.store(false, std::memory_order_release);
+        }
+
+        // and start with those
+        return next(callback);
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  master      the worker for the master thread
+     *  @param  capacity    the number of callbacks that can be waiting
+     *  @param  batch       the maximum number of callbacks to run per wakeup
+     */
+    CompletionQueue(Worker *master, size_t capacity = 256, size_t batch = 256) :
+        _master(master),
+        _callbacks(capacity),
+        _overflowing(false),
+        _notified(false),
+        _batch(batch) {}
+
+    /**
+     *  Hand a callback over to the master
+     *
+     *  @param  callback    the callback to run in the master thread
+     */
+    void push(Task&& callback)
+    {
+        // add it to the queue, or to the overflow list if the queue is full
+        // or if older callbacks are already waiting in the overflow list
+        if (_overflowing.load(std::memory_order_acquire) || !_callbacks.push(std::move(callback)))
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _overflow.push_back(std::move(callback));
+            _overflowing.store(true, std::memory_order_release);
+        }
+
+        // make sure the master is going to run it
+        notify();
+    }
+
+    /**
+     *  Destroy the waiting callbacks without running them
+     *
+     *  This is used when the owner is destroyed, after its worker has
+     *  stopped, so the callbacks release what they hold while it still
+     *  exists. Callbacks added in the meantime are destroyed as well.
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     */
+    void clear()
+    {
+        // nothing is run anymore, so the master need not be woken up
+        _notified.store(true, std::memory_order_release);
+
+        // the callback to destroy
+        Task callback;
+
+        // destroying a callback may add another one, so we go on until none are left
+        while (next(callback)) callback = Task();
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
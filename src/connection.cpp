@@ -15,16 +15,9 @@
 namespace React { namespace MySQL {
 
 /**
- *  Initializes the MySQL library
- *
- *  The library will be automatically de-initialized
- *  on program termination.
+ *  Counter to give every connection a unique id
  */
-static void init()
-{
-    // keep a single static library instance available
-    static Library library;
-}
+static std::atomic<uint64_t> connections(0);
 
 /**
  *  Establish a connection to mysql
@@ -39,22 +32,32 @@ static void init()
 Connection::Connection(Loop *loop, const std::string& hostname, const std::string &username, const std::string& password, const std::string& database, uint64_t flags, bool initialize) :
     _loop(loop),
     _connection(nullptr),
+    _statistics(new StatisticsRecorder()),
+    _digests(new DigestTable()),
+    _lag(new LagMonitor()),
+    _id(++connections),
+    _tracing(nullptr),
     _master(loop),
-    _worker()
+    _completions(new CompletionQueue(&_master)),
+    _inflight(new InFlightCounter(loop, _completions.get())),
+    _deferreds(std::make_shared<DeferredPool>()),
+    _cache(new ResultCache()),
+    _flights(new SingleFlight()),
+    _worker(new SubmissionQueue())
 {
     // initialize the library if necessary
     if (initialize) init();
 
     // keep the loop alive while the callback runs
-    auto reference = std::make_shared<React::LoopReference>(_loop);
+    InFlight reference(_inflight.get());
 
     // establish the connection in the worker thread
-    _worker.execute([this, reference, hostname, username, password, database, flags]() {
+    _worker->execute([this, reference, hostname, username, password, database, flags]() {
         // initialize connection object
         if ((_connection = mysql_init(nullptr)) == nullptr)
         {
             // could not initialize connection object
-            _master.execute([this, reference]() { if (_connectCallback) _connectCallback(mysql_error(_connection)); });
+            deliver([this, reference]() { if (_connectCallback) _connectCallback(mysql_error(_connection)); });
             return;
         }
 
@@ -62,16 +65,26 @@ Connection::Connection(Loop *loop, const std::string& hostname, const std::strin
         my_bool reconnect = 1;
         mysql_options(_connection, MYSQL_OPT_RECONNECT, &reconnect);
 
+        // the hostname may include a port, or be the path to a unix socket
+        Address address(hostname);
+
+        // let the server tell us about changes to the session, if the library supports it
+#ifdef CLIENT_SESSION_TRACK
+        auto capabilities = flags | CLIENT_SESSION_TRACK;
+#else
+        auto capabilities = flags;
+#endif
+
         // connect to mysql
-        if (mysql_real_connect(_connection, hostname.c_str(), username.c_str(), password.c_str(), database.c_str(), 0, nullptr, flags) == nullptr)
+        if (mysql_real_connect(_connection, address.host(), username.c_str(), password.c_str(), database.c_str(), address.port(), address.socket(), capabilities) == nullptr)
         {
             // could not connect to mysql
-            _master.execute([this, reference]() { if (_connectCallback) _connectCallback(mysql_error(_connection)); });
+            deliver([this, reference]() { if (_connectCallback) _connectCallback(mysql_error(_connection)); });
             return;
         }
 
         // we are connected, signal success to the callback
-        _master.execute([this, reference]() { if (_connectCallback) _connectCallback(nullptr); });
+        deliver([this, reference]() { if (_connectCallback) _connectCallback(nullptr); });
     });
 }
 
@@ -80,14 +93,29 @@ Connection::Connection(Loop *loop, const std::string& hostname, const std::strin
  */
 Connection::~Connection()
 {
+    // commit the transactions that are waiting for others
+    flush();
+
+    // a stream that waits for its receiver, or a transaction that waits for its
+    // statements, would keep the worker from stopping
+    for (auto &throttle : _throttles) if (auto stream = throttle.lock()) stream->stop();
+    for (auto &session : _sessions) if (auto transaction = session.lock()) transaction->close();
+
     // clean up mysql data when the worker stops
-    _worker.execute([this]() {
+    _worker->execute([this]() {
         // close a possible connection
         if (_connection) mysql_close(_connection);
 
         // clean up thread-local mysql data
         mysql_thread_end();
     });
+
+    // stop the worker, after it has run everything that was queued
+    _worker.reset();
+
+    // the callbacks that never ran hold tokens for the counter, which
+    // is destroyed before the queue, so they are released right now
+    _completions->clear();
 }
 
 /**
@@ -101,6 +129,301 @@ void Connection::onConnected(const std::function<void(const char *error)>& callb
     _connectCallback = callback;
 }
 
+/**
+ *  Get a call for every slow query
+ *
+ *  @param  threshold   the threshold in seconds
+ *  @param  callback    the callback to report slow queries to
+ *  @param  explain     the fraction of slow queries to explain
+ */
+void Connection::onSlowQuery(double threshold, const std::function<void(const SlowQuery& query)>& callback, double explain)
+{
+    // the configuration is owned by the worker, so we install it there
+    _worker->execute([this, threshold, callback, explain]() {
+        // install the new configuration, or remove it
+        _slowlog.reset(callback ? new SlowQueryLog(threshold, callback, explain) : nullptr);
+    });
+}
+
+/**
+ *  The number of callbacks waiting to be run by the event loop
+ */
+size_t Connection::backlog() const
+{
+    return _lag->backlog();
+}
+
+/**
+ *  The number of operations waiting for the worker, or running
+ */
+size_t Connection::pending() const
+{
+    return _worker->size();
+}
+
+/**
+ *  Get a call when the event loop starts lagging
+ *
+ *  @param  threshold   the threshold in seconds
+ *  @param  callback    the callback with the delay in nanoseconds and the backlog
+ */
+void Connection::onLag(double threshold, const std::function<void(uint64_t delay, size_t backlog)>& callback)
+{
+    // the monitor is used from the master thread, so we can install it directly
+    _lag->install(threshold, callback);
+}
+
+/**
+ *  Start tracing the queries on this connection
+ *
+ *  @param  filename    the file to write the spans to
+ *  @param  format      the format to write the spans in
+ *  @param  capacity    the number of phases that can be buffered
+ *  @return false if tracing was already enabled, or the file cannot be opened
+ */
+bool Connection::trace(const std::string& filename, TraceFormat format, size_t capacity)
+{
+    // tracing can only be enabled once
+    if (_tracer) return false;
+
+    // open the file to write to
+    auto *file = fopen(filename.c_str(), format == TraceFormat::binary ? "ab" : "a");
+    if (file == nullptr) return false;
+
+    // create the tracer, and publish it to the threads
+    _tracer.reset(new Tracer(_id, file, format, capacity));
+    _tracing.store(_tracer.get(), std::memory_order_release);
+
+    // tracing is enabled
+    return true;
+}
+
+/**
+ *  Track the GTIDs of the transactions committed on this connection
+ */
+void Connection::trackGtids()
+{
+    // the connection is only used from the worker
+    _worker->execute([this]() {
+        // is there a connection at all?
+        if (_connection == nullptr) return;
+
+        // the statement that enables the tracking
+        static const char *statement = "SET SESSION session_track_gtids = OWN_GTID";
+
+        // run it right now, servers that do not support it cannot track anything
+        if (mysql_query(_connection, statement) != 0) return;
+
+        // and after every reconnect
+        mysql_options(_connection, MYSQL_INIT_COMMAND, statement);
+    });
+}
+
+/**
+ *  Commit small transactions together
+ *
+ *  @param  window      how long transactions wait for others, in seconds
+ *  @param  limit       the maximum number of transactions in a group
+ */
+void Connection::groupCommit(double window, size_t limit)
+{
+    // commit the transactions waiting under the old settings
+    flush();
+
+    // install the new settings, or disable group commit
+    _group.reset(window > 0.0 ? new GroupCommit(window, limit) : nullptr);
+}
+
+/**
+ *  The cache for the results of reads
+ */
+ResultCache& Connection::cache()
+{
+    return *_cache;
+}
+
+/**
+ *  Combine identical reads
+ *
+ *  @param  enabled     should identical reads be combined?
+ */
+void Connection::singleFlight(bool enabled)
+{
+    _flights->enable(enabled);
+}
+
+/**
+ *  Retrieve the statistics of this connection
+ */
+Statistics Connection::statistics() const
+{
+    // take a snapshot of the recorded values
+    return _statistics->snapshot();
+}
+
+/**
+ *  Retrieve the statistics per query digest
+ */
+std::vector<Digest> Connection::digests() const
+{
+    // take a snapshot of the digest table
+    return _digests->snapshot();
+}
+
+/**
+ *  Is a query with the given duration slow?
+ *
+ *  @param  duration    the time spent executing and fetching
+ */
+bool Connection::slow(uint64_t duration) const
+{
+    // only when we report slow queries at all
+    return _slowlog && _slowlog->exceeds(duration);
+}
+
+/**
+ *  Report a slow query
+ *
+ *  @param  reference   the token keeping the loop alive
+ *  @param  record      the slow query record
+ *  @param  explain     function to explain the query, if possible
+ */
+void Connection::report(const InFlight& reference, SlowQuery&& record, const std::function<std::string()>& explain)
+{
+    // the last statement that finished on this connection was the slow query
+    static const char *examined =
+        "SELECT ROWS_EXAMINED FROM performance_schema.events_statements_history "
+        "WHERE THREAD_ID = (SELECT THREAD_ID FROM performance_schema.threads WHERE PROCESSLIST_ID = CONNECTION_ID()) "
+        "ORDER BY EVENT_ID DESC LIMIT 1";
+
+    // look up the number of examined rows, this fails when the performance schema is not enabled
+    if (mysql_query(_connection, examined) == 0)
+    {
+        // retrieve the result
+        if (auto *result = mysql_store_result(_connection))
+        {
+            // read the number of rows
+            auto row = mysql_fetch_row(result);
+            if (row && row[0]) record._examined = std::strtoll(row[0], nullptr, 10);
+
+            // clean up the result
+            mysql_free_result(result);
+        }
+    }
+
+    // explain the query if it is sampled
+    if (explain && record._error.empty() && SlowQueryLog::explainable(record._digest) && _slowlog->sample()) record._explain = explain();
+
+    // hand the record to the callback
+    auto callback = _slowlog->callback();
+    deliver([reference, callback, record]() { callback(record); });
+}
+
+/**
+ *  Explain a query
+ *
+ *  @param  query       the query to explain
+ *  @return the query plan in json format, or an empty string
+ */
+std::string Connection::explain(const std::string& query)
+{
+    // the query plan
+    std::string plan;
+
+    // ask the server for the plan
+    if (mysql_query(_connection, ("EXPLAIN FORMAT=JSON " + query).c_str())) return plan;
+
+    // retrieve the result
+    auto *result = mysql_store_result(_connection);
+    if (result == nullptr) return plan;
+
+    // the plan is in the first column of the first row
+    auto row = mysql_fetch_row(result);
+    auto lengths = mysql_fetch_lengths(result);
+    if (row && row[0]) plan.assign(row[0], lengths[0]);
+
+    // clean up the result
+    mysql_free_result(result);
+
+    // done
+    return plan;
+}
+
+/**
+ *  Hand a callback over to the master thread
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ *
+ *  @param  callback    the callback to execute in the master thread
+ *  @param  query       the id of the query the callback is for, if any
+ *  @param  deferred    the deferred the callback is for, if any
+ */
+void Connection::deliver(const std::function<void()>& callback, uint64_t query, const Deferred *deferred)
+{
+    // the moment the callback was handed over
+    auto posted = StatisticsRecorder::now();
+
+    // one more callback is waiting for the master
+    _lag->posted();
+
+    // execute the callback in the master thread, together with the other waiting callbacks
+    _completions->push([this, callback, posted, query, deferred]() {
+        // record how long it took the master to get to it
+        auto now = StatisticsRecorder::now();
+        auto delay = now - posted;
+        _statistics->delivered(delay);
+
+        // and check whether the loop is lagging
+        _lag->running(delay);
+
+        // trace the delivery of query results
+        if (query) REACT_MYSQL_PROBE(callback_delivered, _id, query, 0, 0);
+
+        // the trace id is read here, the user sets it after submitting the query
+        if (auto *tracer = this->tracer()) if (query) tracer->record(query, Tracer::deliver, now, deferred ? deferred->trace() : 0);
+
+        // run the callback
+        callback();
+    });
+}
+
+/**
+ *  Report an operation as failed
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ *
+ *  @param  reference   the token keeping the loop alive
+ *  @param  deferred    the deferred to inform
+ *  @param  error       description of the failure
+ *  @param  query       the id of the failed query, if any
+ */
+void Connection::fail(const InFlight& reference, const std::shared_ptr<Deferred>& deferred, const char *error, uint64_t query)
+{
+    // count the failure
+    _statistics->failed();
+
+    // copy the error, the connection may be reused before the callback runs
+    std::string message(error);
+
+    // inform the deferred in the master thread
+    deliver([reference, deferred, message]() { deferred->failure(message.c_str()); }, query, deferred.get());
+}
+
+/**
+ *  Random value between zero and one, to spread out retries
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ */
+static double jitter()
+{
+    // every worker has its own generator
+    static thread_local std::minstd_rand random(std::random_device{}());
+    return std::uniform_real_distribution<double>(0.0, 1.0)(random);
+}
+
 /**
  *  Retrieve or create a cached prepared statement
  *
@@ -133,13 +456,22 @@ Statement *Connection::statement(const char *query)
  *  @param  parameters  placeholder values
  *  @param  count       number of placeholder values
  */
-void Connection::prepare(const std::string& query, LocalParameter *parameters, size_t count, const std::function<void(const std::string& query)>& callback)
+void Connection::prepare(const std::string& query, LocalParameter *parameters, size_t count, const std::function<void(std::string&& query, const std::string& digest, uint64_t id)>& callback)
 {
     // keep the loop alive while the callback runs
-    auto reference = std::make_shared<React::LoopReference>(_loop);
+    InFlight reference(_inflight.get());
+
+    // trace the submission
+    auto id = ++_sequence;
+    REACT_MYSQL_PROBE(query_submit, _id, id, query.size(), 0);
+    if (auto *tracer = this->tracer()) tracer->record(id, Tracer::enqueue, StatisticsRecorder::now());
 
     // execute prepare in worker thread
-    _worker.execute([this, reference, callback, query, parameters, count] () {
+    _worker->execute([this, reference, callback, query, parameters, count, id] () {
+        // trace the start of the work
+        REACT_MYSQL_PROBE(worker_start, _id, id, query.size(), 0);
+        if (auto *tracer = this->tracer()) tracer->record(id, Tracer::start, StatisticsRecorder::now());
+
         /**
         *  Calculate the maximum storage size for the parameters.
         *
@@ -151,15 +483,15 @@ void Connection::prepare(const std::string& query, LocalParameter *parameters, s
         // add all elements
         for (size_t i = 0; i < count; ++i) size += parameters[i].size();
 
-        // the parsed query result
-        std::string result;
-        result.reserve(size);
+        // the parsed query result, shared so it is not copied with the callback
+        auto result = std::make_shared<std::string>();
+        result->reserve(size);
 
         // begin parsing at the beginning of the string
         size_t position = query.find_first_of("?!");
 
         // add the first part of the query (before the first placeholder)
-        result.append(query, 0, position);
+        result->append(query, 0, position);
 
         // process all parameters
         for (size_t i = 0; i < count; ++i)
@@ -175,11 +507,11 @@ void Connection::prepare(const std::string& query, LocalParameter *parameters, s
             {
                 case '?':
                     // we need to escape and quote
-                    result.append(parameter.quote(_connection));
+                    result->append(parameter.quote(_connection));
                     break;
                 case '!':
                     // we only need to escape
-                    result.append(parameter.escape(_connection));
+                    result->append(parameter.escape(_connection));
                     break;
             }
 
@@ -187,74 +519,234 @@ void Connection::prepare(const std::string& query, LocalParameter *parameters, s
             size_t next = query.find_first_of("?!", position + 1);
 
             // add the regular query part and store new position
-            result.append(query, position + 1, next - position - 1);
+            result->append(query, position + 1, next - position - 1);
             position = next;
         }
 
         // clean up the parameters
         delete [] parameters;
 
-        // and inform the callback
-        _master.execute([reference, callback, result]() { callback(result); });
+        // the digest of the template, so all values end up in the same digest
+        auto digest = Digest::normalize(query);
+
+        // and inform the callback, the span is delivered when the query is done
+        deliver([reference, callback, result, digest, id]() { callback(std::move(*result), digest, id); });
     });
 }
 
 /**
  *  Execute a query
  *
+ *  When a projection is given, only the named columns are
+ *  materialized in the result, all other columns are skipped.
+ *
  *  @param  query       the query to execute
+ *  @param  projection  the columns to materialize
  */
-Deferred& Connection::query(const std::string& query)
+Deferred& Connection::query(std::string query, const Projection& projection)
 {
-    // create a new deferred handler
-    auto deferred = std::make_shared<Deferred>();
+    // execute the query, the digest is computed in the worker
+    return submit(std::move(query), projection, std::string(), nullptr);
+}
+
+/**
+ *  Create a deferred handler from the pool
+ */
+std::shared_ptr<Deferred> Connection::allocate()
+{
+    // the handler and its reference count share a recycled block
+    return std::allocate_shared<Deferred>(DeferredAllocator<Deferred>(_deferreds));
+}
+
+/**
+ *  Let a read join an identical read that is on its way
+ *
+ *  @param  access      what the query does with the data
+ *  @param  query       the query
+ *  @param  variant     the projection or the parameters, that tell identical queries apart
+ *  @param  deferred    the handler of the caller
+ *  @return the handler to send the query with, or a nullptr when it joined another read
+ */
+std::shared_ptr<Deferred> Connection::board(ResultCache::Access access, const std::string& query, const std::string& variant, const std::shared_ptr<Deferred>& deferred)
+{
+    // a write changes what the reads that follow see, so they should not join the reads on their way
+    if (access == ResultCache::Access::write) _flights->close();
+
+    // only reads that depend on nothing but the data can be shared
+    if (access != ResultCache::Access::read) return deferred;
+
+    // join an identical read, if there is one
+    auto flight = _flights->board(query + variant, deferred);
+    if (!flight) return nullptr;
+
+    // the read is sent with a handler of its own, that passes the outcome to everyone on board,
+    // and that is traced with the id of the caller that started the flight
+    auto handler = allocate();
+    handler->_traced = deferred.get();
+    handler->onSuccess([this, flight](Result&& result) {
+        _flights->land(flight);
+        flight->success(std::move(result));
+    }).onFailure([this, flight](const char *error) {
+        _flights->land(flight);
+        flight->failure(error);
+    });
+
+    // done
+    return handler;
+}
+
+/**
+ *  The columns of a projection, to tell otherwise identical reads apart
+ *
+ *  @param  projection  the projection
+ */
+static std::string variant(const Projection& projection)
+{
+    // separate the columns with a character that cannot be in the query
+    std::string result;
+    for (auto &column : projection.columns()) result.append(1, '\0').append(column);
+    return result;
+}
+
+/**
+ *  Execute a query in the worker thread
+ *
+ *  @param  query       the query to execute
+ *  @param  projection  the columns to materialize
+ *  @param  digest      the digest of the query, or empty to compute it
+ *  @param  deferred    the deferred handler to use, or a nullptr for a new one
+ *  @param  id          the id of a prepared query to continue, or zero for a new one
+ */
+Deferred& Connection::submit(std::string query, const Projection& projection, std::string digest, std::shared_ptr<Deferred> deferred, uint64_t id)
+{
+    // create a new deferred handler if needed
+    if (!deferred) deferred = allocate();
 
     // keep the loop alive while the callback runs
-    auto reference = std::make_shared<React::LoopReference>(_loop);
+    InFlight reference(_inflight.get());
+
+    // is the result in the cache? writes invalidate it here
+    std::shared_ptr<ResultCache::Miss> cached;
+    if (auto result = _cache->lookup(query, projection, cached))
+    {
+        // the callbacks are not installed yet, so the result is passed from the event loop, not
+        // via the completion queue, which we cannot wait for when it is full
+        _master.execute([reference, deferred, result]() mutable { deferred->success(Result(std::move(result))); });
+        return *deferred;
+    }
+
+    // join an identical read on its way, or send the query with the handler of a new flight
+    auto caller = deferred;
+    if (_flights->enabled())
+    {
+        // find out what the query does, the tables are not needed
+        std::vector<std::string> tables;
+        if (!(deferred = board(ResultCache::classify(query, tables), query, variant(projection), caller))) return *caller;
+    }
+
+    // the moment the query was submitted
+    auto submitted = StatisticsRecorder::now();
+
+    // a prepared query continues the span that was started when it was prepared
+    bool continued = id != 0;
+
+    // trace the submission
+    if (!continued)
+    {
+        id = ++_sequence;
+        REACT_MYSQL_PROBE(query_submit, _id, id, query.size(), 0);
+        if (auto *tracer = this->tracer()) tracer->record(id, Tracer::enqueue, submitted);
+    }
+
+    // execute query in the worker thread, the strings are moved into the task
+    _worker->execute(std::bind([this, reference, projection, deferred, submitted, id, continued, cached](const std::string &query, const std::string &digest) mutable {
+        // record how long the query waited for the worker
+        auto started = StatisticsRecorder::now();
+        _statistics->queued(started - submitted);
+
+        // trace the start, unless the worker already started on it when it was prepared
+        if (!continued)
+        {
+            REACT_MYSQL_PROBE(worker_start, _id, id, query.size(), 0);
+            if (auto *tracer = this->tracer()) tracer->record(id, Tracer::start, started);
+        }
+
+        // remember the connection id, so we can see if we get reconnected
+        auto thread = mysql_thread_id(_connection);
 
-    // execute query in the worker thread
-    _worker.execute([this, reference, query, deferred]() {
         // run the query, should get zero on success
-        if (mysql_query(_connection, query.c_str()))
+        auto failed = mysql_query(_connection, query.c_str());
+
+        // record how long the server took to execute the query
+        auto executed = StatisticsRecorder::now();
+        _statistics->executed(executed - started);
+
+        // did mysql reestablish the connection to run the query?
+        if (mysql_thread_id(_connection) != thread) _statistics->reconnected();
+        REACT_MYSQL_PROBE(execute_done, _id, id, 0, 0);
+        if (auto *tracer = this->tracer()) tracer->record(id, Tracer::execute, executed);
+
+        // the digest to record the query under
+        auto fingerprint = digest.empty() ? Digest::normalize(query) : digest;
+
+        // check whether the query failed
+        if (failed)
         {
+            // record the failure for the digest
+            _digests->record(fingerprint, executed - started, 0, 0, true);
+
             // query failed, report to listener
-            if (deferred->requireStatus()) _master.execute([this, reference, deferred]() { deferred->failure(mysql_error(_connection)); });
+            fail(reference, deferred, mysql_error(_connection), id);
+
+            // report it if the query took too long anyway
+            if (slow(executed - started)) report(reference, SlowQuery(query, fingerprint, std::vector<std::string>(), started - submitted, executed - started, 0, 0, mysql_error(_connection)), nullptr);
             return;
         }
 
+        // the data received over all result sets, and the error if one of them failed
+        uint64_t rows = 0, size = 0;
+        std::string error;
+
+        // all result sets are collected here, only the master thread can tell whether they are
+        // passed at once or one by one, since the callbacks may be installed after the query was sent
+        auto results = std::make_shared<std::vector<Result>>();
+
+        // the data received for the first result set, which is the one that can be cached
+        size_t first = 0;
+
         // process all result sets
-        while (true)
+        for (bool more = true; more;)
         {
             // retrieve result set
             auto *result = mysql_store_result(_connection);
+            if (auto *tracer = this->tracer()) tracer->record(id, Tracer::fetch, StatisticsRecorder::now());
+
+            // did we get a valid response?
+            if (result)
+            {
+                // find the rows, which counts the received data
+                auto implementation = std::make_shared<QueryResultImpl>(result, projection);
+                auto count = implementation->size();
+                auto received = implementation->bytes();
+                if (results->empty()) first = received;
+                rows += count;
+                size += received;
+                REACT_MYSQL_PROBE(result_materialized, _id, id, received, count);
 
-            // are we at all interested in the result?
-            if (!deferred->requireStatus())
+                // add it to the other result sets
+                results->emplace_back(std::move(implementation));
+            }
+            else if (mysql_field_count(_connection))
             {
-                // clean up the result
-                if (result) mysql_free_result(result);
+                // the query *should* have returned a result, this is an error, the other results
+                // are still read so the connection can be used again
+                if (error.empty()) error = mysql_error(_connection);
             }
             else
             {
-                // get the number of rows affected in the query
-                size_t affectedRows = mysql_affected_rows(_connection);
-
-                // did we get a valid response?
-                if (result)
-                {
-                    // create the result and pass it to the listener
-                    _master.execute([this, reference, deferred, result]() { deferred->success(Result(result)); });
-                }
-                else if (mysql_field_count(_connection))
-                {
-                    // the query *should* have returned a result, this is an error
-                    _master.execute([this, reference, deferred]() { deferred->failure(mysql_error(_connection)); });
-                }
-                else
-                {
-                    // this is a query without a result set (i.e.: update, insert or delete)
-                    _master.execute([this, reference, deferred, affectedRows]() { deferred->success(Result(affectedRows, mysql_insert_id(_connection))); });
-                }
+                // this is a query without a result set (i.e.: update, insert or delete), with the transaction it committed
+                results->emplace_back(mysql_affected_rows(_connection), mysql_insert_id(_connection));
+                results->back()._gtids = gtids();
             }
 
             // check whether there are more results
@@ -262,22 +754,654 @@ Deferred& Connection::query(const std::string& query)
             {
                 case -1:
                     // all result sets were processed
-                    return;
+                    more = false;
+                    break;
                 case 0:
                     // ready for next result
-                    continue;
+                    break;
                 default:
                     // this is an error
-                    _master.execute([this, reference, deferred]() { deferred->failure(mysql_error(_connection)); });
-                    return;
+                    if (error.empty()) error = mysql_error(_connection);
+                    more = false;
+                    break;
             }
         }
+
+        // count the failure
+        if (!error.empty()) _statistics->failed();
+
+        // store the first result set in the cache if we missed it, and pass the result sets to the listener
+        deliver([this, reference, deferred, results, cached, first, error]() {
+            if (cached && !results->empty() && results->front()._result) _cache->store(*cached, results->front()._result, first);
+            deferred->finish(std::move(*results), error.empty() ? nullptr : error.c_str());
+        }, id, deferred.get());
+
+        // record how long it took to fetch all results, and the received data
+        auto fetched = StatisticsRecorder::now();
+        _statistics->fetched(fetched - executed);
+        _statistics->received(rows, size);
+        _digests->record(fingerprint, fetched - started, rows, size, !error.empty());
+
+        // report slow queries, now that the results were consumed
+        if (!slow(fetched - started)) return;
+        report(reference, SlowQuery(query, fingerprint, std::vector<std::string>(), started - submitted, executed - started, fetched - executed, rows, error.empty() ? nullptr : error.c_str()), [this, &query]() { return explain(query); });
+    }, std::move(query), std::move(digest)));
+
+    // return the deferred handler
+    return *caller;
+}
+
+/**
+ *  Start a transaction that runs its statements as they are added
+ *
+ *  @return the transaction
+ */
+std::shared_ptr<TransactionSession> Connection::begin()
+{
+    // keep the loop alive while the transaction is open
+    InFlight reference(_inflight.get());
+
+    // reads that follow should not join the reads before the transaction
+    _flights->close();
+
+    // forget the transactions that are gone, and remember this one, so it can be closed on destruction
+    auto session = std::make_shared<TransactionSession>();
+    _sessions.erase(std::remove_if(_sessions.begin(), _sessions.end(), [](const std::weak_ptr<TransactionSession> &other) { return other.expired(); }), _sessions.end());
+    _sessions.push_back(session);
+
+    // the worker runs the statements of the transaction, and nothing else, until it ends
+    _worker->execute([this, reference, session]() {
+        // start the transaction, if that fails, the statements fail with the error
+        perform("START TRANSACTION", nullptr, session->error);
+
+        // run the statements as they come in
+        session->run();
+
+        // a transaction that was never finished is rolled back
+        std::string error;
+        if (!session->finished) perform("ROLLBACK", nullptr, error);
+    });
+
+    // done
+    return session;
+}
+
+/**
+ *  Run a query in a transaction that was started with begin()
+ *
+ *  @param  session     the transaction
+ *  @param  query       the query to run
+ *  @return the deferred handler for the query
+ */
+Deferred& Connection::interact(const std::shared_ptr<TransactionSession>& session, std::string query)
+{
+    // create a new deferred handler
+    auto deferred = allocate();
+
+    // keep the loop alive while the callback runs
+    InFlight reference(_inflight.get());
+
+    // the results read from the tables the query writes are outdated
+    _cache->written(query);
+
+    // run the query when the worker gets to it, the string is moved into the task
+    session->execute(std::bind([this, reference, session, deferred](const std::string &query) {
+        // a doomed transaction runs nothing anymore
+        if (!session->error.empty()) return fail(reference, deferred, session->error.c_str());
+
+        // run the query, and collect its result sets
+        auto results = std::make_shared<std::vector<Result>>();
+        if (!perform(query, results.get(), session->error)) return fail(reference, deferred, session->error.c_str());
+
+        // count the rows it changed
+        for (auto &result : *results) session->affectedRows += result.affectedRows();
+
+        // and pass the result sets to the listener, before the transaction is committed
+        deliver([reference, deferred, results]() { deferred->finish(std::move(*results), nullptr); });
+    }, std::move(query)));
+
+    // return the deferred handler
+    return *deferred;
+}
+
+/**
+ *  Commit or roll back a transaction that was started with begin()
+ *
+ *  @param  session     the transaction
+ *  @param  commit      should the transaction be committed?
+ *  @return the deferred handler for the outcome
+ */
+Deferred& Connection::conclude(const std::shared_ptr<TransactionSession>& session, bool commit)
+{
+    // create a new deferred handler
+    auto deferred = allocate();
+
+    // keep the loop alive while the callback runs
+    InFlight reference(_inflight.get());
+
+    // reads that follow should not join the reads in the transaction
+    _flights->close();
+
+    // the last task of the transaction
+    session->execute([this, reference, session, deferred, commit]() {
+        // nothing runs in the transaction anymore
+        session->finished = true;
+
+        // commit it, unless it is doomed
+        auto error = session->error;
+        if (commit && error.empty() && perform("COMMIT", nullptr, error))
+        {
+            // pass the rows changed by all statements, and the transaction that was committed
+            auto affectedRows = session->affectedRows;
+            auto committed = gtids();
+            deliver([reference, deferred, affectedRows, committed]() {
+                Result result(affectedRows, 0);
+                result._gtids = committed;
+                deferred->success(std::move(result));
+            });
+            return;
+        }
+
+        // roll back what was done
+        std::string ignored;
+        perform("ROLLBACK", nullptr, ignored);
+
+        // a rollback was what was asked for, a commit failed
+        if (commit) fail(reference, deferred, error.c_str());
+        else deliver([reference, deferred]() { deferred->success(Result(0, 0)); });
     });
 
+    // this releases the worker once it ran the last task
+    session->close();
+
     // return the deferred handler
     return *deferred;
 }
 
+/**
+ *  Commit or roll back a transaction
+ *
+ *  @param  work        the transaction
+ */
+void Connection::commit(TransactionWork&& work)
+{
+    // the results read from the tables the transaction writes are outdated
+    if (work.commit) for (auto &statement : work.statements) _cache->written(statement.query);
+
+    // and reads that follow should not join the reads before the transaction
+    _flights->close();
+
+    // without group commit, or when rolling back, the transaction runs on its own
+    if (!_group || !work.commit)
+    {
+        std::vector<TransactionWork> group;
+        group.push_back(std::move(work));
+        return transact(std::move(group));
+    }
+
+    // add it to the group, and commit right away when the group is full
+    if (_group->add(std::move(work), _loop, [this]() { flush(); })) flush();
+}
+
+/**
+ *  Commit the transactions waiting in the group
+ */
+void Connection::flush()
+{
+    // is group commit enabled at all?
+    if (!_group) return;
+
+    // take the waiting transactions
+    auto group = _group->take();
+
+    // and run them
+    if (!group.empty()) transact(std::move(group));
+}
+
+/**
+ *  Run transactions in the worker thread
+ *
+ *  @param  group       the transactions
+ */
+void Connection::transact(std::vector<TransactionWork>&& group)
+{
+    // keep the loop alive while the callback runs
+    InFlight reference(_inflight.get());
+
+    // the transactions are shared with the callback in the master thread
+    auto transactions = std::make_shared<std::vector<TransactionWork>>(std::move(group));
+
+    // the moment the transactions were submitted
+    auto submitted = StatisticsRecorder::now();
+
+    // run all statements in a single task, so no other queries can end up in between
+    _worker->execute([this, reference, transactions, submitted]() {
+        // record how long the transactions waited for the worker
+        _statistics->queued(StatisticsRecorder::now() - submitted);
+
+        // transactions that are rolled back are just discarded
+        for (auto &work : *transactions) if (!work.commit) work.error = "Transaction rolled back";
+
+        // run the transactions, until they are committed or given up on
+        while (true)
+        {
+            // run the transactions that did not fail and were not committed yet, this
+            // gives the longest backoff of the transactions that were set aside
+            unsigned int code = 0;
+            size_t culprit = transactions->size();
+            uint64_t backoff = 0;
+            auto error = run(*transactions, code, culprit, backoff);
+
+            // should we run again?
+            bool retry = false;
+
+            // were the others committed?
+            if (error.empty())
+            {
+                // the transactions that were set aside run again, after their backoff outside of a server transaction
+                for (auto &work : *transactions) if (work.waiting) retry = true, work.waiting = false;
+                if (!retry) break;
+                std::this_thread::sleep_for(std::chrono::nanoseconds(backoff));
+                continue;
+            }
+
+            // the server transaction was lost, retry the transactions that allow it
+            for (size_t i = 0; i < transactions->size(); ++i)
+            {
+                // skip the transactions that already failed or were committed
+                auto &work = (*transactions)[i];
+                if (!work.error.empty() || work.committed) continue;
+
+                // when one of the transactions caused the loss, the others were innocent, and run
+                // again without using up their retries, the culprit is charged or fails every round,
+                // the transactions that were set aside were already charged
+                if (work.waiting || (culprit < transactions->size() && i != culprit))
+                {
+                    work.waiting = false;
+                    retry = true;
+                    continue;
+                }
+
+                // give up if the error is not worth retrying, or the retries ran out
+                if (!work.policy.retryable(code) || work.retries >= work.policy.attempts())
+                {
+                    work.error = error;
+                    continue;
+                }
+
+                // retry it after a backoff
+                backoff = std::max(backoff, work.policy.delay(work.retries++, jitter()));
+                _statistics->retried();
+                retry = true;
+            }
+
+            // wait before running them again, this is cheap compared to a trip through the loop
+            if (!retry) break;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(backoff));
+        }
+
+        // count the transactions that failed
+        for (auto &work : *transactions) if (work.commit && !work.error.empty()) _statistics->failed();
+
+        // report all outcomes to the master thread in one go
+        deliver([reference, transactions]() {
+            for (auto &work : *transactions)
+            {
+                // did the transaction fail?
+                if (!work.error.empty())
+                {
+                    // none of the statements took effect
+                    for (auto &statement : work.statements) statement.deferred->failure(work.error.c_str());
+
+                    // a rollback was what was asked for, a commit failed
+                    if (work.commit) work.deferred->failure(work.error.c_str());
+                    else work.deferred->success(Result(0, 0));
+                    continue;
+                }
+
+                // pass on the results of the statements
+                for (auto &statement : work.statements)
+                {
+                    // deliver all result sets at once, or one by one
+                    statement.deferred->finish(std::move(statement.results), nullptr);
+                }
+
+                // the transaction was committed
+                Result result(work.affectedRows, 0);
+                result._gtids = work.gtids;
+                work.deferred->success(std::move(result));
+            }
+        });
+    });
+}
+
+/**
+ *  Run the transactions in a single server transaction
+ *
+ *  @param  transactions    the transactions
+ *  @param  code            where to store the error code when the server transaction is lost
+ *  @param  culprit         where to store the transaction that caused the loss
+ *  @param  backoff         where to store the longest backoff of the transactions set aside
+ *  @return the error when the server transaction is lost, or an empty string
+ */
+std::string Connection::run(std::vector<TransactionWork>& transactions, unsigned int& code, size_t& culprit, uint64_t& backoff)
+{
+    // the transactions to run, they start from scratch
+    size_t running = 0;
+    for (auto &work : transactions)
+    {
+        // skip the transactions that do not have to run
+        if (!work.commit || !work.error.empty() || work.committed) continue;
+
+        // forget the results of a previous attempt
+        for (auto &statement : work.statements) statement.results.clear();
+        work.affectedRows = 0;
+        ++running;
+    }
+
+    // is there anything to run at all?
+    if (running == 0) return std::string();
+
+    // start the server transaction
+    std::string error;
+    if (!perform("START TRANSACTION", nullptr, error))
+    {
+        code = mysql_errno(_connection);
+        return error;
+    }
+
+    // run the transactions one by one
+    for (size_t i = 0; i < transactions.size() && error.empty(); ++i)
+    {
+        // skip the transactions that do not have to run
+        auto &work = transactions[i];
+        if (!work.commit || !work.error.empty() || work.committed) continue;
+
+        // with more transactions in the group, each of them gets a savepoint
+        auto savepoint = "reactcpp_" + std::to_string(i);
+        if (running > 1 && !perform("SAVEPOINT " + savepoint, nullptr, error)) break;
+
+        // run all statements, until one of them fails
+        for (auto &statement : work.statements)
+        {
+            // run the statement
+            if (!perform(statement.query, &statement.results, work.error)) break;
+
+            // add up the affected rows
+            for (auto &result : statement.results) work.affectedRows += result.affectedRows();
+        }
+
+        // if the transaction succeeded, we no longer need the savepoint
+        if (work.error.empty())
+        {
+            if (running > 1) perform("RELEASE SAVEPOINT " + savepoint, nullptr, error);
+            continue;
+        }
+
+        // the reason the transaction failed
+        auto failure = mysql_errno(_connection);
+
+        // undo just this transaction, the server may have rolled back everything already
+        if (running == 1 || !perform("ROLLBACK TO SAVEPOINT " + savepoint, nullptr, error))
+        {
+            // the server transaction is lost because of this transaction, it is up to the caller to retry it
+            error = std::move(work.error);
+            work.error.clear();
+            code = failure;
+            culprit = i;
+            break;
+        }
+
+        // retry the transaction on its own, if that is allowed, but not while the server transaction
+        // holds the locks of the others: it is set aside, and runs again after they are committed
+        if (!work.policy.retryable(failure) || work.retries >= work.policy.attempts()) continue;
+        backoff = std::max(backoff, work.policy.delay(work.retries++, jitter()));
+        _statistics->retried();
+        work.error.clear();
+        work.waiting = true;
+    }
+
+    // commit everything that succeeded
+    if (error.empty() && !perform("COMMIT", nullptr, error)) code = mysql_errno(_connection);
+
+    // did everything go well?
+    if (error.empty())
+    {
+        // remember the transaction we committed
+        auto committed = gtids();
+        for (auto &work : transactions)
+        {
+            // skip the transactions that did not run in it
+            if (!work.commit || !work.error.empty() || work.committed || work.waiting) continue;
+            work.gtids = committed;
+            work.committed = true;
+        }
+        return error;
+    }
+
+    // remember why, if we did not know yet
+    if (code == 0) code = mysql_errno(_connection);
+
+    // and roll back
+    std::string ignored;
+    perform("ROLLBACK", nullptr, ignored);
+    return error;
+}
+
+/**
+ *  Run a query and collect its result sets
+ *
+ *  @param  query       the query to run
+ *  @param  results     where to store the result sets, or a nullptr to discard them
+ *  @param  error       where to store the error
+ *  @return did the query succeed?
+ */
+bool Connection::perform(const std::string& query, std::vector<Result> *results, std::string& error)
+{
+    // run the query, should get zero on success
+    if (mysql_query(_connection, query.c_str()))
+    {
+        error = mysql_error(_connection);
+        return false;
+    }
+
+    // process all result sets
+    while (true)
+    {
+        // retrieve result set
+        auto *result = mysql_store_result(_connection);
+
+        // store the result set, or the affected rows for queries without one
+        if (result && results) results->emplace_back(result, Projection());
+        else if (result) mysql_free_result(result);
+        else if (mysql_field_count(_connection)) break;
+        else if (results) results->emplace_back((size_t)mysql_affected_rows(_connection), mysql_insert_id(_connection));
+
+        // check whether there are more results
+        switch (mysql_next_result(_connection))
+        {
+            case -1:    return true;
+            case 0:     break;
+            default:    error = mysql_error(_connection); return false;
+        }
+    }
+
+    // the query *should* have returned a result, this is an error
+    error = mysql_error(_connection);
+    return false;
+}
+
+/**
+ *  The GTIDs of the transaction committed by the last query
+ *
+ *  @return the GTIDs, or an empty string if they are not tracked
+ */
+std::string Connection::gtids()
+{
+    // the GTIDs, there may be more than one
+    std::string result;
+
+#if MYSQL_VERSION_ID >= 50707 && !defined(MARIADB_BASE_VERSION)
+    // the data sent by the server
+    const char *data;
+    size_t length;
+
+    // collect all of them
+    for (auto found = mysql_session_track_get_first(_connection, SESSION_TRACK_GTIDS, &data, &length); found == 0; found = mysql_session_track_get_next(_connection, SESSION_TRACK_GTIDS, &data, &length))
+    {
+        if (!result.empty()) result.push_back(',');
+        result.append(data, length);
+    }
+#endif
+
+    // return the GTIDs
+    return result;
+}
+
+/**
+ *  Run a query and stream its rows to the master thread
+ *
+ *  @param  query       the query to run
+ *  @param  batch       the number of rows to pass at once
+ *  @param  backlog     the number of batches that can be pending
+ *  @param  stop        the flag to stop reading rows
+ *  @param  pending     the number of batches the receiver is not done with
+ *  @param  rows        callback for every batch of rows
+ *  @param  done        callback when the query is done
+ */
+void Connection::stream(std::string query, size_t batch, std::shared_ptr<Throttle> throttle, std::function<void(const std::shared_ptr<StreamedResultImpl>& rows)> rows, std::function<void(const std::shared_ptr<const std::map<std::string, size_t>>& fields, const std::shared_ptr<const std::vector<bool>>& numeric, const char *error)> done)
+{
+    // keep the loop alive while the callbacks run
+    InFlight reference(_inflight.get());
+
+    // the moment the query was submitted
+    auto submitted = StatisticsRecorder::now();
+
+    // forget the streams that are gone, and remember this one, so it can be stopped on destruction
+    _throttles.erase(std::remove_if(_throttles.begin(), _throttles.end(), [](const std::weak_ptr<Throttle> &other) { return other.expired(); }), _throttles.end());
+    _throttles.push_back(throttle);
+
+    // execute query in the worker thread, the string is moved into the task
+    _worker->execute(std::bind([this, reference, batch, throttle, rows, done, submitted](const std::string &query) {
+        // record how long the query waited for the worker
+        auto started = StatisticsRecorder::now();
+        _statistics->queued(started - submitted);
+
+        // the digest to record the query under
+        auto fingerprint = Digest::normalize(query);
+
+        // run the query, should get zero on success
+        auto failed = mysql_query(_connection, query.c_str());
+
+        // record how long the server took to execute the query
+        auto executed = StatisticsRecorder::now();
+        _statistics->executed(executed - started);
+
+        // check whether the query failed
+        if (failed)
+        {
+            // record the failure
+            std::string error = mysql_error(_connection);
+            _digests->record(fingerprint, executed - started, 0, 0, true);
+            _statistics->failed();
+
+            // and report it to the master thread
+            return deliver([reference, done, error]() { done(nullptr, nullptr, error.c_str()); });
+        }
+
+        // read the rows as they come in, instead of storing the entire result first
+        auto *result = mysql_use_result(_connection);
+
+        // the fields of the result, which of them hold numbers, and the error if reading it failed
+        std::shared_ptr<std::map<std::string, size_t>> fields;
+        std::shared_ptr<std::vector<bool>> numeric;
+        std::string error;
+
+        // the data received
+        uint64_t count = 0, size = 0;
+
+        // did we get a result set?
+        if (result)
+        {
+            // the number of fields
+            auto number = mysql_num_fields(result);
+
+            // find the index and the type of every field
+            fields = std::make_shared<std::map<std::string, size_t>>();
+            numeric = std::make_shared<std::vector<bool>>(number);
+            for (size_t i = 0; i < number; ++i)
+            {
+                auto field = mysql_fetch_field_direct(result, i);
+                (*fields)[std::string(field->name, field->name_length)] = i;
+                (*numeric)[i] = IS_NUM(field->type);
+            }
+
+            // the batch we are filling
+            std::shared_ptr<StreamedResultImpl> current;
+
+            // read rows until there are no more, or we are asked to stop
+            while (!throttle->stopped())
+            {
+                // fetch the next row
+                auto row = mysql_fetch_row(result);
+                if (!row) break;
+
+                // copy the row, the buffer is reused for the next one
+                auto lengths = mysql_fetch_lengths(result);
+                if (!current) current = std::make_shared<StreamedResultImpl>(fields, numeric);
+                current->add(std::make_shared<StreamedRow>(row, lengths, number));
+
+                // count the received data
+                ++count;
+                size = std::accumulate(lengths, lengths + number, size);
+
+                // is the batch full?
+                if (current->size() < batch) continue;
+
+                // wait until the receiver catches up, the server waits for us in the meantime
+                throttle->acquire();
+
+                // pass it to the master thread
+                deliver([reference, rows, current]() { rows(current); });
+                current.reset();
+            }
+
+            // a missing row can also be an error
+            if (!throttle->stopped() && mysql_errno(_connection)) error = mysql_error(_connection);
+
+            // pass the last rows, these are counted too
+            if (current)
+            {
+                throttle->acquire();
+                deliver([reference, rows, current]() { rows(current); });
+            }
+
+            // clean up the result, this reads and discards the rows that we did not pass
+            mysql_free_result(result);
+        }
+        else if (mysql_field_count(_connection))
+        {
+            // the query *should* have returned a result, this is an error
+            error = mysql_error(_connection);
+        }
+
+        // discard other result sets, so the connection can be used again
+        while (mysql_next_result(_connection) == 0) if (auto *other = mysql_store_result(_connection)) mysql_free_result(other);
+
+        // record how long it took to fetch the rows, and the received data
+        auto fetched = StatisticsRecorder::now();
+        _statistics->fetched(fetched - executed);
+        _statistics->received(count, size);
+        _digests->record(fingerprint, fetched - started, count, size, !error.empty());
+        if (!error.empty()) _statistics->failed();
+
+        // report that we are done
+        std::shared_ptr<const std::map<std::string, size_t>> shared(fields);
+        std::shared_ptr<const std::vector<bool>> types(numeric);
+        deliver([reference, done, shared, types, error]() { done(shared, types, error.empty() ? nullptr : error.c_str()); });
+    }, std::move(query)));
+}
+
 /**
  *  End namespace
  */
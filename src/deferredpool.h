@@ -0,0 +1,182 @@
+/**
+ *  DeferredPool.h
+ *
+ *  Pool of memory blocks for deferred objects. The deferred handlers
+ *  are created with std::allocate_shared() and an allocator from this
+ *  pool, so the handler and its reference count live in one block,
+ *  and blocks are recycled instead of going back to the heap. The
+ *  handlers are released by both the master and the worker thread,
+ *  so the pool is locked, but the lock is held for only a few
+ *  instructions and hardly ever contended.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Deferred pool class
+ */
+class DeferredPool
+{
+private:
+    /**
+     *  Lock protecting the free blocks
+     */
+    std::mutex _mutex;
+
+    /**
+     *  The free blocks
+     */
+    std::vector<void*> _blocks;
+
+    /**
+     *  The size of the blocks, known after the first one is returned
+     */
+    size_t _size = 0;
+
+    /**
+     *  The maximum number of free blocks to keep
+     */
+    size_t _capacity;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  capacity    the maximum number of free blocks to keep
+     */
+    DeferredPool(size_t capacity = 1024) : _capacity(capacity)
+    {
+        // make sure returning a block never allocates
+        _blocks.reserve(capacity);
+    }
+
+    /**
+     *  Destructor
+     */
+    ~DeferredPool()
+    {
+        // free all blocks
+        for (auto *block : _blocks) ::operator delete(block);
+    }
+
+    /**
+     *  Get a block of memory
+     *
+     *  @param  size        the size of the block
+     */
+    void *allocate(size_t size)
+    {
+        {
+            // reuse a free block if it has the right size
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (size == _size && !_blocks.empty())
+            {
+                auto *block = _blocks.back();
+                _blocks.pop_back();
+                return block;
+            }
+        }
+
+        // no block available, allocate a new one
+        return ::operator new(size);
+    }
+
+    /**
+     *  Return a block of memory
+     *
+     *  @param  block       the block to return
+     *  @param  size        the size of the block
+     */
+    void deallocate(void *block, size_t size)
+    {
+        {
+            // keep the block if we have room for it
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_size == 0) _size = size;
+            if (size == _size && _blocks.size() < _capacity) return _blocks.push_back(block);
+        }
+
+        // we do not need the block
+        ::operator delete(block);
+    }
+};
+
+/**
+ *  Allocator using the pool, the allocator keeps the pool
+ *  alive, so handlers may outlive the connection
+ */
+template <typename T>
+class DeferredAllocator
+{
+private:
+    /**
+     *  The pool to allocate from
+     */
+    std::shared_ptr<DeferredPool> _pool;
+
+    // allocators for other types may access the pool
+    template <typename U>
+    friend class DeferredAllocator;
+
+public:
+    /**
+     *  The type we allocate
+     */
+    typedef T value_type;
+
+    /**
+     *  Constructor
+     *
+     *  @param  pool        the pool to allocate from
+     */
+    DeferredAllocator(const std::shared_ptr<DeferredPool> &pool) : _pool(pool) {}
+
+    /**
+     *  Constructor from an allocator for another type
+     *
+     *  @param  that        the other allocator
+     */
+    template <typename U>
+    DeferredAllocator(const DeferredAllocator<U> &that) : _pool(that._pool) {}
+
+    /**
+     *  Allocate memory for objects
+     *
+     *  @param  count       the number of objects
+     */
+    T *allocate(size_t count)
+    {
+        return static_cast<T*>(_pool->allocate(count * sizeof(T)));
+    }
+
+    /**
+     *  Free memory for objects
+     *
+     *  @param  objects     the objects
+     *  @param  count       the number of objects
+     */
+    void deallocate(T *objects, size_t count)
+    {
+        _pool->deallocate(objects, count * sizeof(T));
+    }
+
+    /**
+     *  Compare allocators
+     *
+     *  @param  that        the other allocator
+     */
+    template <typename U>
+    bool operator==(const DeferredAllocator<U> &that) const { return _pool == that._pool; }
+    template <typename U>
+    bool operator!=(const DeferredAllocator<U> &that) const { return _pool != that._pool; }
+};
+
+/**
+ *  End namespace
+ */
+}}
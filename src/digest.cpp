@@ -0,0 +1,243 @@
+/**
+ *  Digest.cpp
+ *
+ *  Aggregate statistics for all queries that share the same shape
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  The maximum length of a digest
+ */
+static const size_t maxLength = 4096;
+
+/**
+ *  Can the character be part of an identifier or keyword?
+ *
+ *  @param  c       the character to check
+ */
+static bool identifier(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$' || (c & 0x80);
+}
+
+/**
+ *  The keywords that are written in uppercase, sorted so they can be searched
+ */
+static const char *keywords[] = {
+    "all", "alter", "and", "as", "asc", "begin", "between", "binary", "by", "call", "case",
+    "collate", "commit", "create", "cross", "current", "default", "delayed", "delete", "desc",
+    "describe", "distinct", "distinctrow", "div", "do", "drop", "duplicate", "else", "end",
+    "escape", "except", "exists", "explain", "false", "following", "for", "from", "group", "having",
+    "high_priority", "if", "ignore", "in", "index", "inner", "insert", "intersect", "interval",
+    "into", "is", "join", "key", "left", "like", "limit", "lock", "locked", "low_priority", "mod",
+    "mode", "natural", "not", "nowait", "null", "offset", "on", "or", "order", "outer", "over",
+    "partition", "preceding", "quick", "range", "recursive", "regexp", "release", "replace",
+    "right", "rlike", "rollback", "row", "rows", "savepoint", "select", "separator", "set", "share",
+    "show", "skip", "sql_calc_found_rows", "sql_no_cache", "start", "straight_join", "table",
+    "then", "transaction", "true", "truncate", "unbounded", "union", "update", "use", "using",
+    "value", "values", "when", "where", "window", "with", "xor"
+};
+
+/**
+ *  The length of the longest keyword
+ */
+static const size_t longest = 19;
+
+/**
+ *  Is a word a keyword, regardless of its case?
+ *
+ *  @param  word    the start of the word
+ *  @param  length  the length of the word
+ */
+static bool keyword(const char *word, size_t length)
+{
+    // longer words are never keywords
+    if (length > longest) return false;
+
+    // the word in lowercase
+    char lower[longest + 1];
+    for (size_t i = 0; i < length; ++i) lower[i] = tolower(static_cast<unsigned char>(word[i]));
+    lower[length] = '\0';
+
+    // look it up
+    return std::binary_search(keywords, keywords + sizeof(keywords) / sizeof(keywords[0]), lower, [](const char *a, const char *b) { return strcmp(a, b) < 0; });
+}
+
+/**
+ *  Add a literal to the digest, collapsing lists of literals
+ *
+ *  @param  result  the digest built so far
+ */
+static void literal(std::string &result)
+{
+    // the current size of the digest
+    size_t size = result.size();
+
+    // are we directly following another literal in a list?
+    if (size >= 2 && result[size - 1] == ',' && (result[size - 2] == '?' || result[size - 2] == '+')) result.resize(size - 1);
+    else if (size >= 3 && result[size - 1] == ' ' && result[size - 2] == ',' && (result[size - 3] == '?' || result[size - 3] == '+')) result.resize(size - 2);
+
+    // if not, this is just a single literal
+    else return result.push_back('?');
+
+    // mark the previous literal as the start of a list
+    if (result.back() == '?') result.push_back('+');
+}
+
+/**
+ *  Normalize a query into its digest
+ *
+ *  @param  query   the query to normalize
+ */
+std::string Digest::normalize(const std::string& query)
+{
+    // the resulting digest, and the size of the query
+    std::string result;
+    size_t size = query.size();
+
+    // the digest is never longer than the query
+    result.reserve(std::min(size, maxLength));
+
+    // do we have whitespace to write before the next token
+    bool space = false;
+
+    // process the query
+    for (size_t i = 0; i < size && result.size() < maxLength;)
+    {
+        // the character to process
+        char c = query[i];
+
+        // fold all whitespace
+        if (std::isspace(static_cast<unsigned char>(c)))
+        {
+            space = true;
+            ++i;
+            continue;
+        }
+
+        // skip comments that run until the end of the line
+        if (c == '#' || (c == '-' && i + 2 < size && query[i + 1] == '-' && std::isspace(static_cast<unsigned char>(query[i + 2]))))
+        {
+            i = query.find('\n', i);
+            if (i == std::string::npos) i = size;
+            space = true;
+            continue;
+        }
+
+        // skip block comments
+        if (c == '/' && i + 1 < size && query[i + 1] == '*')
+        {
+            i = query.find("*/", i + 2);
+            i = i == std::string::npos ? size : i + 2;
+            space = true;
+            continue;
+        }
+
+        // write the folded whitespace, but not at the start
+        if (space && !result.empty()) result.push_back(' ');
+        space = false;
+
+        // replace quoted strings
+        if (c == '\'' || c == '"')
+        {
+            // find the closing quote, taking escapes into account
+            for (++i; i < size; ++i)
+            {
+                // skip escaped characters
+                if (query[i] == '\\') { ++i; continue; }
+
+                // is this the closing quote?
+                if (query[i] != c) continue;
+
+                // a doubled quote does not end the string
+                if (i + 1 < size && query[i + 1] == c) { ++i; continue; }
+
+                // this is the end
+                break;
+            }
+
+            // skip the closing quote and add the literal
+            ++i;
+            literal(result);
+            continue;
+        }
+
+        // copy quoted identifiers as they are
+        if (c == '`')
+        {
+            // find the closing backtick
+            auto end = query.find('`', i + 1);
+            end = end == std::string::npos ? size : end + 1;
+
+            // copy the identifier
+            result.append(query, i, end - i);
+            i = end;
+            continue;
+        }
+
+        // replace numbers, but not digits inside identifiers
+        if (std::isdigit(static_cast<unsigned char>(c)) && (result.empty() || !identifier(result.back())))
+        {
+            // skip the digits, decimal points, exponents and hexadecimal values
+            for (++i; i < size; ++i)
+            {
+                // the character to check
+                char n = query[i];
+
+                // the sign of an exponent is part of the number
+                if ((n == '+' || n == '-') && (query[i - 1] == 'e' || query[i - 1] == 'E')) continue;
+
+                // stop at anything that cannot be part of a number
+                if (!identifier(n) && n != '.') break;
+            }
+
+            // add the literal
+            literal(result);
+            continue;
+        }
+
+        // placeholders are literals too
+        if (c == '?')
+        {
+            ++i;
+            literal(result);
+            continue;
+        }
+
+        // keywords are written in uppercase, other words are copied as they are
+        if (identifier(c))
+        {
+            // find the end of the word
+            auto end = i + 1;
+            while (end < size && identifier(query[end])) ++end;
+
+            // keywords are added in uppercase, other words as they are
+            if (keyword(query.data() + i, end - i)) for (; i < end; ++i) result.push_back(toupper(static_cast<unsigned char>(query[i])));
+            else result.append(query, i, end - i);
+
+            // continue after the word
+            i = end;
+            continue;
+        }
+
+        // copy all other characters
+        result.push_back(c);
+        ++i;
+    }
+
+    // done
+    return result;
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,108 @@
+/**
+ *  DigestTable.h
+ *
+ *  Bounded table with the aggregate statistics per query digest.
+ *  When the table is full, new digests are aggregated into a
+ *  single catch-all entry.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Digest table class
+ */
+class DigestTable
+{
+private:
+    /**
+     *  Lock protecting the table, the worker writes and the master reads
+     */
+    mutable std::mutex _mutex;
+
+    /**
+     *  The statistics for each digest
+     */
+    std::unordered_map<std::string, Digest> _digests;
+
+    /**
+     *  The catch-all entry for when the table is full
+     */
+    Digest _other;
+
+    /**
+     *  The maximum number of digests to track
+     */
+    size_t _capacity;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  capacity    the maximum number of digests to track
+     */
+    DigestTable(size_t capacity = 1024) : _other("(other)"), _capacity(capacity) {}
+
+    /**
+     *  Record an execution
+     *
+     *  @param  digest      the digest of the query
+     *  @param  latency     the time spent executing and fetching
+     *  @param  rows        the number of rows received
+     *  @param  bytes       the number of bytes received
+     *  @param  failed      did the execution fail
+     */
+    void record(const std::string& digest, uint64_t latency, uint64_t rows, uint64_t bytes, bool failed)
+    {
+        // lock the table
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // find the digest, or the catch-all entry if the table is full
+        auto iter = _digests.find(digest);
+        if (iter == _digests.end() && _digests.size() < _capacity) iter = _digests.emplace(digest, Digest(digest)).first;
+        auto &entry = iter == _digests.end() ? _other : iter->second;
+
+        // update the counters
+        entry._calls += 1;
+        entry._errors += failed ? 1 : 0;
+        entry._latency += latency;
+        entry._max = std::max(entry._max, latency);
+        entry._rows += rows;
+        entry._bytes += bytes;
+    }
+
+    /**
+     *  Take a snapshot of the table
+     *
+     *  The digests are sorted by the total time spent on them,
+     *  so the most expensive query shapes come first.
+     */
+    std::vector<Digest> snapshot() const
+    {
+        // the result
+        std::vector<Digest> result;
+
+        {
+            // lock the table and copy the digests
+            std::lock_guard<std::mutex> lock(_mutex);
+            result.reserve(_digests.size() + 1);
+            for (auto &digest : _digests) result.push_back(digest.second);
+            if (_other._calls) result.push_back(_other);
+        }
+
+        // sort by the total latency
+        std::sort(result.begin(), result.end(), [](const Digest &a, const Digest &b) { return a.latency() > b.latency(); });
+
+        // done
+        return result;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,190 @@
+/**
+ *  FanOut.cpp
+ *
+ *  Class for running the same query on a number of connections at
+ *  once, and merging the rows they return.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Constructor
+ *
+ *  @param  connections the connections to run the query on
+ *  @param  batch       the number of rows passed from a worker at once
+ *  @param  backlog     the number of batches that can wait for the merge
+ */
+FanOut::FanOut(std::vector<Connection*> connections, size_t batch, size_t backlog) :
+    _connections(std::move(connections)),
+    _batch(batch ? batch : 1),
+    _backlog(backlog ? backlog : 1),
+    _merge(std::make_shared<FanOutMerge>())
+{}
+
+/**
+ *  Destructor
+ */
+FanOut::~FanOut()
+{
+    // the running queries should no longer call us
+    cancel();
+}
+
+/**
+ *  Make sure the query did not start yet
+ */
+void FanOut::configurable() const
+{
+    if (_merge->started()) throw Exception("Fan-out query already started");
+}
+
+/**
+ *  Merge the rows on a column
+ *
+ *  @param  column      the column to order on
+ *  @param  order       the direction to order in
+ */
+FanOut& FanOut::orderBy(const std::string& column, Order order)
+{
+    configurable();
+    _merge->order(column, order);
+    return *this;
+}
+
+/**
+ *  Limit the number of merged rows
+ *
+ *  @param  rows        the maximum number of rows
+ */
+FanOut& FanOut::limit(size_t rows)
+{
+    configurable();
+    _merge->limit(rows);
+    return *this;
+}
+
+/**
+ *  Group the aggregated rows on a column
+ *
+ *  @param  column      the column to group on
+ */
+FanOut& FanOut::groupBy(const std::string& column)
+{
+    configurable();
+    _merge->group(column);
+    return *this;
+}
+
+/**
+ *  Combine the partial aggregates in a column
+ *
+ *  @param  column      the column with the partial aggregates
+ *  @param  function    how to combine them
+ */
+FanOut& FanOut::aggregate(const std::string& column, Aggregate function)
+{
+    configurable();
+    _merge->aggregate(column, function);
+    return *this;
+}
+
+/**
+ *  Run the query on all connections
+ *
+ *  @param  query       the query to run
+ */
+FanOut& FanOut::query(std::string query)
+{
+    // we need connections to run on
+    configurable();
+    if (_connections.empty()) throw Exception("Fan-out query without connections");
+
+    // a connection that appears more than once runs its queries one after the other, so the
+    // merge may need all rows of one of them before it gets the rows of the next, which is
+    // only possible when their batches are not limited
+    std::vector<size_t> backlogs;
+    for (auto *connection : _connections) backlogs.push_back(std::count(_connections.begin(), _connections.end(), connection) > 1 ? SIZE_MAX : _backlog);
+
+    // the merge is shared with the running queries, so it outlives us if needed
+    auto merge = _merge;
+    merge->start(backlogs);
+
+    // start the query on all connections, the callbacks run in the master thread
+    for (size_t shard = 0; shard < _connections.size(); ++shard)
+    {
+        _connections[shard]->stream(query, _batch, merge->throttle(shard), [merge, shard](const std::shared_ptr<StreamedResultImpl>& rows) {
+            // merge the rows
+            merge->rows(shard, rows);
+        }, [merge, shard](const std::shared_ptr<const std::map<std::string, size_t>>& fields, const std::shared_ptr<const std::vector<bool>>& numeric, const char *error) {
+            // the connection is done
+            merge->done(shard, fields, numeric, error);
+        });
+    }
+
+    // allow chaining
+    return *this;
+}
+
+/**
+ *  Stop the query
+ */
+void FanOut::cancel()
+{
+    _merge->cancel();
+}
+
+/**
+ *  Register a callback for every merged row
+ *
+ *  @param  callback    the callback to execute
+ */
+FanOut& FanOut::onRow(const std::function<void(ResultRow&& row)>& callback)
+{
+    _merge->onRow(callback);
+    return *this;
+}
+
+/**
+ *  Register a callback to be executed when the query succeeds
+ *
+ *  @param  callback    the callback to execute
+ */
+FanOut& FanOut::onSuccess(const std::function<void(Result&& result)>& callback)
+{
+    _merge->onSuccess(callback);
+    return *this;
+}
+
+/**
+ *  Register a callback to be executed when the query fails
+ *
+ *  @param  callback    the callback to execute
+ */
+FanOut& FanOut::onFailure(const std::function<void(const char *error)>& callback)
+{
+    _merge->onFailure(callback);
+    return *this;
+}
+
+/**
+ *  Register a callback to be executed when the query is finished
+ *
+ *  @param  callback    the callback to execute
+ */
+FanOut& FanOut::onComplete(const std::function<void()>& callback)
+{
+    _merge->onComplete(callback);
+    return *this;
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,777 @@
+/**
+ *  FanOutMerge.h
+ *
+ *  The merge of the rows that a fan-out query returns on its connections.
+ *  Rows that are ordered are merged as they come in: the next row is only
+ *  passed on when every connection that is still running has a row
+ *  waiting, so it is known to be the lowest. Aggregated rows are combined
+ *  per group, and passed on when all connections are done. This object is
+ *  only used from the master thread.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Fan-out merge class
+ */
+class FanOutMerge
+{
+private:
+    /**
+     *  The rows waiting from a single connection
+     */
+    struct Shard
+    {
+        /**
+         *  The batches of rows, and the position in the first one
+         */
+        std::deque<std::shared_ptr<StreamedResultImpl>> batches;
+        size_t position = 0;
+
+        /**
+         *  The batches passed by the worker that we are not done
+         *  with, the worker stops reading when there are too many
+         */
+        std::shared_ptr<Throttle> throttle;
+
+        /**
+         *  Did the connection pass all its rows?
+         */
+        bool done = false;
+    };
+
+    /**
+     *  The combined value of an aggregated column in a group
+     */
+    struct Accumulator
+    {
+        /**
+         *  Did we get a value yet?
+         */
+        bool null = true;
+
+        /**
+         *  Are all values so far integers, and their sum
+         */
+        bool integral = true;
+        int64_t integer = 0;
+
+        /**
+         *  The sum when not all values are integers
+         */
+        double real = 0.0;
+
+        /**
+         *  The minimum or maximum
+         */
+        std::string text;
+    };
+
+    /**
+     *  A group of aggregated rows
+     */
+    struct Group
+    {
+        /**
+         *  The first row of the group
+         */
+        std::shared_ptr<StreamedRow> first;
+
+        /**
+         *  The combined values of the aggregated columns
+         */
+        std::vector<Accumulator> values;
+    };
+
+    /**
+     *  The columns to order on, and the direction
+     */
+    std::vector<std::pair<std::string, FanOut::Order>> _order;
+
+    /**
+     *  The maximum number of rows to pass
+     */
+    size_t _limit = SIZE_MAX;
+
+    /**
+     *  The columns to group on
+     */
+    std::vector<std::string> _groups;
+
+    /**
+     *  The aggregated columns, and how to combine them
+     */
+    std::vector<std::pair<std::string, FanOut::Aggregate>> _aggregates;
+
+    /**
+     *  The callbacks
+     */
+    std::function<void(ResultRow&& row)> _rowCallback;
+    std::function<void(Result&& result)> _successCallback;
+    std::function<void(const char *error)> _failureCallback;
+    std::function<void()> _completeCallback;
+
+    /**
+     *  The rows waiting from every connection
+     */
+    std::vector<Shard> _shards;
+
+    /**
+     *  The connections with a row waiting, ordered as a heap on their first row
+     */
+    std::vector<size_t> _heap;
+
+    /**
+     *  The number of running connections without a row waiting,
+     *  and the number of connections that are still running
+     */
+    size_t _waiting = 0;
+    size_t _running = 0;
+
+    /**
+     *  The number of rows passed
+     */
+    size_t _emitted = 0;
+
+    /**
+     *  Did the query start, and did we already report the outcome?
+     */
+    bool _started = false;
+    bool _finished = false;
+
+    /**
+     *  The fields of the result, which of them hold numbers, and the
+     *  indices of the columns to order on, to group on and to aggregate
+     */
+    std::shared_ptr<const std::map<std::string, size_t>> _fields;
+    std::shared_ptr<const std::vector<bool>> _numeric;
+    std::vector<std::pair<size_t, FanOut::Order>> _keys;
+    std::vector<size_t> _grouped;
+    std::vector<int> _aggregated;
+
+    /**
+     *  The groups of aggregated rows, in the order they were
+     *  found, and where to find them by their values
+     */
+    std::vector<Group> _groupRows;
+    std::unordered_map<std::string, size_t> _groupIndex;
+
+    /**
+     *  All merged rows, when they are delivered at once
+     */
+    std::shared_ptr<StreamedResultImpl> _collected;
+
+    /**
+     *  Parse a value as a number
+     *
+     *  @param  value       the value
+     *  @param  length      the length of the value
+     *  @param  result      where to store the number
+     *  @return is the value a number?
+     */
+    static bool number(const char *value, size_t length, double &result)
+    {
+        // empty values are no numbers
+        if (length == 0) return false;
+
+        // the entire value should be parsed
+        char *end;
+        result = strtod(value, &end);
+        return end == value + length;
+    }
+
+    /**
+     *  Parse a value as an integer
+     *
+     *  @param  value       the value
+     *  @param  length      the length of the value
+     *  @param  result      where to store the integer
+     *  @return is the value an integer?
+     */
+    static bool integer(const char *value, size_t length, int64_t &result)
+    {
+        // empty values are no integers
+        if (length == 0) return false;
+
+        // the entire value should be parsed, without overflowing
+        char *end;
+        errno = 0;
+        result = strtoll(value, &end, 10);
+        return end == value + length && errno == 0;
+    }
+
+    /**
+     *  Compare two values
+     *
+     *  @param  a           the first value, or a nullptr for NULL
+     *  @param  alength     the length of the first value
+     *  @param  b           the second value, or a nullptr for NULL
+     *  @param  blength     the length of the second value
+     *  @param  numeric     does the column hold numbers?
+     *  @return negative, zero or positive when the first value is lower, equal or higher
+     */
+    static int compare(const char *a, size_t alength, const char *b, size_t blength, bool numeric)
+    {
+        // NULL comes first
+        if (!a || !b) return (a != nullptr) - (b != nullptr);
+
+        // compare numbers by their value, exactly when they are integers
+        int64_t i, j;
+        if (numeric && integer(a, alength, i) && integer(b, blength, j)) return (i > j) - (i < j);
+        double x, y;
+        if (numeric && number(a, alength, x) && number(b, blength, y)) return (x > y) - (x < y);
+
+        // compare other values bytewise
+        auto result = memcmp(a, b, std::min(alength, blength));
+        return result ? result : (alength > blength) - (alength < blength);
+    }
+
+    /**
+     *  Does a column hold numbers, according to its type?
+     *
+     *  @param  column      index of the column
+     */
+    bool numeric(size_t column) const
+    {
+        return _numeric && column < _numeric->size() && (*_numeric)[column];
+    }
+
+    /**
+     *  Does a row come before another?
+     *
+     *  @param  a           the first row
+     *  @param  b           the second row
+     */
+    bool less(const StreamedRow &a, const StreamedRow &b) const
+    {
+        // compare the columns until they differ
+        for (auto &key : _keys)
+        {
+            auto result = compare(a.value(key.first), a.length(key.first), b.value(key.first), b.length(key.first), numeric(key.first));
+            if (result) return key.second == FanOut::ascending ? result < 0 : result > 0;
+        }
+
+        // the rows are equal
+        return false;
+    }
+
+    /**
+     *  The first waiting row of a connection
+     *
+     *  @param  shard       index of the connection
+     */
+    const StreamedRow &head(size_t shard) const
+    {
+        auto &waiting = _shards[shard];
+        return *waiting.batches.front()->row(waiting.position);
+    }
+
+    /**
+     *  Is the heap entry of a connection ordered after another?
+     *
+     *  @param  a           index of the first connection
+     *  @param  b           index of the second connection
+     */
+    bool after(size_t a, size_t b) const
+    {
+        // equal rows are taken from the connections in order
+        if (less(head(b), head(a))) return true;
+        if (less(head(a), head(b))) return false;
+        return a > b;
+    }
+
+    /**
+     *  Add a connection to the heap
+     *
+     *  @param  shard       index of the connection
+     */
+    void push(size_t shard)
+    {
+        _heap.push_back(shard);
+        std::push_heap(_heap.begin(), _heap.end(), [this](size_t a, size_t b) { return after(a, b); });
+    }
+
+    /**
+     *  Take the connection with the lowest row from the heap
+     */
+    size_t pop()
+    {
+        std::pop_heap(_heap.begin(), _heap.end(), [this](size_t a, size_t b) { return after(a, b); });
+        auto shard = _heap.back();
+        _heap.pop_back();
+        return shard;
+    }
+
+    /**
+     *  Are the rows aggregated?
+     */
+    bool aggregating() const
+    {
+        return !_groups.empty() || !_aggregates.empty();
+    }
+
+    /**
+     *  Report a column that is not in the result
+     *
+     *  @param  column      name of the column
+     *  @return always false
+     */
+    bool unknown(const std::string &column)
+    {
+        fail(("Unknown column " + column).c_str());
+        return false;
+    }
+
+    /**
+     *  Find the columns we work with
+     *
+     *  @param  fields      the fields of the result
+     *  @param  numeric     which fields hold numbers
+     *  @return did we find all columns?
+     */
+    bool resolve(const std::shared_ptr<const std::map<std::string, size_t>> &fields, const std::shared_ptr<const std::vector<bool>> &numeric)
+    {
+        // did we already do this?
+        if (_fields || !fields) return true;
+        _fields = fields;
+        _numeric = numeric;
+
+        // the index of a column
+        auto index = [this](const std::string &column) -> int {
+            auto iter = _fields->find(column);
+            return iter == _fields->end() ? -1 : iter->second;
+        };
+
+        // find the columns to order on
+        for (auto &key : _order)
+        {
+            auto found = index(key.first);
+            if (found < 0) return unknown(key.first);
+            _keys.emplace_back(found, key.second);
+        }
+
+        // find the columns to group on
+        for (auto &column : _groups)
+        {
+            auto found = index(column);
+            if (found < 0) return unknown(column);
+            _grouped.push_back(found);
+        }
+
+        // find the aggregated columns
+        _aggregated.assign(_fields->size(), -1);
+        for (size_t i = 0; i < _aggregates.size(); ++i)
+        {
+            auto found = index(_aggregates[i].first);
+            if (found < 0) return unknown(_aggregates[i].first);
+            _aggregated[found] = i;
+        }
+
+        // the merged rows all go in a single result
+        _collected = std::make_shared<StreamedResultImpl>(_fields);
+        return true;
+    }
+
+    /**
+     *  We are done with a batch of a connection
+     *
+     *  @param  shard       index of the connection
+     */
+    void consumed(size_t shard)
+    {
+        _shards[shard].throttle->release();
+    }
+
+    /**
+     *  Stop the connections from reading rows
+     */
+    void halt()
+    {
+        for (auto &shard : _shards) shard.throttle->stop();
+    }
+
+    /**
+     *  Pass a merged row
+     *
+     *  @param  batch       the result holding the row
+     *  @param  index       index of the row
+     *  @return do we want more rows?
+     */
+    bool emit(const std::shared_ptr<StreamedResultImpl> &batch, size_t index)
+    {
+        // one more row
+        ++_emitted;
+
+        // add it to the result, if it is wanted
+        if (_successCallback) _collected->add(batch->row(index));
+
+        // pass the row on, the callback may cancel us
+        if (_rowCallback) _rowCallback(ResultRow(batch, batch->fetch(index)));
+
+        // do we want more?
+        return !_finished && _emitted < _limit;
+    }
+
+    /**
+     *  Merge the waiting rows
+     */
+    void merge()
+    {
+        // we can pass the lowest row while every running connection has a row waiting
+        while (!_finished && _waiting == 0 && !_heap.empty())
+        {
+            // the connection with the lowest row
+            auto shard = pop();
+            auto &waiting = _shards[shard];
+            auto batch = waiting.batches.front();
+            auto index = waiting.position;
+
+            // move to the next row
+            if (++waiting.position == batch->size())
+            {
+                waiting.batches.pop_front();
+                waiting.position = 0;
+                consumed(shard);
+            }
+
+            // wait for more rows of the connection, if it has them
+            if (!waiting.batches.empty()) push(shard);
+            else if (!waiting.done) ++_waiting;
+
+            // pass the row
+            if (!emit(batch, index)) return finish();
+        }
+    }
+
+    /**
+     *  Add a row to its group
+     *
+     *  @param  row         the row to add
+     */
+    void fold(const std::shared_ptr<StreamedRow> &row)
+    {
+        // the key of the group, with the length of every value so they cannot run into each other
+        std::string key;
+        for (auto column : _grouped)
+        {
+            if (!row->value(column)) { key.push_back('\0'); continue; }
+            key.append("\1").append(std::to_string(row->length(column))).append(":").append(row->value(column), row->length(column));
+        }
+
+        // find the group, or start a new one
+        auto iter = _groupIndex.find(key);
+        if (iter == _groupIndex.end())
+        {
+            iter = _groupIndex.emplace(std::move(key), _groupRows.size()).first;
+            _groupRows.push_back(Group{ row, std::vector<Accumulator>(_aggregates.size()) });
+        }
+        auto &group = _groupRows[iter->second];
+
+        // combine the aggregated columns
+        for (size_t column = 0; column < _aggregated.size(); ++column)
+        {
+            // skip columns that are not aggregated, and NULL values
+            if (_aggregated[column] < 0) continue;
+            auto *value = row->value(column);
+            auto length = row->length(column);
+            if (!value) continue;
+
+            // the combined value
+            auto &accumulator = group.values[_aggregated[column]];
+
+            // how should we combine it?
+            switch (_aggregates[_aggregated[column]].second)
+            {
+            case FanOut::sum:
+            case FanOut::count:
+                {
+                    // add integers as long as we can
+                    int64_t whole;
+                    if (accumulator.integral && integer(value, length, whole)) { accumulator.integer += whole; break; }
+
+                    // otherwise switch to floating point
+                    if (accumulator.integral) accumulator.real = accumulator.integer;
+                    accumulator.integral = false;
+
+                    // and add the value
+                    double fraction;
+                    if (number(value, length, fraction)) accumulator.real += fraction;
+                    break;
+                }
+            case FanOut::min:
+                if (accumulator.null || compare(value, length, accumulator.text.data(), accumulator.text.size(), numeric(column)) < 0) accumulator.text.assign(value, length);
+                break;
+            case FanOut::max:
+                if (accumulator.null || compare(value, length, accumulator.text.data(), accumulator.text.size(), numeric(column)) > 0) accumulator.text.assign(value, length);
+                break;
+            }
+
+            // we have a value now
+            accumulator.null = false;
+        }
+    }
+
+    /**
+     *  Pass the aggregated rows
+     */
+    void aggregate()
+    {
+        // nothing to do when no connection returned a result
+        if (!_fields) return;
+
+        // the combined rows
+        auto rows = std::make_shared<StreamedResultImpl>(_fields);
+
+        // the values of a row
+        std::vector<std::string> texts(_aggregated.size());
+        std::vector<const char*> values(_aggregated.size());
+        std::vector<unsigned long> lengths(_aggregated.size());
+
+        // create a row for every group
+        for (auto &group : _groupRows)
+        {
+            for (size_t column = 0; column < _aggregated.size(); ++column)
+            {
+                // columns that are not aggregated come from the first row
+                if (_aggregated[column] < 0)
+                {
+                    values[column] = group.first->value(column);
+                    lengths[column] = group.first->length(column);
+                    continue;
+                }
+
+                // the combined value
+                auto &accumulator = group.values[_aggregated[column]];
+                auto function = _aggregates[_aggregated[column]].second;
+
+                // format the sums
+                if (accumulator.null) texts[column].clear();
+                else if (function == FanOut::min || function == FanOut::max) texts[column] = accumulator.text;
+                else if (accumulator.integral) texts[column] = std::to_string(accumulator.integer);
+                else
+                {
+                    char buffer[32];
+                    texts[column].assign(buffer, snprintf(buffer, sizeof(buffer), "%.17g", accumulator.real));
+                }
+
+                // a missing count is zero, other aggregates are NULL
+                if (accumulator.null && function == FanOut::count) texts[column] = "0";
+                values[column] = accumulator.null && function != FanOut::count ? nullptr : texts[column].data();
+                lengths[column] = texts[column].size();
+            }
+
+            // add the row
+            rows->add(std::make_shared<StreamedRow>(values.data(), lengths.data(), values.size()));
+        }
+
+        // put the rows in order
+        std::vector<size_t> order(rows->size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this, &rows](size_t a, size_t b) { return less(*rows->row(a), *rows->row(b)); });
+
+        // the rows in order
+        auto ordered = std::make_shared<StreamedResultImpl>(_fields);
+        for (auto index : order) ordered->add(rows->row(index));
+
+        // pass them, until we have enough
+        for (size_t index = 0; index < ordered->size() && emit(ordered, index); ++index) {}
+    }
+
+    /**
+     *  Report success
+     */
+    void finish()
+    {
+        // did we already report?
+        if (_finished) return;
+
+        // the connections can stop
+        halt();
+
+        // pass the aggregated rows
+        if (aggregating()) aggregate();
+
+        // the rows may have cancelled us
+        if (_finished) return;
+        _finished = true;
+
+        // report the outcome
+        if (_successCallback) _successCallback(_collected ? Result(std::move(_collected)) : Result(nullptr));
+        if (_completeCallback) _completeCallback();
+    }
+
+    /**
+     *  Report failure
+     *
+     *  @param  error       the error
+     */
+    void fail(const char *error)
+    {
+        // did we already report?
+        if (_finished) return;
+        _finished = true;
+
+        // the other connections can stop
+        halt();
+
+        // report the outcome
+        if (_failureCallback) _failureCallback(error);
+        if (_completeCallback) _completeCallback();
+    }
+
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~FanOutMerge() {}
+
+    /**
+     *  Configure the merge
+     */
+    void order(const std::string &column, FanOut::Order order) { _order.emplace_back(column, order); }
+    void limit(size_t rows) { _limit = rows; }
+    void group(const std::string &column) { _groups.push_back(column); }
+    void aggregate(const std::string &column, FanOut::Aggregate function) { _aggregates.emplace_back(column, function); }
+
+    /**
+     *  Install the callbacks
+     */
+    void onRow(const std::function<void(ResultRow&& row)> &callback) { _rowCallback = callback; }
+    void onSuccess(const std::function<void(Result&& result)> &callback) { _successCallback = callback; }
+    void onFailure(const std::function<void(const char *error)> &callback) { _failureCallback = callback; }
+    void onComplete(const std::function<void()> &callback) { _completeCallback = callback; }
+
+    /**
+     *  Did the query start?
+     */
+    bool started() const
+    {
+        return _started;
+    }
+
+    /**
+     *  The limit on the batches of a connection that we are not done with
+     *
+     *  @param  shard       index of the connection
+     */
+    const std::shared_ptr<Throttle> &throttle(size_t shard) const
+    {
+        return _shards[shard].throttle;
+    }
+
+    /**
+     *  The query starts
+     *
+     *  @param  backlogs    the number of batches that can wait, for every connection
+     */
+    void start(const std::vector<size_t> &backlogs)
+    {
+        _started = true;
+        _shards.resize(backlogs.size());
+        _running = _waiting = backlogs.size();
+
+        // every connection gets its own limit
+        for (size_t shard = 0; shard < backlogs.size(); ++shard) _shards[shard].throttle = std::make_shared<Throttle>(backlogs[shard]);
+
+        // without a limit there is nothing to do
+        if (_limit == 0) finish();
+    }
+
+    /**
+     *  Stop the query, a running query reports that it was cancelled
+     */
+    void cancel()
+    {
+        // a query that runs fails, the callbacks are not called afterwards
+        if (_started) return fail("Fan-out query cancelled");
+
+        // the query will not start
+        _finished = true;
+    }
+
+    /**
+     *  Rows arrived from a connection
+     *
+     *  @param  shard       index of the connection
+     *  @param  batch       the rows
+     */
+    void rows(size_t shard, const std::shared_ptr<StreamedResultImpl> &batch)
+    {
+        // are we still interested, and do we know the columns?
+        if (_finished || !resolve(batch->shared(), batch->numeric())) return consumed(shard);
+
+        // aggregated rows are combined first
+        if (aggregating())
+        {
+            for (size_t index = 0; index < batch->size(); ++index) fold(batch->row(index));
+            return consumed(shard);
+        }
+
+        // rows that are not ordered are passed right away
+        if (_keys.empty())
+        {
+            // we are done with the batch after passing it, also when we have enough rows
+            consumed(shard);
+            for (size_t index = 0; index < batch->size(); ++index) if (!emit(batch, index)) return finish();
+            return;
+        }
+
+        // wait for the rows of the other connections
+        auto &waiting = _shards[shard];
+        waiting.batches.push_back(batch);
+
+        // the connection now has a row waiting
+        if (waiting.batches.size() == 1)
+        {
+            push(shard);
+            --_waiting;
+        }
+
+        // pass the rows we can
+        merge();
+    }
+
+    /**
+     *  A connection is done
+     *
+     *  @param  shard       index of the connection
+     *  @param  fields      the fields of the result, if there was one
+     *  @param  numeric     which fields hold numbers
+     *  @param  error       the error, if the query failed
+     */
+    void done(size_t shard, const std::shared_ptr<const std::map<std::string, size_t>> &fields, const std::shared_ptr<const std::vector<bool>> &numeric, const char *error)
+    {
+        // are we still interested?
+        if (_finished) return;
+
+        // did the query fail?
+        if (error) return fail(error);
+
+        // we may not have seen the columns yet
+        if (!resolve(fields, numeric)) return;
+
+        // the connection no longer runs
+        auto &waiting = _shards[shard];
+        waiting.done = true;
+        --_running;
+
+        // we no longer wait for its rows
+        if (waiting.batches.empty()) --_waiting;
+
+        // this may allow us to pass more rows
+        if (!aggregating() && !_keys.empty()) merge();
+
+        // are all connections done?
+        if (_running == 0) finish();
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,105 @@
+/**
+ *  GroupCommit.h
+ *
+ *  Transactions that are waiting to be committed together. Small write
+ *  transactions that are committed within a short window are merged
+ *  into a single server transaction, so they share the cost of flushing
+ *  the log to disk. Each of them is protected by a savepoint, so a
+ *  failing statement only rolls back its own transaction. This object
+ *  is only used from the master thread.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Group commit class
+ */
+class GroupCommit
+{
+private:
+    /**
+     *  How long transactions wait for others, in seconds
+     */
+    double _window;
+
+    /**
+     *  The maximum number of transactions in a group
+     */
+    size_t _limit;
+
+    /**
+     *  The transactions waiting to be committed
+     */
+    std::vector<TransactionWork> _pending;
+
+    /**
+     *  The timer for committing the waiting transactions
+     */
+    std::shared_ptr<TimeoutWatcher> _timer;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  window      how long transactions wait for others, in seconds
+     *  @param  limit       the maximum number of transactions in a group
+     */
+    GroupCommit(double window, size_t limit) : _window(window), _limit(limit) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~GroupCommit()
+    {
+        // the timer should no longer fire
+        if (_timer) _timer->cancel();
+    }
+
+    /**
+     *  Add a transaction to the group
+     *
+     *  @param  work        the transaction
+     *  @param  loop        the loop to start the timer in
+     *  @param  flush       the function to call when the window ends
+     *  @return is the group full, so it should be committed right away?
+     */
+    bool add(TransactionWork&& work, Loop *loop, const std::function<void()>& flush)
+    {
+        // add the transaction
+        _pending.push_back(std::move(work));
+
+        // is the group full?
+        if (_pending.size() >= _limit) return true;
+
+        // the first transaction in the group starts the window
+        if (_pending.size() == 1) _timer = loop->onTimeout(_window, flush);
+
+        // wait for more
+        return false;
+    }
+
+    /**
+     *  Take the waiting transactions out of the group
+     */
+    std::vector<TransactionWork> take()
+    {
+        // the window has ended
+        if (_timer) _timer->cancel();
+        _timer = nullptr;
+
+        // hand out the transactions
+        std::vector<TransactionWork> result;
+        result.swap(_pending);
+        return result;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
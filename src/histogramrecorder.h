@@ -0,0 +1,101 @@
+/**
+ *  HistogramRecorder.h
+ *
+ *  Records values into histogram buckets. Every recorder has a
+ *  single thread writing to it, so no atomic read-modify-write
+ *  operations are needed: the counters are atomics only to allow
+ *  other threads to take a consistent-enough snapshot.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Histogram recorder class
+ */
+class HistogramRecorder
+{
+private:
+    /**
+     *  The number of values in each bucket
+     */
+    std::atomic<uint64_t> _buckets[Histogram::buckets];
+
+    /**
+     *  The number of recorded values
+     */
+    std::atomic<uint64_t> _count;
+
+    /**
+     *  The sum of all recorded values
+     */
+    std::atomic<uint64_t> _sum;
+
+    /**
+     *  The highest recorded value
+     */
+    std::atomic<uint64_t> _max;
+
+    /**
+     *  Increment a counter that is only written by the current thread
+     *
+     *  @param  counter     the counter to increment
+     *  @param  value       the value to add
+     */
+    static void increment(std::atomic<uint64_t> &counter, uint64_t value)
+    {
+        // we are the only writer, so a plain load and store suffices
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+public:
+    /**
+     *  Constructor
+     */
+    HistogramRecorder() : _count(0), _sum(0), _max(0)
+    {
+        // all buckets start empty
+        for (auto &bucket : _buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     *  Record a value
+     *
+     *  @param  value   the value to record
+     */
+    void record(uint64_t value)
+    {
+        // update the bucket and the totals
+        increment(_buckets[Histogram::bucket(value)], 1);
+        increment(_count, 1);
+        increment(_sum, value);
+
+        // update the highest value
+        if (value > _max.load(std::memory_order_relaxed)) _max.store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     *  Take a snapshot of the recorded values
+     *
+     *  @param  histogram   the histogram to add the values to
+     */
+    void snapshot(Histogram &histogram) const
+    {
+        // copy the buckets
+        for (size_t i = 0; i < Histogram::buckets; ++i) histogram._buckets[i] += _buckets[i].load(std::memory_order_relaxed);
+
+        // and the totals
+        histogram._count += _count.load(std::memory_order_relaxed);
+        histogram._sum += _sum.load(std::memory_order_relaxed);
+        histogram._max = std::max(histogram._max, _max.load(std::memory_order_relaxed));
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -15,29 +15,100 @@
 #include <cstdlib>
 #include <cstring>
 #include <vector>
+#include <set>
 #include <ctime>
 #include <numeric>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <cctype>
+#include <random>
+#include <map>
+#include <thread>
+#include <cstdio>
+#include <cinttypes>
+#include <deque>
+#include <condition_variable>
+#include <type_traits>
+#include <cstddef>
+#include <cerrno>
+#include <sys/socket.h>
 
 /**
  *  Include other files from this library
  */
+#include "probes.h"
+#include "address.h"
+#include "../include/projection.h"
+#include "../include/columnsink.h"
+#include "../include/histogram.h"
+#include "../include/statistics.h"
+#include "histogramrecorder.h"
+#include "statisticsrecorder.h"
+#include "../include/digest.h"
+#include "digesttable.h"
+#include "../include/slowquery.h"
+#include "slowquerylog.h"
+#include "lagmonitor.h"
+#include "../include/traceformat.h"
+#include "ringbuffer.h"
+#include "tracer.h"
+#include "lockfreequeue.h"
+#include "task.h"
+#include "completionqueue.h"
+#include "submissionqueue.h"
+#include "inflight.h"
+#include "deferredpool.h"
 #include "resultfieldimpl.h"
 #include "queryresultfield.h"
 #include "resultimpl.h"
 #include "queryresultimpl.h"
+#include "streamedresultimpl.h"
+#include "throttle.h"
 #include "statementresultfield.h"
 #include "../include/deferred.h"
 #include "../include/exception.h"
 #include "../include/resultfield.h"
 #include "../include/resultrow.h"
 #include "../include/result.h"
+#include "../include/combinator.h"
+#include "../include/results.h"
+#include "../include/whenall.h"
+#include "../include/whenany.h"
 #include "../include/localparameter.h"
+#include "../include/resultcache.h"
 #include "../include/connection.h"
+#include "../include/longdata.h"
 #include "../include/parameter.h"
 #include "../include/statement.h"
 #include "../include/cachedstatement.h"
+#include "../include/retrypolicy.h"
+#include "../include/transaction.h"
+#include "../include/pool.h"
+#include "../include/session.h"
+#include "../include/router.h"
+#include "../include/shardmap.h"
+#include "../include/rangeshardmap.h"
+#include "../include/ringshardmap.h"
+#include "../include/shardedconnection.h"
+#include "../include/fanout.h"
+#include "../include/binlogchange.h"
+#include "../include/binlogreader.h"
+#include "../include/loader.h"
 #include "statementintegralresultfield.h"
 #include "statementdynamicresultfield.h"
 #include "statementdatetimeresultfield.h"
 #include "statementresultimpl.h"
 #include "statementresultinfo.h"
+#include "transactionwork.h"
+#include "transactionsession.h"
+#include "groupcommit.h"
+#include "singleflight.h"
+#include "subsetresultimpl.h"
+#include "loaderbatch.h"
+#include "replica.h"
+#include "fanoutmerge.h"
+#include "binlogdecoder.h"
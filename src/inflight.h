@@ -0,0 +1,151 @@
+/**
+ *  InFlight.h
+ *
+ *  Keeps the event loop alive while operations are in flight. Instead
+ *  of a loop reference per operation, every operation holds a token
+ *  that increments a single counter. Only when the connection becomes
+ *  busy, a loop reference is created, and when the last token is gone,
+ *  it is released again from the master thread.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  In-flight counter class
+ */
+class InFlightCounter
+{
+private:
+    /**
+     *  The loop to keep alive
+     */
+    Loop *_loop;
+
+    /**
+     *  The queue to release the reference from
+     */
+    CompletionQueue *_completions;
+
+    /**
+     *  The number of tokens
+     */
+    std::atomic<size_t> _count;
+
+    /**
+     *  The loop reference, only used by the master thread
+     */
+    std::unique_ptr<React::LoopReference> _reference;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  loop        the loop to keep alive
+     *  @param  completions the queue to release the reference from
+     */
+    InFlightCounter(Loop *loop, CompletionQueue *completions) : _loop(loop), _completions(completions), _count(0) {}
+
+    /**
+     *  A new operation starts
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     */
+    void acquire()
+    {
+        // count the operation
+        _count.fetch_add(1, std::memory_order_relaxed);
+
+        // keep the loop alive, if we did not already do so
+        if (!_reference) _reference.reset(new React::LoopReference(_loop));
+    }
+
+    /**
+     *  A token for an operation is copied
+     */
+    void retain()
+    {
+        _count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     *  A token is destroyed
+     */
+    void release()
+    {
+        // are there tokens left?
+        if (_count.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+        // release the reference from the master, unless new operations started in the meantime
+        _completions->push([this]() { if (_count.load(std::memory_order_acquire) == 0) _reference.reset(); });
+    }
+};
+
+/**
+ *  Token for an operation in flight
+ */
+class InFlight
+{
+private:
+    /**
+     *  The counter
+     */
+    InFlightCounter *_counter;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     *
+     *  @param  counter     the counter
+     */
+    explicit InFlight(InFlightCounter *counter) : _counter(counter)
+    {
+        _counter->acquire();
+    }
+
+    /**
+     *  Copy constructor
+     *
+     *  @param  that        the token to copy
+     */
+    InFlight(const InFlight &that) : _counter(that._counter)
+    {
+        if (_counter) _counter->retain();
+    }
+
+    /**
+     *  Move constructor
+     *
+     *  @param  that        the token to move
+     */
+    InFlight(InFlight &&that) : _counter(that._counter)
+    {
+        that._counter = nullptr;
+    }
+
+    /**
+     *  Tokens are not assigned
+     */
+    InFlight &operator=(const InFlight &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    ~InFlight()
+    {
+        if (_counter) _counter->release();
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,119 @@
+/**
+ *  LagMonitor.h
+ *
+ *  Keeps track of the callbacks that the worker handed over to the
+ *  master thread, but that did not run yet. When the event loop is
+ *  saturated these pile up, and the delay before they run grows.
+ *  The backlog is changed by both threads, everything else is only
+ *  used by the master thread.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Lag monitor class
+ */
+class LagMonitor
+{
+private:
+    /**
+     *  The number of callbacks waiting for the master
+     */
+    std::atomic<size_t> _backlog;
+
+    /**
+     *  The delay at which the loop is lagging, in nanoseconds
+     */
+    uint64_t _threshold = 0;
+
+    /**
+     *  The callback to inform when the loop starts lagging
+     */
+    std::function<void(uint64_t delay, size_t backlog)> _callback;
+
+    /**
+     *  Is the loop currently lagging?
+     */
+    bool _lagging = false;
+
+public:
+    /**
+     *  Constructor
+     */
+    LagMonitor() : _backlog(0) {}
+
+    /**
+     *  Set the threshold and the callback
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     *
+     *  @param  threshold   the threshold in seconds
+     *  @param  callback    the callback to inform
+     */
+    void install(double threshold, const std::function<void(uint64_t delay, size_t backlog)>& callback)
+    {
+        _threshold = static_cast<uint64_t>(threshold * 1000000000.0);
+        _callback = callback;
+        _lagging = false;
+    }
+
+    /**
+     *  A callback was handed over to the master
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     */
+    void posted()
+    {
+        _backlog.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     *  A callback is about to run in the master
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     *
+     *  @param  delay       the time the callback was waiting
+     */
+    void running(uint64_t delay)
+    {
+        // the callback is no longer waiting
+        auto backlog = _backlog.fetch_sub(1, std::memory_order_relaxed) - 1;
+
+        // nothing to do without a callback
+        if (!_callback) return;
+
+        // is the loop lagging, and was it already lagging before?
+        bool lagging = delay >= _threshold;
+        bool reported = _lagging;
+
+        // remember the state
+        _lagging = lagging;
+
+        // only report the moment the loop starts lagging, on a copy
+        // of the callback, since it may install a new one
+        if (!lagging || reported) return;
+        auto callback = _callback;
+        callback(delay, backlog);
+    }
+
+    /**
+     *  The number of callbacks waiting for the master
+     */
+    size_t backlog() const
+    {
+        return _backlog.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
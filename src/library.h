@@ -38,6 +38,18 @@ public:
     }
 };
 
+/**
+ *  Initializes the MySQL library
+ *
+ *  The library will be automatically de-initialized
+ *  on program termination.
+ */
+inline void init()
+{
+    // keep a single static library instance available
+    static Library library;
+}
+
 /**
  *  End namespace
  */
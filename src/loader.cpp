@@ -0,0 +1,159 @@
+/**
+ *  Loader.cpp
+ *
+ *  Class for looking up rows by their key, in batches.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Constructor
+ *
+ *  @param  connection  the connection to run the queries on
+ *  @param  query       the query with the placeholder for the keys
+ *  @param  column      the column that holds the key of every row
+ *  @param  window      how long keys wait for others, in seconds
+ *  @param  limit       the maximum number of keys in a query
+ *  @param  bytes       the maximum number of bytes in a query
+ *  @throws Exception   when the query does not have a single placeholder
+ */
+Loader::Loader(Connection *connection, const std::string& query, const std::string& column, double window, size_t limit, size_t bytes) :
+    _connection(connection),
+    _digest(Digest::normalize(query)),
+    _column(column),
+    _window(window),
+    _limit(std::max(limit, (size_t)1)),
+    _bytes(bytes)
+{
+    // find the placeholder
+    auto position = query.find('?');
+    if (position == std::string::npos || query.find('?', position + 1) != std::string::npos) throw Exception("Query should have a single placeholder for the keys");
+
+    // the keys go in between
+    _head = query.substr(0, position);
+    _tail = query.substr(position + 1);
+}
+
+/**
+ *  Destructor
+ */
+Loader::~Loader()
+{
+    // send the waiting keys, their callers still get the rows
+    flush();
+}
+
+/**
+ *  Add a caller for a key
+ *
+ *  @param  key         the key
+ *  @param  integral    is the key a number?
+ */
+Deferred& Loader::add(const std::string& key, bool integral)
+{
+    // create the deferred handler
+    auto deferred = _connection->allocate();
+
+    // send the waiting keys first when the query would become too big
+    if (_batch && !_batch->keys().count(key) && _head.size() + _tail.size() + _batch->bytes() + LoaderBatch::bytes(key, integral) > _bytes) flush();
+
+    // the first key starts the window
+    if (!_batch)
+    {
+        _batch = std::make_shared<LoaderBatch>(_column);
+        _timer = _connection->_loop->onTimeout(_window, [this]() { flush(); });
+    }
+
+    // add the caller
+    _batch->add(key, integral, deferred);
+
+    // send the keys right away when there are enough
+    if (_batch->size() >= _limit) flush();
+
+    // return the deferred handler
+    return *deferred;
+}
+
+/**
+ *  Send the waiting keys right away
+ */
+void Loader::flush()
+{
+    // the window has ended
+    if (_timer) _timer->cancel();
+    _timer = nullptr;
+
+    // are there keys waiting at all?
+    if (!_batch) return;
+
+    // take the waiting keys
+    auto batch = std::move(_batch);
+
+    // and send them
+    send(batch);
+}
+
+/**
+ *  Send a batch of keys
+ *
+ *  @param  batch       the keys
+ */
+void Loader::send(const std::shared_ptr<LoaderBatch>& batch)
+{
+    // the query is sent with a handler of its own, that passes the rows to the callers
+    auto deferred = _connection->allocate();
+    deferred->onSuccess([batch](Result&& result) {
+        batch->success(std::move(result));
+    }).onFailure([batch](const char *error) {
+        batch->failure(error);
+    });
+
+    // keep the loop alive while the keys are escaped
+    auto *connection = _connection;
+    InFlight reference(connection->_inflight.get());
+
+    // the strings are escaped in the worker thread, which owns the connection
+    connection->_worker->execute(std::bind([connection, reference, batch, deferred](const std::string &head, const std::string &tail, const std::string &digest) {
+        // the query, with room for the keys
+        std::string query;
+        query.reserve(head.size() + batch->bytes() + tail.size());
+        query.append(head);
+
+        // add the keys
+        bool first = true;
+        for (auto &key : batch->keys())
+        {
+            // separate the keys
+            if (!first) query.append(", ");
+            first = false;
+
+            // numbers are added as they are
+            if (key.second.integral) { query.append(key.first); continue; }
+
+            // strings are escaped and quoted
+            std::string escaped(key.first.size() * 2 + 1, '\0');
+            escaped.resize(mysql_real_escape_string(connection->_connection, &escaped[0], key.first.c_str(), key.first.size()));
+            query.append(1, '\'').append(escaped).append(1, '\'');
+        }
+
+        // and the rest of the query
+        query.append(tail);
+
+        // send the query from the master thread, grouped under the digest of the template
+        connection->deliver([connection, reference, query, digest, deferred]() {
+            connection->submit(query, Projection(), digest, deferred);
+        });
+    }, _head, _tail, _digest));
+}
+
+/**
+ *  End namespace
+ */
+}}
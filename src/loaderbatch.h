@@ -0,0 +1,177 @@
+/**
+ *  LoaderBatch.h
+ *
+ *  The keys that a loader sends in a single query, with the handlers of
+ *  the callers that wait for them. When the result arrives, every caller
+ *  gets the rows that belong to its key. This object is only used from
+ *  the master thread.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Loader batch class
+ */
+class LoaderBatch
+{
+public:
+    /**
+     *  A key and the callers waiting for it
+     */
+    struct Key
+    {
+        /**
+         *  Is the key a number, that is sent without quotes?
+         */
+        bool integral;
+
+        /**
+         *  The handlers of the callers
+         */
+        std::vector<std::shared_ptr<Deferred>> callers;
+    };
+
+private:
+    /**
+     *  The column the keys are read from
+     */
+    std::string _column;
+
+    /**
+     *  The keys, by their value
+     */
+    std::unordered_map<std::string, Key> _keys;
+
+    /**
+     *  The number of bytes the keys take in the query
+     */
+    size_t _bytes = 0;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  column      the column the keys are read from
+     */
+    LoaderBatch(std::string column) : _column(std::move(column)) {}
+
+    /**
+     *  The number of bytes a key takes in the query, at most
+     *
+     *  @param  value       the key
+     *  @param  integral    is the key a number?
+     */
+    static size_t bytes(const std::string& value, bool integral)
+    {
+        // strings are escaped and quoted, and keys are separated by a comma and a space
+        return (integral ? value.size() : value.size() * 2 + 2) + 2;
+    }
+
+    /**
+     *  Add a caller
+     *
+     *  @param  value       the key
+     *  @param  integral    is the key a number?
+     *  @param  deferred    the handler of the caller
+     */
+    void add(const std::string& value, bool integral, const std::shared_ptr<Deferred>& deferred)
+    {
+        // find the key, or add it
+        auto iter = _keys.find(value);
+        if (iter == _keys.end())
+        {
+            // the key is sent once, for all its callers
+            iter = _keys.emplace(value, Key{ integral, {} }).first;
+            _bytes += bytes(value, integral);
+        }
+
+        // one more caller for the key
+        iter->second.callers.push_back(deferred);
+    }
+
+    /**
+     *  The keys
+     */
+    const std::unordered_map<std::string, Key>& keys() const { return _keys; }
+
+    /**
+     *  The number of different keys
+     */
+    size_t size() const { return _keys.size(); }
+
+    /**
+     *  The number of bytes the keys take in the query
+     */
+    size_t bytes() const { return _bytes; }
+
+    /**
+     *  The result arrived
+     *
+     *  @param  result      the result of the query
+     */
+    void success(Result&& result)
+    {
+        // the query should have returned rows
+        auto implementation = result._result;
+        if (!implementation)
+        {
+            // we cannot find the rows of the callers
+            failure("Query did not return a result set");
+            return;
+        }
+
+        // and the column with the keys
+        auto field = implementation->fields().find(_column);
+        if (field == implementation->fields().end())
+        {
+            // we cannot find the rows of the callers
+            failure(("Unknown column " + _column).c_str());
+            return;
+        }
+
+        // the rows for every key
+        std::unordered_map<std::string, std::vector<size_t>> rows;
+        for (size_t i = 0; i < implementation->size(); ++i)
+        {
+            // the key of the row, rows without a key belong to nobody
+            auto &value = *implementation->fetch(i)[field->second];
+            if (value.isNULL()) continue;
+
+            // add the row to the key, if it was asked for
+            auto key = static_cast<std::string>(value);
+            if (_keys.count(key)) rows[key].push_back(i);
+        }
+
+        // pass the rows to the callers
+        for (auto &key : _keys)
+        {
+            // the rows of the key, shared by all its callers, no rows means it was not found
+            auto iter = rows.find(key.first);
+            auto subset = std::make_shared<SubsetResultImpl>(implementation, iter == rows.end() ? std::vector<size_t>() : std::move(iter->second));
+
+            // every caller gets its own result
+            for (auto &caller : key.second.callers) caller->success(Result(std::shared_ptr<ResultImpl>(subset)));
+        }
+    }
+
+    /**
+     *  The query failed
+     *
+     *  @param  error       the error
+     */
+    void failure(const char *error)
+    {
+        // every caller gets the error
+        for (auto &key : _keys) for (auto &caller : key.second.callers) caller->failure(error);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
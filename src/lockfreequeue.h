@@ -0,0 +1,169 @@
+/**
+ *  LockFreeQueue.h
+ *
+ *  Bounded lock-free queue that can be filled by multiple producer
+ *  threads and is drained by a single consumer thread. Every slot
+ *  has a sequence number that tells whether it is free to write or
+ *  ready to read, so producers only contend on the tail index, and
+ *  the consumer never has to wait for them. When the queue is full,
+ *  push() fails instead of blocking.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Lock-free queue class
+ */
+template <typename T>
+class LockFreeQueue
+{
+private:
+    /**
+     *  A single slot in the queue
+     */
+    struct Slot
+    {
+        /**
+         *  The sequence number, equal to the position when the slot
+         *  is free, and one higher when it holds a value
+         */
+        std::atomic<size_t> sequence;
+
+        /**
+         *  The value in the slot
+         */
+        T value;
+    };
+
+    /**
+     *  The slots, the number of slots is a power of two
+     */
+    std::unique_ptr<Slot[]> _slots;
+
+    /**
+     *  Mask to turn a position into a slot
+     */
+    size_t _mask;
+
+    /**
+     *  The next position to write, shared by the producers
+     */
+    std::atomic<size_t> _tail;
+
+    /**
+     *  Keep the positions on separate cache lines
+     */
+    char _padding[64];
+
+    /**
+     *  The next position to read, only used by the consumer
+     */
+    size_t _head;
+
+    /**
+     *  Round up to the next power of two
+     *
+     *  @param  value       the value to round up
+     */
+    static size_t round(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  capacity    the minimum number of slots
+     */
+    LockFreeQueue(size_t capacity) : _slots(new Slot[round(capacity)]), _mask(round(capacity) - 1), _tail(0), _head(0)
+    {
+        // all slots are free for the first round
+        for (size_t i = 0; i <= _mask; ++i) _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     *  Add a value to the queue
+     *
+     *  @param  value       the value to add
+     *  @return false if the queue was full
+     */
+    bool push(T&& value)
+    {
+        // the position we are going to try
+        auto position = _tail.load(std::memory_order_relaxed);
+
+        // keep trying until we claimed a slot
+        while (true)
+        {
+            // the slot at this position, and whether it is free
+            auto &slot = _slots[position & _mask];
+            auto difference = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(position);
+
+            // is the slot free? then try to claim it
+            if (difference == 0)
+            {
+                // another producer may beat us to it, in which case we get the new position
+                if (!_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) continue;
+
+                // store the value and publish it to the consumer
+                slot.value = std::move(value);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+
+            // the slot is still in use from the previous round, the queue is full
+            if (difference < 0) return false;
+
+            // another producer claimed the slot, try the next position
+            position = _tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     *  Take a value from the queue
+     *
+     *  @note:  This function is to be executed from
+     *          the consumer thread only
+     *
+     *  @param  value       the value to fill
+     *  @return false if the queue was empty
+     */
+    bool pop(T& value)
+    {
+        // the slot to read, is it filled?
+        auto &slot = _slots[_head & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != _head + 1) return false;
+
+        // take the value, and free the slot for the next round
+        value = std::move(slot.value);
+        slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+
+        // move on to the next slot
+        ++_head;
+        return true;
+    }
+
+    /**
+     *  Is the queue empty?
+     *
+     *  @note:  This function is to be executed from
+     *          the consumer thread only
+     */
+    bool empty() const
+    {
+        return _slots[_head & _mask].sequence.load(std::memory_order_acquire) != _head + 1;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,125 @@
+/**
+ *  Pool.cpp
+ *
+ *  Class representing a number of connections to the same MySQL or
+ *  MariaDB daemon.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Establish the connections
+ *
+ *  @param  loop        the loop to bind to
+ *  @param  hostname    the hostname to connect to
+ *  @param  username    the username to login with
+ *  @param  password    the password to authenticate with
+ *  @param  database    the database to use
+ *  @param  size        the number of connections
+ *  @param  flags       connection flags
+ *  @param  initialize  do we need to initialize (and cleanup) the mysql library
+ */
+Pool::Pool(Loop *loop, const std::string& hostname, const std::string &username, const std::string& password, const std::string& database, size_t size, uint64_t flags, bool initialize)
+{
+    // a pool holds at least one connection
+    _connections.reserve(std::max(size, (size_t)1));
+
+    // create the connections
+    do _connections.emplace_back(new Connection(loop, hostname, username, password, database, flags, initialize));
+    while (_connections.size() < size);
+}
+
+/**
+ *  Destructor
+ */
+Pool::~Pool() {}
+
+/**
+ *  Get a call when a connection succeeds or fails
+ *
+ *  @param  callback    the callback that will be informed of the connection status
+ */
+void Pool::onConnected(const std::function<void(const char *error)>& callback)
+{
+    // install the callback on all connections
+    for (auto &connection : _connections) connection->onConnected(callback);
+}
+
+/**
+ *  Track the GTIDs of the transactions committed on all connections
+ */
+void Pool::trackGtids()
+{
+    for (auto &connection : _connections) connection->trackGtids();
+}
+
+/**
+ *  The number of connections in the pool
+ */
+size_t Pool::size() const
+{
+    return _connections.size();
+}
+
+/**
+ *  The number of operations waiting or running on all connections
+ */
+size_t Pool::pending() const
+{
+    // add up the connections
+    size_t result = 0;
+    for (auto &connection : _connections) result += connection->pending();
+    return result;
+}
+
+/**
+ *  Retrieve the connection with the fewest operations in flight
+ */
+Connection& Pool::connection()
+{
+    // the best connection so far
+    size_t best = _next, count = _connections.size();
+    size_t load = _connections[best]->pending();
+
+    // check the others, starting where we left off, so idle connections take turns
+    for (size_t i = 1; i < count && load > 0; ++i)
+    {
+        // the next connection to check
+        size_t index = (_next + i) % count;
+        size_t pending = _connections[index]->pending();
+
+        // is it less busy?
+        if (pending >= load) continue;
+        best = index;
+        load = pending;
+    }
+
+    // next time we start after this connection
+    _next = (best + 1) % count;
+
+    // return the least busy connection
+    return *_connections[best];
+}
+
+/**
+ *  Retrieve the statistics of all connections together
+ */
+Statistics Pool::statistics() const
+{
+    // add up the snapshots of all connections
+    Statistics result;
+    for (auto &connection : _connections) result += connection->statistics();
+    return result;
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,39 @@
+/**
+ *  Probes.h
+ *
+ *  Static tracepoints on the query lifecycle, for attaching tools
+ *  like bpftrace or perf to a running process. The probes are only
+ *  compiled in when <sys/sdt.h> is available, and can be disabled
+ *  by defining REACT_MYSQL_NO_PROBES. When no tracer is attached, a
+ *  probe costs a single nop instruction.
+ *
+ *  All probes have the same arguments: the connection id, the query
+ *  id, and the number of bytes and rows involved (or zero).
+ *
+ *  reactcpp_mysql:query_submit         a query was submitted to the worker
+ *  reactcpp_mysql:worker_start         the worker started on the query
+ *  reactcpp_mysql:execute_done         the server finished executing the query
+ *  reactcpp_mysql:result_materialized  the result was fetched from the server
+ *  reactcpp_mysql:callback_delivered   the event loop runs the callback
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Find out whether the probes are available
+ */
+#if !defined(REACT_MYSQL_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define REACT_MYSQL_PROBES
+#endif
+#endif
+
+/**
+ *  Macro to fire a probe
+ */
+#ifdef REACT_MYSQL_PROBES
+#define REACT_MYSQL_PROBE(name, connection, query, bytes, rows) DTRACE_PROBE4(reactcpp_mysql, name, connection, query, bytes, rows)
+#else
+#define REACT_MYSQL_PROBE(name, connection, query, bytes, rows) do {} while (false)
+#endif
@@ -34,21 +34,33 @@ private:
     std::map<std::string, size_t> _fields;
 
     /**
-     *  The current position in the result set
+     *  The indices of the materialized columns
+     *  in the underlying mysql result
      */
-    size_t _position;
+    std::vector<size_t> _columns;
+
+    /**
+     *  Where to find every row in the mysql result
+     */
+    std::vector<MYSQL_ROW_OFFSET> _offsets;
+
+    /**
+     *  The number of bytes of field data in all rows
+     */
+    size_t _bytes;
 
 public:
     /**
      *  Construct result implementation
      *
-     *  @param  result  mysql result
+     *  @param  result      mysql result
+     *  @param  projection  the columns to materialize
      */
-    QueryResultImpl(MYSQL_RES *result) :
+    QueryResultImpl(MYSQL_RES *result, const Projection& projection = Projection()) :
         ResultImpl(),
         _result(result),
         _rows(mysql_num_rows(_result)),
-        _position(0)
+        _bytes(0)
     {
         // retrieve number of fields
         auto size = mysql_num_fields(_result);
@@ -59,8 +71,26 @@ public:
             // retrieve field info
             auto field = mysql_fetch_field_direct(_result, i);
 
-            // store field in map
-            _fields[std::string(field->name, field->name_length)] = i;
+            // the name of the field
+            std::string name(field->name, field->name_length);
+
+            // skip fields the caller is not interested in
+            if (!projection.contains(name)) continue;
+
+            // store field in map and remember where to find it
+            _fields[name] = _columns.size();
+            _columns.push_back(i);
+        }
+
+        // remember where every row is, so it can be found without walking the result again, and add
+        // up the lengths of its fields, which for a stored result are calculated from the row pointers
+        _offsets.reserve(_rows.size());
+        for (size_t i = 0; i < _rows.size(); ++i)
+        {
+            _offsets.push_back(mysql_row_tell(_result));
+            mysql_fetch_row(_result);
+            auto lengths = mysql_fetch_lengths(_result);
+            _bytes = std::accumulate(lengths, lengths + size, _bytes);
         }
     }
 
@@ -81,6 +111,14 @@ public:
         return _fields;
     }
 
+    /**
+     *  The number of bytes of field data in all rows
+     */
+    size_t bytes() const
+    {
+        return _bytes;
+    }
+
     /**
      *  Get the number of rows in this result set
      */
@@ -100,31 +138,19 @@ public:
         // did we already prepare this row?
         if (_rows[index].size() == 0)
         {
-            // are we already at the required offset?
-            if (_position != index)
-            {
-                // seek to the desired offset
-                mysql_data_seek(_result, index);
-            }
-
-            // store current position
-            // we add one to the position since
-            // the fetch operation advances to
-            // the next row (which happens below)
-            _position = index + 1;
-
-            // retrieve the row
+            // go to the row, and retrieve it
+            mysql_row_seek(_result, _offsets[index]);
             auto row = mysql_fetch_row(_result);
             auto lengths = mysql_fetch_lengths(_result);
 
             // reserve space for the rows
-            _rows[index].reserve(_fields.size());
+            _rows[index].reserve(_columns.size());
 
-            // and parse them
-            for (size_t i = 0; i < _fields.size(); ++i)
+            // and parse the projected columns
+            for (auto column : _columns)
             {
                 // create field implementation
-                _rows[index].emplace_back(new QueryResultField(row[i], lengths[i]));
+                _rows[index].emplace_back(new QueryResultField(row[column], lengths[column]));
             }
         }
 
@@ -0,0 +1,63 @@
+/**
+ *  Replica.h
+ *
+ *  What a router knows about one of its replicas: the pool to send
+ *  queries to, and the latency and replication lag that were last
+ *  measured. This object is only used from the master thread.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Replica class
+ */
+class Replica
+{
+public:
+    /**
+     *  The pool of connections to the replica
+     */
+    Pool *pool;
+
+    /**
+     *  The average round trip of the probes, in seconds, zero if unknown
+     */
+    double latency = 0.0;
+
+    /**
+     *  The replication lag, in seconds
+     */
+    double lag = 0.0;
+
+    /**
+     *  Is replication running?
+     */
+    bool healthy = true;
+
+    /**
+     *  Is a probe on its way?
+     */
+    bool probing = false;
+
+    /**
+     *  Does the server only understand SHOW SLAVE STATUS?
+     */
+    bool legacy = false;
+
+    /**
+     *  Constructor
+     *
+     *  @param  pool        the pool of connections to the replica
+     */
+    Replica(Pool *pool) : pool(pool) {}
+};
+
+/**
+ *  End namespace
+ */
+}}
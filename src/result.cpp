@@ -20,6 +20,16 @@ Result::Result(MYSQL_RES *result) :
     _result(std::make_shared<QueryResultImpl>(result))
 {}
 
+/**
+ *  Constructor materializing only some columns
+ *
+ *  @param  result      mysql result
+ *  @param  projection  the columns to materialize
+ */
+Result::Result(MYSQL_RES *result, const Projection& projection) :
+    _result(std::make_shared<QueryResultImpl>(result, projection))
+{}
+
 /**
  *  Constructor
  */
@@ -49,7 +59,9 @@ Result::Result(std::nullptr_t result)
  */
 Result::Result(Result&& that) :
     _result(std::move(that._result)),
-    _affectedRows(that._affectedRows)
+    _affectedRows(that._affectedRows),
+    _insertID(that._insertID),
+    _gtids(std::move(that._gtids))
 {}
 
 /**
@@ -203,6 +215,14 @@ uint64_t Result::insertID() const
     return _insertID;
 }
 
+/**
+ *  The GTIDs of the transaction that was committed by the query
+ */
+const std::string& Result::gtids() const
+{
+    return _gtids;
+}
+
 /**
  *  Get the number of rows in this result
  */
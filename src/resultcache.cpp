@@ -0,0 +1,455 @@
+/**
+ *  ResultCache.cpp
+ *
+ *  Cache for the results of queries that read data
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  The current time in nanoseconds
+ */
+static uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ *  Split a query into tokens
+ *
+ *  Words are lowercased, quoted identifiers are returned as words too,
+ *  strings become a single quote, and other characters are returned as
+ *  they are. Whitespace and comments are skipped, the code in executable
+ *  comments is not.
+ *
+ *  @param  query       the query to split
+ *  @param  tokens      where to store the tokens, with their type
+ */
+static void tokenize(const std::string& query, std::vector<std::pair<char, std::string>>& tokens)
+{
+    // walk over the query
+    for (size_t i = 0, size = query.size(); i < size;)
+    {
+        // the current character
+        char c = query[i];
+
+        // skip whitespace
+        if (isspace((unsigned char)c)) { ++i; continue; }
+
+        // skip comments that run to the end of the line
+        if (c == '#' || (c == '-' && query.compare(i, 3, "-- ") == 0))
+        {
+            i = query.find('\n', i);
+            if (i == std::string::npos) break;
+            continue;
+        }
+
+        // the code in executable comments is run, so we only skip the version
+        if (c == '/' && query.compare(i, 3, "/*!") == 0)
+        {
+            for (i += 3; i < size && isdigit((unsigned char)query[i]); ++i) {}
+            continue;
+        }
+
+        // skip other block comments
+        if (c == '/' && query.compare(i, 2, "/*") == 0)
+        {
+            i = query.find("*/", i + 2);
+            if (i == std::string::npos) break;
+            i += 2;
+            continue;
+        }
+
+        // skip the end of an executable comment
+        if (c == '*' && query.compare(i, 2, "*/") == 0) { i += 2; continue; }
+
+        // quoted identifiers are words
+        if (c == '`')
+        {
+            std::string word;
+            for (++i; i < size && query[i] != '`'; ++i) word.push_back(tolower((unsigned char)query[i]));
+            tokens.emplace_back('w', std::move(word));
+            ++i;
+            continue;
+        }
+
+        // strings are skipped
+        if (c == '\'' || c == '"')
+        {
+            for (++i; i < size && query[i] != c; ++i) if (query[i] == '\\') ++i;
+            tokens.emplace_back('\'', std::string());
+            ++i;
+            continue;
+        }
+
+        // other characters are returned as they are
+        if (!isalnum((unsigned char)c) && c != '_' && c != '$')
+        {
+            tokens.emplace_back(c, std::string());
+            ++i;
+            continue;
+        }
+
+        // read the word
+        std::string word;
+        for (; i < size && (isalnum((unsigned char)query[i]) || query[i] == '_' || query[i] == '$'); ++i) word.push_back(tolower((unsigned char)query[i]));
+        tokens.emplace_back('w', std::move(word));
+    }
+}
+
+/**
+ *  Find out what a query does with the data
+ *
+ *  @param  query       the query to check
+ *  @param  tables      where to store the tables read or written
+ */
+ResultCache::Access ResultCache::classify(const std::string& query, std::vector<std::string>& tables)
+{
+    // the statements that read, and the ones that do not change anything
+    static const std::set<std::string> reads = { "select", "with" };
+    static const std::set<std::string> neutral = {
+        "show", "describe", "desc", "explain", "set", "begin", "start", "commit",
+        "savepoint", "release", "do", "help", "lock", "unlock", "flush", "analyze",
+        "optimize", "check", "checksum", "kill", "prepare", "deallocate"
+    };
+
+    // the statements after which we no longer know what is cached
+    static const std::set<std::string> unknown = { "rollback", "use", "call", "execute", "handler", "xa" };
+
+    // the words that make a read uncacheable, because it locks, writes or depends on the session, the clock or chance
+    static const std::set<std::string> volatiles = {
+        "sql_no_cache", "update", "share", "lock", "into", "rand", "uuid", "uuid_short",
+        "sleep", "benchmark", "get_lock", "release_lock", "release_all_locks", "is_free_lock",
+        "is_used_lock", "last_insert_id", "found_rows", "sql_calc_found_rows", "row_count",
+        "connection_id", "current_user", "user", "session_user", "system_user", "database",
+        "schema", "nextval", "setval", "lastval", "information_schema", "performance_schema",
+        "now", "sysdate", "curdate", "curtime", "current_date", "current_time", "current_timestamp",
+        "localtime", "localtimestamp", "unix_timestamp", "utc_date", "utc_time", "utc_timestamp"
+    };
+
+    // the words after which tables are named
+    static const std::set<std::string> starters = { "from", "join", "into", "update", "table", "tables", "using", "to", "delete", "insert", "replace", "truncate" };
+
+    // the words that may come in between, and the words that end a list of tables
+    static const std::set<std::string> modifiers = { "low_priority", "delayed", "high_priority", "quick", "ignore", "temporary", "if", "not", "exists", "only", "lateral", "straight_join" };
+    static const std::set<std::string> enders = { "where", "set", "values", "value", "select", "group", "order", "limit", "having", "window", "union", "partition", "with", "for", "lock", "like", "rename", "add", "drop", "modify", "change", "alter" };
+
+    // split the query
+    std::vector<std::pair<char, std::string>> tokens;
+    tokenize(query, tokens);
+
+    // find the first word
+    size_t first = 0;
+    while (first < tokens.size() && tokens[first].first == '(') ++first;
+    if (first == tokens.size() || tokens[first].first != 'w') return Access::none;
+    auto &statement = tokens[first].second;
+
+    // some statements can be ignored, after others we no longer know what is cached
+    if (neutral.count(statement)) return Access::none;
+    if (unknown.count(statement)) return Access::write;
+
+    // is this a read?
+    bool read = reads.count(statement) > 0;
+
+    // the state of the scan: do we expect a table, did we just see a table, and should
+    // it be qualified by the next word, and are we in a list of tables at every depth
+    bool expect = false, just = false, qualify = false;
+    std::vector<bool> lists(1, false);
+
+    // walk over the tokens
+    for (size_t i = first; i < tokens.size(); ++i)
+    {
+        // the token and its type
+        auto type = tokens[i].first;
+        auto &word = tokens[i].second;
+
+        // a second statement may do anything
+        if (type == ';')
+        {
+            if (i + 1 == tokens.size()) break;
+            tables.clear();
+            return Access::write;
+        }
+
+        // user variables depend on the session
+        if (type == '@' && read) return Access::none;
+
+        // a qualified table name, the database is not part of the name
+        if (type == '.' && just) { qualify = true; continue; }
+        if (type == 'w' && qualify)
+        {
+            tables.back() = word;
+            qualify = just = false;
+            continue;
+        }
+        qualify = just = false;
+
+        // keep track of the parentheses, every level can have its own list of tables
+        if (type == '(') { lists.push_back(false); expect = false; continue; }
+        if (type == ')')
+        {
+            if (lists.size() > 1) lists.pop_back();
+            expect = false;
+            continue;
+        }
+
+        // a comma in a list of tables is followed by another table
+        if (type == ',') { if (lists.back()) expect = true; continue; }
+
+        // everything else should be a word
+        if (type != 'w') { expect = false; continue; }
+
+        // reads may not depend on anything but the data
+        if (read && volatiles.count(word)) return Access::none;
+
+        // words that end a list of tables
+        if (enders.count(word)) { expect = lists.back() = false; continue; }
+
+        // words that are followed by tables
+        if (starters.count(word)) { expect = lists.back() = true; continue; }
+
+        // skip the words in between, and words where we do not expect a table
+        if (!expect || modifiers.count(word)) continue;
+
+        // this is a table
+        if (word != "dual") tables.push_back(word);
+        expect = false;
+        just = true;
+    }
+
+    // reads can only be cached when we know which tables they read
+    if (read) return tables.empty() ? Access::none : Access::read;
+
+    // anything else is a write
+    return Access::write;
+}
+
+/**
+ *  Remove a cached result
+ *
+ *  @param  entry       the result to remove
+ */
+void ResultCache::erase(std::list<Entry>::iterator entry)
+{
+    // remove it from the tables it was read from
+    for (auto &table : entry->tables)
+    {
+        auto tag = _tags.find(table);
+        if (tag == _tags.end()) continue;
+        tag->second.erase(entry->key);
+        if (tag->second.empty()) _tags.erase(tag);
+    }
+
+    // and forget about it
+    _bytes -= entry->size;
+    _index.erase(entry->key);
+    _entries.erase(entry);
+}
+
+/**
+ *  Remove results until they fit in the capacity
+ */
+void ResultCache::shrink()
+{
+    // remove the results that were used least recently
+    while (_bytes > _capacity && !_entries.empty()) erase(std::prev(_entries.end()));
+}
+
+/**
+ *  Look up the result of a query
+ *
+ *  @param  query       the query
+ *  @param  projection  the columns that are materialized
+ *  @param  miss        where to store the record for a missed query
+ *  @return the cached result, or a nullptr
+ */
+std::shared_ptr<ResultImpl> ResultCache::lookup(const std::string& query, const Projection& projection, std::shared_ptr<Miss>& miss)
+{
+    // is the cache enabled at all?
+    if (!enabled()) return nullptr;
+
+    // find out what the query does
+    std::vector<std::string> tables;
+    switch (classify(query, tables))
+    {
+    case Access::none:
+        return nullptr;
+    case Access::write:
+        // invalidate the tables the query writes
+        invalidate(tables);
+        return nullptr;
+    case Access::read:
+        break;
+    }
+
+    // the key holds the projected columns too
+    std::string key(query);
+    for (auto &column : projection.columns()) key.append(1, '\0').append(column);
+
+    // do we have the result?
+    auto iter = _index.find(key);
+    if (iter != _index.end())
+    {
+        // did it expire?
+        auto entry = iter->second;
+        if (entry->expires == 0 || entry->expires > now())
+        {
+            // it is now the most recently used result
+            _entries.splice(_entries.begin(), _entries, entry);
+            ++_hits;
+            return entry->result;
+        }
+
+        // remove the expired result
+        erase(entry);
+    }
+
+    // the result can be stored when it arrives
+    ++_misses;
+    miss = std::make_shared<Miss>(Miss{ std::move(key), std::move(tables), _version });
+    return nullptr;
+}
+
+/**
+ *  Store the result of a query that missed the cache
+ *
+ *  @param  miss        the record of the missed query
+ *  @param  result      the result
+ *  @param  size        the number of bytes in the fields of the result
+ */
+void ResultCache::store(const Miss& miss, const std::shared_ptr<ResultImpl>& result, size_t size)
+{
+    // the result may be outdated when tables were written since the query was sent
+    if (!enabled() || miss.version != _version) return;
+
+    // count the fields and the key too
+    size += result->size() * result->fields().size() * (sizeof(QueryResultField) + sizeof(void*)) + miss.key.size();
+
+    // results that do not fit are not stored
+    if (size > _capacity) return;
+
+    // replace the result that is already there
+    auto iter = _index.find(miss.key);
+    if (iter != _index.end()) erase(iter->second);
+
+    // add the result as the most recently used
+    _entries.push_front(Entry{ miss.key, miss.tables, result, size, _ttl > 0.0 ? now() + (uint64_t)(_ttl * 1e9) : 0 });
+    _index[miss.key] = _entries.begin();
+    _bytes += size;
+
+    // remember which tables it was read from
+    for (auto &table : miss.tables) _tags[table].insert(miss.key);
+
+    // make room for it
+    shrink();
+}
+
+/**
+ *  Invalidate the tables written by a query
+ *
+ *  @param  query       the query
+ */
+void ResultCache::written(const std::string& query)
+{
+    // is there anything to invalidate?
+    if (!enabled()) return;
+
+    // find out what the query does
+    std::vector<std::string> tables;
+    if (classify(query, tables) == Access::write) invalidate(tables);
+}
+
+/**
+ *  Invalidate the tables written by a query
+ *
+ *  @param  tables      the tables, or none when we do not know which
+ */
+void ResultCache::invalidate(const std::vector<std::string>& tables)
+{
+    // when we do not know what was written, nothing can be trusted
+    if (tables.empty()) return clear();
+
+    // remove the results read from the tables
+    for (auto &table : tables) invalidate(table);
+}
+
+/**
+ *  Set the maximum number of bytes to store
+ *
+ *  @param  bytes       the maximum number of bytes
+ */
+ResultCache& ResultCache::capacity(size_t bytes)
+{
+    // remove what no longer fits
+    _capacity = bytes;
+    shrink();
+    return *this;
+}
+
+/**
+ *  Set how long results stay valid
+ *
+ *  @param  seconds     the time to live, or zero to keep results until they are invalidated
+ */
+ResultCache& ResultCache::ttl(double seconds)
+{
+    _ttl = seconds;
+    return *this;
+}
+
+/**
+ *  Remove the results read from a table
+ *
+ *  @param  table       name of the table, without the database
+ */
+void ResultCache::invalidate(const std::string& table)
+{
+    // results that are on their way may be outdated
+    ++_version;
+
+    // the tables are stored in lowercase
+    std::string name(table);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return tolower(c); });
+
+    // find the results read from the table
+    auto tag = _tags.find(name);
+    if (tag == _tags.end()) return;
+
+    // take the queries, removing the results changes the tag
+    auto keys = std::move(tag->second);
+    _tags.erase(tag);
+
+    // and remove their results
+    for (auto &key : keys)
+    {
+        auto iter = _index.find(key);
+        if (iter != _index.end()) erase(iter->second);
+    }
+}
+
+/**
+ *  Remove all results
+ */
+void ResultCache::clear()
+{
+    // results that are on their way may be outdated
+    ++_version;
+
+    // forget about everything
+    _entries.clear();
+    _index.clear();
+    _tags.clear();
+    _bytes = 0;
+}
+
+/**
+ *  End namespace
+ */
+}}
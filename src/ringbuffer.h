@@ -0,0 +1,121 @@
+/**
+ *  RingBuffer.h
+ *
+ *  Fixed-size lock-free queue for a single producer thread and a
+ *  single consumer thread. Both sides only touch their own index
+ *  and read the other one, so pushing and popping is a handful of
+ *  instructions and never blocks. When the buffer is full, push()
+ *  fails instead of waiting for the consumer.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Ring buffer class
+ */
+template <typename T>
+class RingBuffer
+{
+private:
+    /**
+     *  The slots, the number of slots is a power of two
+     */
+    std::vector<T> _slots;
+
+    /**
+     *  Mask to turn an index into a slot
+     */
+    size_t _mask;
+
+    /**
+     *  The next slot to read, written by the consumer
+     */
+    std::atomic<size_t> _head;
+
+    /**
+     *  Keep the indices on separate cache lines, so the
+     *  threads do not invalidate each other's cache
+     */
+    char _padding[64];
+
+    /**
+     *  The next slot to write, written by the producer
+     */
+    std::atomic<size_t> _tail;
+
+    /**
+     *  Round up to the next power of two
+     *
+     *  @param  value       the value to round up
+     */
+    static size_t round(size_t value)
+    {
+        size_t result = 1;
+        while (result < value) result <<= 1;
+        return result;
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  capacity    the minimum number of slots
+     */
+    RingBuffer(size_t capacity) : _slots(round(capacity)), _mask(_slots.size() - 1), _head(0), _tail(0) {}
+
+    /**
+     *  Add a value to the buffer
+     *
+     *  @note:  This function is to be executed from
+     *          the producer thread only
+     *
+     *  @param  value       the value to add
+     *  @return false if the buffer was full
+     */
+    bool push(const T& value)
+    {
+        // the slot to write to
+        auto tail = _tail.load(std::memory_order_relaxed);
+
+        // is the buffer full?
+        if (tail - _head.load(std::memory_order_acquire) == _slots.size()) return false;
+
+        // store the value and publish it
+        _slots[tail & _mask] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     *  Take a value from the buffer
+     *
+     *  @note:  This function is to be executed from
+     *          the consumer thread only
+     *
+     *  @param  value       the value to fill
+     *  @return false if the buffer was empty
+     */
+    bool pop(T& value)
+    {
+        // the slot to read from
+        auto head = _head.load(std::memory_order_relaxed);
+
+        // is the buffer empty?
+        if (head == _tail.load(std::memory_order_acquire)) return false;
+
+        // read the value and release the slot
+        value = _slots[head & _mask];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
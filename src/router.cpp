@@ -0,0 +1,353 @@
+/**
+ *  Router.cpp
+ *
+ *  Class that splits reads and writes over a primary server and its
+ *  replicas.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Constructor
+ *
+ *  @param  loop        the loop to bind to
+ *  @param  primary     the pool of connections to the primary
+ */
+Router::Router(Loop *loop, Pool *primary) :
+    _loop(loop),
+    _primary(primary)
+{
+    // we want to know what the writes committed
+    _primary->trackGtids();
+}
+
+/**
+ *  Destructor
+ */
+Router::~Router()
+{
+    // stop probing
+    if (_timer) _timer->cancel();
+}
+
+/**
+ *  Add a replica
+ *
+ *  @param  replica     the pool of connections to the replica
+ */
+void Router::add(Pool *replica)
+{
+    _replicas.push_back(std::make_shared<Replica>(replica));
+}
+
+/**
+ *  Start measuring the latency and replication lag of the replicas
+ *
+ *  @param  interval    the time between probes, in seconds
+ *  @param  lag         the maximum lag for reads, in seconds, zero for no maximum
+ *  @param  query       the query to measure the lag with
+ */
+void Router::monitor(double interval, double lag, const std::string& query)
+{
+    // store the settings
+    _lag = lag;
+    _query = query;
+
+    // stop the current timer
+    if (_timer) _timer->cancel();
+    _timer = nullptr;
+
+    // are we probing at all?
+    if (interval <= 0.0) return;
+
+    // probe right away, and then every interval
+    _timer = _loop->onInterval(0.0, interval, [this]() { probe(); });
+}
+
+/**
+ *  Set how long a replica may take to apply the writes of a session
+ *
+ *  @param  timeout     the time in seconds
+ */
+void Router::timeout(double timeout)
+{
+    _timeout = timeout;
+}
+
+/**
+ *  Read the replication lag from the result of a probe
+ *
+ *  @param  result      the result of the probe
+ *  @param  custom      was the lag measured by a custom query?
+ *  @param  lag         where to store the lag
+ *  @return is replication running?
+ */
+static bool measure(Result &result, bool custom, double &lag)
+{
+    // a server without replica status does not replicate, so it cannot lag
+    if (result.size() == 0 && !custom) lag = 0.0;
+    if (result.size() == 0) return !custom;
+
+    // the row with the lag
+    auto row = result[0];
+
+    // a custom query gives the lag in the first field
+    if (custom)
+    {
+        auto field = row[0];
+        if (field.isNULL()) return false;
+        lag = field;
+        return true;
+    }
+
+    // the replica status names the field after the version of the server
+    for (auto name : { "Seconds_Behind_Source", "Seconds_Behind_Master" })
+    {
+        try
+        {
+            // the lag is NULL when replication is not running
+            auto field = row[name];
+            if (field.isNULL()) return false;
+            lag = field;
+            return true;
+        }
+        catch (const Exception &exception)
+        {
+            // the server uses the other name
+        }
+    }
+
+    // we have no idea
+    return false;
+}
+
+/**
+ *  Measure the latency and replication lag of all replicas
+ */
+void Router::probe()
+{
+    // do we measure the lag with our own query?
+    bool custom = !_query.empty();
+
+    // probe all replicas
+    for (auto &replica : _replicas)
+    {
+        // skip replicas that did not answer the last probe yet
+        if (replica->probing) continue;
+        replica->probing = true;
+
+        // the query to send, older servers do not know the replica status
+        auto query = custom ? _query : replica->legacy ? "SHOW SLAVE STATUS" : "SHOW REPLICA STATUS";
+
+        // the moment we sent the probe
+        auto *loop = _loop;
+        auto start = loop->now();
+
+        // send it, the probes share ownership of the replica with the router
+        replica->pool->connection().query(query).onSuccess([replica, loop, start, custom](Result&& result) {
+            // the probe is back
+            replica->probing = false;
+
+            // update the average round trip
+            double elapsed = loop->now() - start;
+            replica->latency = replica->latency == 0.0 ? elapsed : 0.8 * replica->latency + 0.2 * elapsed;
+
+            // and the replication lag
+            replica->healthy = measure(result, custom, replica->lag);
+        }).onFailure([replica, custom](const char *error) {
+            // the probe is back
+            replica->probing = false;
+
+            // the server may only know the old name of the status,
+            // otherwise we cannot tell whether it is up to date
+            if (!custom && !replica->legacy) replica->legacy = true;
+            else replica->healthy = false;
+        });
+    }
+}
+
+/**
+ *  Is a query a plain read, that can run on a replica?
+ *
+ *  @param  query       the query to check
+ */
+bool Router::readonly(const std::string& query)
+{
+    // the statements that only read
+    static const std::set<std::string> reads = { "SELECT", "SHOW", "DESCRIBE", "DESC", "EXPLAIN", "WITH" };
+
+    // the words that make a read write, lock or depend on the session
+    static const std::set<std::string> writes = {
+        "INSERT", "UPDATE", "DELETE", "REPLACE", "INTO", "SHARE", "LOCK",
+        "GET_LOCK", "RELEASE_LOCK", "RELEASE_ALL_LOCKS", "LAST_INSERT_ID",
+        "FOUND_ROWS", "SQL_CALC_FOUND_ROWS", "NEXTVAL", "SETVAL"
+    };
+
+    // did we see the first word?
+    bool first = false;
+
+    // walk over the query
+    for (size_t i = 0, size = query.size(); i < size;)
+    {
+        // the current character
+        char c = query[i];
+
+        // skip whitespace and parentheses
+        if (isspace((unsigned char)c) || c == '(' || c == ')') { ++i; continue; }
+
+        // skip comments that run to the end of the line
+        if (c == '#' || (c == '-' && query.compare(i, 3, "-- ") == 0))
+        {
+            i = query.find('\n', i);
+            if (i == std::string::npos) break;
+            continue;
+        }
+
+        // skip block comments, but not the ones with executable code
+        if (c == '/' && query.compare(i, 2, "/*") == 0)
+        {
+            if (query.compare(i, 3, "/*!") == 0) return false;
+            i = query.find("*/", i + 2);
+            if (i == std::string::npos) return false;
+            i += 2;
+            continue;
+        }
+
+        // skip strings and quoted identifiers
+        if (c == '\'' || c == '"' || c == '`')
+        {
+            for (++i; i < size && query[i] != c; ++i) if (query[i] == '\\' && c != '`') ++i;
+            ++i;
+            continue;
+        }
+
+        // a second statement may do anything
+        if (c == ';')
+        {
+            while (++i < size) if (!isspace((unsigned char)query[i])) return false;
+            break;
+        }
+
+        // skip everything that does not start a word
+        if (!isalpha((unsigned char)c) && c != '_') { ++i; continue; }
+
+        // read the word
+        std::string word;
+        for (; i < size && (isalnum((unsigned char)query[i]) || query[i] == '_' || query[i] == '$'); ++i) word.push_back(toupper((unsigned char)query[i]));
+
+        // the first word tells what kind of statement this is
+        if (!first && reads.find(word) == reads.end()) return false;
+        first = true;
+
+        // the other words may turn it into something else
+        if (writes.find(word) != writes.end()) return false;
+    }
+
+    // an empty query is not a read
+    return first;
+}
+
+/**
+ *  Retrieve a connection to the primary
+ */
+Connection& Router::writer()
+{
+    return _primary->connection();
+}
+
+/**
+ *  The replica expected to answer fastest
+ *
+ *  @return the replica, or a nullptr if no replica can take reads
+ */
+Replica *Router::select()
+{
+    // the best replica so far, with its expected time and load
+    Replica *best = nullptr;
+    double expected = 0.0;
+    size_t load = 0;
+
+    // check all replicas
+    for (auto &replica : _replicas)
+    {
+        // skip replicas that do not replicate, or that lag too much
+        if (!replica->healthy || (_lag > 0.0 && replica->lag > _lag)) continue;
+
+        // the time it is expected to take, given the queries already waiting
+        size_t pending = replica->pool->pending();
+        double time = replica->latency * (1 + pending);
+
+        // is this one better?
+        if (best && (time > expected || (time == expected && pending >= load))) continue;
+        best = replica.get();
+        expected = time;
+        load = pending;
+    }
+
+    // return the best replica
+    return best;
+}
+
+/**
+ *  Retrieve the connection to the replica expected to answer fastest
+ */
+Connection& Router::reader()
+{
+    // find the best replica
+    auto *replica = select();
+
+    // without replicas, the primary takes the reads
+    return replica ? replica->pool->connection() : _primary->connection();
+}
+
+/**
+ *  Execute a query for a session on the primary or on a replica
+ *
+ *  @param  query       the query to execute
+ *  @param  session     the session the query is for
+ *  @param  projection  the columns to materialize
+ */
+Deferred& Router::query(std::string query, const Session& session, const Projection& projection)
+{
+    // writes, and reads for sessions that did not write, go the usual way
+    if (session.empty() || !readonly(query)) return this->query(std::move(query), projection);
+
+    // without replicas, the primary takes the read
+    auto *replica = select();
+    if (!replica) return writer().query(std::move(query), projection);
+
+    // the connections to try
+    auto *connection = &replica->pool->connection();
+    auto *primary = &writer();
+
+    // the deferred handler for the query, wherever it ends up
+    auto deferred = connection->allocate();
+
+    // ask the replica to wait until it has applied the writes of the session
+    auto wait = "SELECT WAIT_FOR_EXECUTED_GTID_SET('" + session.gtids() + "', " + std::to_string(_timeout) + ")";
+
+    // send the query to the replica if it did, and to the primary if it did not
+    connection->query(std::move(wait)).onSuccess([connection, primary, deferred, query, projection](Result&& result) {
+        // the function returns zero when the transactions were applied
+        bool applied = result.size() > 0 && !result[0][0].isNULL() && (int64_t)result[0][0] == 0;
+        (applied ? connection : primary)->submit(query, projection, std::string(), deferred);
+    }).onFailure([primary, deferred, query, projection](const char *error) {
+        // the replica does not know about GTIDs
+        primary->submit(query, projection, std::string(), deferred);
+    });
+
+    // return the deferred handler
+    return *deferred;
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,104 @@
+/**
+ *  Session.cpp
+ *
+ *  Consistency token for reading your own writes from replicas.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Add the transaction committed by a write
+ *
+ *  @param  result      the result of the write
+ */
+void Session::update(const Result& result)
+{
+    update(result.gtids());
+}
+
+/**
+ *  Add the transactions in a GTID set
+ *
+ *  The set looks like "uuid:1-5:7,uuid:3", where the uuid may be
+ *  followed by a tag ("uuid:tag:1-5") on recent servers.
+ *
+ *  @param  gtids       the GTID set
+ */
+void Session::update(const std::string& gtids)
+{
+    // the source we are reading the intervals of
+    std::string source;
+
+    // walk over all parts of the set
+    for (size_t start = 0, size = gtids.size(); start < size;)
+    {
+        // find the end of the part
+        size_t end = start;
+        while (end < size && gtids[end] != ':' && gtids[end] != ',') ++end;
+
+        // the part, without whitespace
+        std::string part;
+        for (size_t i = start; i < end; ++i) if (!isspace((unsigned char)gtids[i])) part.push_back(gtids[i]);
+
+        // was this the first part of a source?
+        bool first = start == 0 || gtids[start - 1] == ',';
+        start = end + 1;
+
+        // the first part is the uuid of the source
+        if (first)
+        {
+            source = part;
+            continue;
+        }
+
+        // other parts that do not start with a digit are tags
+        if (part.empty() || !isdigit((unsigned char)part[0]))
+        {
+            source += ":" + part;
+            continue;
+        }
+
+        // the interval ends after the dash, if there is one
+        auto dash = part.find('-');
+        uint64_t last = std::strtoull(part.c_str() + (dash == std::string::npos ? 0 : dash + 1), nullptr, 10);
+
+        // remember the highest transaction for the source
+        auto &highest = _sources[source];
+        highest = std::max(highest, last);
+    }
+}
+
+/**
+ *  The GTID set a replica must have applied to serve the session
+ */
+std::string Session::gtids() const
+{
+    // the set to build
+    std::string result;
+
+    // add all sources
+    for (auto &source : _sources)
+    {
+        // skip sources that are not valid, so the set is safe to put in a query
+        if (!std::all_of(source.first.begin(), source.first.end(), [](char c) { return isalnum((unsigned char)c) || c == '-' || c == ':' || c == '_'; })) continue;
+
+        // add all transactions of the source
+        if (!result.empty()) result.push_back(',');
+        result.append(source.first).append(":1-").append(std::to_string(source.second));
+    }
+
+    // return the set
+    return result;
+}
+
+/**
+ *  End namespace
+ */
+}}
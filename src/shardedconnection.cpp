@@ -0,0 +1,87 @@
+/**
+ *  ShardedConnection.cpp
+ *
+ *  Class for data that is split over a number of shards.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Constructor
+ *
+ *  @param  shards      the pools for the shards
+ *  @param  map         the map from keys to shards
+ */
+ShardedConnection::ShardedConnection(std::vector<Pool*> shards, std::shared_ptr<const ShardMap> map) :
+    _shards(std::move(shards)),
+    _map(std::move(map))
+{}
+
+/**
+ *  Destructor
+ */
+ShardedConnection::~ShardedConnection() {}
+
+/**
+ *  Install a new shard map
+ *
+ *  @param  map         the map from keys to shards
+ */
+void ShardedConnection::map(std::shared_ptr<const ShardMap> map)
+{
+    // the queries that were sent do not refer to the map, so we can just replace it
+    _map = std::move(map);
+}
+
+/**
+ *  The current shard map
+ */
+const std::shared_ptr<const ShardMap>& ShardedConnection::map() const
+{
+    return _map;
+}
+
+/**
+ *  Add the pool for a shard
+ *
+ *  @param  shard       the pool for the shard
+ *  @return index of the shard
+ */
+size_t ShardedConnection::add(Pool *shard)
+{
+    _shards.push_back(shard);
+    return _shards.size() - 1;
+}
+
+/**
+ *  The pool for a shard key
+ *
+ *  @param  key         the shard key
+ *  @throws Exception   if the map refers to a shard that does not exist
+ */
+Pool& ShardedConnection::pool(const std::string& key)
+{
+    // we need a map
+    if (!_map) throw Exception("No shard map installed");
+
+    // find the shard
+    auto shard = _map->shard(key);
+
+    // does it exist?
+    if (shard >= _shards.size()) throw Exception("Shard does not exist");
+
+    // return its pool
+    return *_shards[shard];
+}
+
+/**
+ *  End namespace
+ */
+}}
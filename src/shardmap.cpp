@@ -0,0 +1,139 @@
+/**
+ *  ShardMap.cpp
+ *
+ *  Implementation of the shard maps
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Hash a shard key
+ *
+ *  @param  key         the shard key
+ */
+uint64_t ShardMap::hash(const std::string& key)
+{
+    // 64-bit FNV-1a
+    uint64_t result = 14695981039346656037ULL;
+    for (auto c : key) result = (result ^ (unsigned char)c) * 1099511628211ULL;
+
+    // mix the bits, so the last characters affect the high bits too
+    result ^= result >> 33;
+    result *= 0xff51afd7ed558ccdULL;
+    result ^= result >> 33;
+    result *= 0xc4ceb9fe1a85ec53ULL;
+    result ^= result >> 33;
+
+    // done
+    return result;
+}
+
+/**
+ *  Constructor that divides the hash space evenly
+ *
+ *  @param  shards      the number of shards
+ */
+RangeShardMap::RangeShardMap(size_t shards)
+{
+    // the size of every range
+    uint64_t size = shards ? UINT64_MAX / shards : 0;
+
+    // add the ranges, the last one runs to the end
+    for (size_t shard = 0; shard < shards; ++shard) add(shard + 1 == shards ? UINT64_MAX : size * (shard + 1), shard);
+}
+
+/**
+ *  Add a range
+ *
+ *  @param  last        the last hash in the range
+ *  @param  shard       the shard the range belongs to
+ */
+RangeShardMap& RangeShardMap::add(uint64_t last, size_t shard)
+{
+    // add the range, keeping the ranges sorted
+    auto range = std::make_pair(last, shard);
+    _ranges.insert(std::upper_bound(_ranges.begin(), _ranges.end(), range), range);
+    return *this;
+}
+
+/**
+ *  The shard for a hash
+ *
+ *  @param  hash        the hash of the shard key
+ *  @return index of the shard
+ */
+size_t RangeShardMap::shard(uint64_t hash) const
+{
+    // we need at least one range
+    if (_ranges.empty()) throw Exception("Shard map has no ranges");
+
+    // find the first range that ends at or after the hash
+    auto iter = std::lower_bound(_ranges.begin(), _ranges.end(), std::make_pair(hash, (size_t)0));
+
+    // hashes after the last range belong to the first
+    return iter == _ranges.end() ? _ranges.front().second : iter->second;
+}
+
+/**
+ *  Constructor with a number of shards
+ *
+ *  @param  shards      the number of shards
+ *  @param  points      the number of points for every shard
+ */
+RingShardMap::RingShardMap(size_t shards, size_t points)
+{
+    // add all shards
+    for (size_t shard = 0; shard < shards; ++shard) add(shard, points);
+}
+
+/**
+ *  Add a shard to the ring
+ *
+ *  @param  shard       the shard to add
+ *  @param  points      the number of points for the shard
+ */
+RingShardMap& RingShardMap::add(size_t shard, size_t points)
+{
+    // make room for the points
+    _points.reserve(_points.size() + points);
+
+    // the points are the hashes of the shard number and the point number
+    for (size_t point = 0; point < points; ++point)
+    {
+        _points.emplace_back(hash(std::to_string(shard) + "#" + std::to_string(point)), shard);
+    }
+
+    // keep the ring sorted
+    std::sort(_points.begin(), _points.end());
+    return *this;
+}
+
+/**
+ *  The shard for a hash
+ *
+ *  @param  hash        the hash of the shard key
+ *  @return index of the shard
+ */
+size_t RingShardMap::shard(uint64_t hash) const
+{
+    // we need at least one point
+    if (_points.empty()) throw Exception("Shard map has no shards");
+
+    // find the first point at or after the hash
+    auto iter = std::lower_bound(_points.begin(), _points.end(), std::make_pair(hash, (size_t)0));
+
+    // the ring wraps around
+    return iter == _points.end() ? _points.front().second : iter->second;
+}
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,158 @@
+/**
+ *  SingleFlight.h
+ *
+ *  Keeps track of the reads that were sent to the worker and did not
+ *  return yet. An identical read that is sent in the meantime does not
+ *  go to the server, but boards the flight of the first one, and gets
+ *  the same result. The result is shared, not copied.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Single flight class
+ */
+class SingleFlight
+{
+public:
+    /**
+     *  A read on its way to the server, with the handlers waiting for it
+     */
+    struct Flight
+    {
+        /**
+         *  The query and its parameters
+         */
+        std::string key;
+
+        /**
+         *  The handlers of the callers
+         */
+        std::vector<std::shared_ptr<Deferred>> passengers;
+
+        /**
+         *  The flight landed with a result
+         *
+         *  @param  result      the result
+         */
+        void success(Result&& result)
+        {
+            // every passenger gets the same result
+            for (auto &passenger : passengers)
+            {
+                // the rows are shared, not copied
+                Result copy(result._affectedRows, result._insertID);
+                copy._result = result._result;
+                copy._gtids = result._gtids;
+
+                // pass it on
+                passenger->success(std::move(copy));
+            }
+        }
+
+        /**
+         *  The flight landed with an error
+         *
+         *  @param  error       the error
+         */
+        void failure(const char *error)
+        {
+            // every passenger gets the error
+            for (auto &passenger : passengers) passenger->failure(error);
+        }
+    };
+
+private:
+    /**
+     *  Are identical reads combined?
+     */
+    bool _enabled = false;
+
+    /**
+     *  The flights that can still be boarded, by their key
+     */
+    std::unordered_map<std::string, std::shared_ptr<Flight>> _flights;
+
+public:
+    /**
+     *  Enable or disable combining identical reads
+     *
+     *  @param  enabled     should identical reads be combined?
+     */
+    void enable(bool enabled)
+    {
+        // flights that are on their way still land
+        _enabled = enabled;
+        _flights.clear();
+    }
+
+    /**
+     *  Are identical reads combined?
+     */
+    bool enabled() const { return _enabled; }
+
+    /**
+     *  Board the flight of an identical read
+     *
+     *  When there is no such flight, a new one is created, which the
+     *  caller should send to the server.
+     *
+     *  @param  key         the query and its parameters
+     *  @param  deferred    the handler of the caller
+     *  @return the new flight, or a nullptr when an existing one was boarded
+     */
+    std::shared_ptr<Flight> board(const std::string& key, const std::shared_ptr<Deferred>& deferred)
+    {
+        // is an identical read on its way?
+        auto iter = _flights.find(key);
+        if (iter != _flights.end())
+        {
+            // take the same flight
+            iter->second->passengers.push_back(deferred);
+            return nullptr;
+        }
+
+        // create a new flight
+        auto flight = std::make_shared<Flight>();
+        flight->key = key;
+        flight->passengers.push_back(deferred);
+        _flights[key] = flight;
+
+        // done
+        return flight;
+    }
+
+    /**
+     *  Stop boarding the flights that are on their way
+     *
+     *  This is called when something is sent that may change the data,
+     *  the reads that follow should see the changes. The flights still
+     *  land, but nobody can board them anymore.
+     */
+    void close()
+    {
+        _flights.clear();
+    }
+
+    /**
+     *  A flight is about to land, nobody can board it anymore
+     *
+     *  @param  flight      the flight
+     */
+    void land(const std::shared_ptr<Flight>& flight)
+    {
+        // remove the flight, unless it was already replaced
+        auto iter = _flights.find(flight->key);
+        if (iter != _flights.end() && iter->second == flight) _flights.erase(iter);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,112 @@
+/**
+ *  SlowQueryLog.h
+ *
+ *  The configuration for reporting slow queries. This
+ *  is owned by the worker thread, which runs all the
+ *  queries, so it needs no locking.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Slow query log class
+ */
+class SlowQueryLog
+{
+private:
+    /**
+     *  The threshold for a query to be slow, in nanoseconds
+     */
+    uint64_t _threshold;
+
+    /**
+     *  The callback to report slow queries to
+     */
+    std::function<void(const SlowQuery& query)> _callback;
+
+    /**
+     *  The fraction of slow queries to explain
+     */
+    double _explain;
+
+    /**
+     *  Generator for sampling the queries to explain
+     */
+    std::minstd_rand _random;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  threshold   the threshold in seconds
+     *  @param  callback    the callback to report slow queries to
+     *  @param  explain     the fraction of slow queries to explain
+     */
+    SlowQueryLog(double threshold, const std::function<void(const SlowQuery& query)>& callback, double explain) :
+        _threshold(static_cast<uint64_t>(threshold * 1000000000.0)),
+        _callback(callback),
+        _explain(explain),
+        _random(std::random_device()()) {}
+
+    /**
+     *  Is a query with the given duration slow?
+     *
+     *  @param  duration    the time spent executing and fetching
+     */
+    bool exceeds(uint64_t duration) const
+    {
+        return duration >= _threshold;
+    }
+
+    /**
+     *  Should we explain the next slow query?
+     */
+    bool sample()
+    {
+        return _explain >= 1.0 || (_explain > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(_random) < _explain);
+    }
+
+    /**
+     *  The callback to report slow queries to
+     */
+    const std::function<void(const SlowQuery& query)>& callback() const
+    {
+        return _callback;
+    }
+
+    /**
+     *  Can a query with this digest be explained?
+     *
+     *  Only single statements that read or modify data can
+     *  be explained, so we check the first keyword and make
+     *  sure there are no further statements.
+     *
+     *  @param  digest      the digest of the query
+     */
+    static bool explainable(const std::string& digest)
+    {
+        // find the first keyword
+        auto end = digest.find_first_of(" (");
+        std::string keyword(digest, 0, end);
+
+        // compare case-insensitively
+        std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::tolower);
+
+        // is this a statement that can be explained?
+        if (keyword != "select" && keyword != "insert" && keyword != "update" && keyword != "delete" && keyword != "replace" && keyword != "with") return false;
+
+        // there may be nothing but a trailing semicolon to end the statement
+        auto semicolon = digest.find(';');
+        return semicolon == std::string::npos || digest.find_first_not_of("; ", semicolon) == std::string::npos;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -17,20 +17,27 @@ namespace React { namespace MySQL {
 /**
  *  Constructor
  *
+ *  When a projection is given, only the named columns are
+ *  materialized in the result. The other columns are bound
+ *  with zero-length buffers, so their data is never copied.
+ *
  *  @param  connection  the connection to run the statement on
  *  @param  statement   the statement to execute
+ *  @param  projection  the columns to materialize
  */
-Statement::Statement(Connection *connection, std::string statement) :
+Statement::Statement(Connection *connection, std::string statement, Projection projection) :
     _connection(connection),
     _statement(nullptr),
     _query(std::move(statement)),
+    _projection(std::move(projection)),
+    _access(ResultCache::classify(_query, _tables)),
     _parameters(0)
 {
     // keep the loop alive while the callback runs
-    auto reference = std::make_shared<React::LoopReference>(_connection->_loop);
+    InFlight reference(_connection->_inflight.get());
 
     // initialize statement in worker thread
-    _connection->_worker.execute([this, reference]() { initialize(reference); });
+    _connection->_worker->execute([this, reference]() { initialize(reference); });
 }
 
 /**
@@ -39,6 +46,11 @@ Statement::Statement(Connection *connection, std::string statement) :
 Statement::Statement(Statement&& that) :
     _connection(that._connection),
     _statement(that._statement),
+    _query(std::move(that._query)),
+    _projection(std::move(that._projection)),
+    _digest(std::move(that._digest)),
+    _tables(std::move(that._tables)),
+    _access(that._access),
     _parameters(that._parameters),
     _info(std::move(that._info))
 {
@@ -63,21 +75,24 @@ Statement::~Statement()
  *  @note:  This function is to be executed from
  *          worker context only
  *
- *  @param  reference   The loop reference to stay alive
+ *  @param  reference   The token keeping the loop alive
  */
-void Statement::initialize(const std::shared_ptr<React::LoopReference> &reference)
+void Statement::initialize(const InFlight &reference)
 {
+    // the digest only depends on the query, so it is computed only once
+    if (_digest.empty()) _digest = Digest::normalize(_query);
+
     // initialize statement
     if ((_statement = mysql_stmt_init(_connection->_connection)) == nullptr)
     {
-        _connection->_master.execute([this, reference]() { if (_prepareCallback) _prepareCallback("Unable to initialize statement"); });
+        _connection->deliver([this, reference]() { if (_prepareCallback) _prepareCallback("Unable to initialize statement"); });
         return;
     }
 
     // prepare statement
     if (mysql_stmt_prepare(_statement, _query.c_str(), _query.size()))
     {
-        _connection->_master.execute([this, reference]() {
+        _connection->deliver([this, reference]() {
             // inform callback of problem
             if (_prepareCallback) _prepareCallback(mysql_stmt_error(_statement));
 
@@ -95,10 +110,113 @@ void Statement::initialize(const std::shared_ptr<React::LoopReference> &referenc
     auto *result = mysql_stmt_result_metadata(_statement);
 
     // if the statement does return fields, store information about it
-    if (result != nullptr) _info.reset(new StatementResultInfo(_statement, result));
+    if (result != nullptr) _info.reset(new StatementResultInfo(_statement, result, _projection));
 
     // all is well, inform the callback
-    _connection->_master.execute([this, reference] () { if (_prepareCallback) _prepareCallback(nullptr); });
+    _connection->deliver([this, reference] () { if (_prepareCallback) _prepareCallback(nullptr); });
+}
+
+/**
+ *  The parameters of an execution, to tell otherwise identical reads apart
+ *
+ *  @param  parameters  The parameters
+ *  @param  count       The number of parameters
+ */
+static std::string variant(const Parameter *parameters, size_t count)
+{
+    // the result
+    std::string result;
+
+    // add the parameters
+    for (size_t i = 0; i < count; ++i)
+    {
+        // the parameter
+        auto &parameter = parameters[i];
+
+        // the number of bytes in the buffer
+        size_t size = parameter.buffer_length;
+        switch (parameter.buffer_type)
+        {
+            case MYSQL_TYPE_TINY:       size = 1; break;
+            case MYSQL_TYPE_SHORT:      size = 2; break;
+            case MYSQL_TYPE_LONG:       size = 4; break;
+            case MYSQL_TYPE_LONGLONG:   size = 8; break;
+            case MYSQL_TYPE_FLOAT:      size = 4; break;
+            case MYSQL_TYPE_DOUBLE:     size = 8; break;
+            case MYSQL_TYPE_NULL:       size = 0; break;
+            default:                    break;
+        }
+
+        // add the type, the size and the value, so values cannot run into each other
+        result.append(1, '\0').append(parameter.type()).append(1, ':').append(std::to_string(size)).append(1, ':');
+        if (size > 0) result.append(static_cast<const char *>(parameter.buffer), size);
+    }
+
+    // done
+    return result;
+}
+
+/**
+ *  Submit the statement for execution in the worker thread
+ *
+ *  @param  parameters  The parameters to execute with
+ *  @param  count       The number of parameters
+ *  @param  column      Name of the column to stream, if any
+ *  @param  sink        The sink to stream the column to, if any
+ *  @param  streams     The long data parameters and their index
+ */
+Deferred& Statement::submit(Parameter *parameters, size_t count, const std::string &column, const std::shared_ptr<ColumnSink> &sink, const std::vector<std::pair<unsigned int, LongData>> &streams)
+{
+    // create the deferred handler
+    auto deferred = _connection->allocate();
+
+    // keep the loop alive while the callback runs
+    InFlight reference(_connection->_inflight.get());
+
+    // the results read from the tables the statement writes are outdated
+    if (_access == ResultCache::Access::write && _connection->_cache->enabled()) _connection->_cache->invalidate(_tables);
+
+    // join an identical read on its way, or send the statement with the handler of a new flight,
+    // statements that stream data are always sent by themselves, but may still write
+    auto caller = deferred;
+    if (_connection->_flights->enabled())
+    {
+        // a streaming write still stops others from joining the reads on their way
+        if (sink || !streams.empty())
+        {
+            if (_access == ResultCache::Access::write) _connection->_flights->close();
+        }
+
+        // the parameters are not needed for a read that is not sent
+        else if (!(deferred = _connection->board(_access, _query, variant(parameters, count), caller)))
+        {
+            delete [] parameters;
+            return *caller;
+        }
+    }
+
+    // the moment the statement was submitted
+    auto submitted = StatisticsRecorder::now();
+
+    // trace the submission
+    auto id = ++_connection->_sequence;
+    REACT_MYSQL_PROBE(query_submit, _connection->_id, id, 0, 0);
+    if (auto *tracer = _connection->tracer()) tracer->record(id, Tracer::enqueue, submitted);
+
+    // execute statement in worker thread
+    _connection->_worker->execute([this, reference, parameters, count, deferred, column, sink, streams, submitted, id]() {
+        // record how long the statement waited for the worker
+        auto started = StatisticsRecorder::now();
+        _connection->_statistics->queued(started - submitted);
+        REACT_MYSQL_PROBE(worker_start, _connection->_id, id, 0, 0);
+        if (auto *tracer = _connection->tracer()) tracer->record(id, Tracer::start, started);
+
+        // and execute it
+        execute(parameters, count, reference, deferred, column, sink, streams, submitted, id);
+    });
+
+    // return the deferred handler
+    return *caller;
 }
 
 /**
@@ -109,15 +227,20 @@ void Statement::initialize(const std::shared_ptr<React::LoopReference> &referenc
  *
  *  @param  parameters  The parameters to retry with
  *  @param  count       The number of parameters
- *  @param  reference   The loop reference
+ *  @param  reference   The token keeping the loop alive
  *  @param  deferred    The previously created deferred handler
+ *  @param  column      Name of the column to stream, if any
+ *  @param  sink        The sink to stream the column to, if any
+ *  @param  streams     The long data parameters and their index
+ *  @param  submitted   The moment the statement was submitted
+ *  @param  id          The id of the execution, for tracing
  */
-void Statement::execute(Parameter *parameters, size_t count, const std::shared_ptr<React::LoopReference> &reference, const std::shared_ptr<Deferred> &deferred)
+void Statement::execute(Parameter *parameters, size_t count, const InFlight &reference, const std::shared_ptr<Deferred> &deferred, const std::string &column, const std::shared_ptr<ColumnSink> &sink, const std::vector<std::pair<unsigned int, LongData>> &streams, uint64_t submitted, uint64_t id)
 {
     // check for a valid statement
     if (_statement == nullptr)
     {
-        _connection->_master.execute([reference, deferred]() { deferred->failure("Cannot execute invalid statement"); });
+        _connection->fail(reference, deferred, "Cannot execute invalid statement", id);
         delete [] parameters;
         return;
     }
@@ -125,7 +248,7 @@ void Statement::execute(Parameter *parameters, size_t count, const std::shared_p
     // check for correct number of arguments and bind the parameters
     if (count != _parameters)
     {
-        _connection->_master.execute([reference, deferred]() { deferred->failure("Incorrect number of arguments"); });
+        _connection->fail(reference, deferred, "Incorrect number of arguments", id);
         delete [] parameters;
         return;
     }
@@ -133,18 +256,42 @@ void Statement::execute(Parameter *parameters, size_t count, const std::shared_p
     // bind the parameters
     if (mysql_stmt_bind_param(_statement, parameters))
     {
-        _connection->_master.execute([this, reference, deferred]() { deferred->failure(mysql_stmt_error(_statement)); });
+        _connection->fail(reference, deferred, mysql_stmt_error(_statement), id);
+        delete [] parameters;
+        return;
+    }
+
+    // stream the long data parameters to the server
+    if (!send(streams))
+    {
+        _connection->fail(reference, deferred, mysql_stmt_error(_statement), id);
         delete [] parameters;
         return;
     }
 
+    // the moment the server started executing
+    auto started = StatisticsRecorder::now();
+
     // execute the statement
-    if (mysql_stmt_execute(_statement))
+    auto failed = mysql_stmt_execute(_statement);
+
+    // record how long the server took to execute the statement
+    auto executed = StatisticsRecorder::now();
+    _connection->_statistics->executed(executed - started);
+    REACT_MYSQL_PROBE(execute_done, _connection->_id, id, 0, 0);
+    if (auto *tracer = _connection->tracer()) tracer->record(id, Tracer::execute, executed);
+
+    // did the execution fail?
+    if (failed)
     {
         // check if the connection was reset, in which case we will
-        // have to completely re-initialize the statement :(
-        if (mysql_stmt_errno(_statement) == CR_SERVER_LOST)
+        // have to completely re-initialize the statement :( - this
+        // is impossible if the long data was already consumed
+        if (mysql_stmt_errno(_statement) == CR_SERVER_LOST && streams.empty())
         {
+            // the connection is going to be reestablished
+            _connection->_statistics->reconnected();
+
             // the statement is now invalid
             // the client code cleans it up
             _statement = nullptr;
@@ -159,12 +306,18 @@ void Statement::execute(Parameter *parameters, size_t count, const std::shared_p
             initialize(reference);
 
             // and retry execution again
-            execute(parameters, count, reference, deferred);
+            execute(parameters, count, reference, deferred, column, sink, streams, submitted, id);
         }
         else
         {
+            // record the failed execution for the digest
+            _connection->_digests->record(_digest, executed - started, 0, 0, true);
+
             // an error occured that we can't recover from
-            _connection->_master.execute([this, reference, deferred]() { deferred->failure(mysql_stmt_error(_statement)); });
+            _connection->fail(reference, deferred, mysql_stmt_error(_statement), id);
+
+            // report it if the statement took too long anyway
+            if (_connection->slow(executed - started)) report(parameters, count, reference, started - submitted, executed - started, 0, 0, mysql_stmt_error(_statement), false);
             delete [] parameters;
         }
 
@@ -172,30 +325,201 @@ void Statement::execute(Parameter *parameters, size_t count, const std::shared_p
         return;
     }
 
-    // clean up input parameters
-    delete [] parameters;
+    // clean up input parameters once we are done with them
+    std::unique_ptr<Parameter[]> cleanup(parameters);
+
+    // the number of rows and bytes received, and the error if that failed
+    uint64_t rows = 0, bytes = 0;
+    std::string error;
 
-    // anyone interested in the result?
-    if (!deferred->requireStatus())
+    // are we streaming one of the columns?
+    if (sink)
     {
-        deferred->complete();
-        return;
+        // find the column to stream
+        auto index = _info ? _info->column(column) : std::string::npos;
+
+        // we cannot stream a column that does not exist
+        if (index == std::string::npos)
+        {
+            // the rows are still waiting on the server, and are thrown away
+            if (_info) _info->discard();
+            error = "Cannot stream unknown column";
+        }
+        else try
+        {
+            // stream the column, and retrieve the other fields
+            auto result = _info->rows(index, sink.get());
+            rows = result->size();
+            bytes = _info->bytes();
+            if (auto *tracer = _connection->tracer()) tracer->record(id, Tracer::fetch, StatisticsRecorder::now());
+
+            // send the result to the callback
+            _connection->deliver([reference, deferred, result]() { deferred->success(Result(std::move(result))); }, id, deferred.get());
+        }
+        catch (const Exception &exception)
+        {
+            // remember the problem
+            error = exception.what();
+        }
     }
 
     // if the query has no result set, we create the result with the affected rows
-    if (!_info) _connection->_master.execute([this, reference, deferred]() {
-        // the statement already knows the number of affected rows
-        // so doing this on the master will not block at all
-        deferred->success(Result(mysql_stmt_affected_rows(_statement), mysql_stmt_insert_id(_statement)));
-    });
-    else
+    else if (!_info)
+    {
+        // the number of affected rows, the generated id and the committed transaction
+        size_t affectedRows = mysql_stmt_affected_rows(_statement);
+        uint64_t insertID = mysql_stmt_insert_id(_statement);
+        auto committed = _connection->gtids();
+
+        // send the result to the callback
+        _connection->deliver([reference, deferred, affectedRows, insertID, committed]() {
+            // create the result, with the transaction it committed
+            Result result(affectedRows, insertID);
+            result._gtids = committed;
+
+            // and pass it to the listener
+            deferred->success(std::move(result));
+        }, id, deferred.get());
+    }
+    else try
     {
         // retrieve the result
-        auto rows = _info->rows();
+        auto result = _info->rows();
+        rows = result->size();
+        bytes = _info->bytes();
+        if (auto *tracer = _connection->tracer()) tracer->record(id, Tracer::fetch, StatisticsRecorder::now());
 
         // send the result to the callback
-       _connection->_master.execute([reference, deferred, rows]() { deferred->success(Result(std::move(rows))); });
+        _connection->deliver([reference, deferred, result]() { deferred->success(Result(std::move(result))); }, id, deferred.get());
+    }
+    catch (const Exception &exception)
+    {
+        // remember the problem
+        error = exception.what();
+    }
+
+    // inform the callback of the problem
+    if (!error.empty()) _connection->fail(reference, deferred, error.c_str(), id);
+
+    // record the fetch and the received data
+    auto fetched = StatisticsRecorder::now();
+    REACT_MYSQL_PROBE(result_materialized, _connection->_id, id, bytes, rows);
+    if (_info) _connection->_statistics->fetched(fetched - executed);
+    _connection->_statistics->received(rows, bytes);
+    _connection->_digests->record(_digest, fetched - started, rows, bytes, !error.empty());
+
+    // report slow statements, now that the result was consumed
+    if (!_connection->slow(fetched - started)) return;
+    report(parameters, count, reference, started - submitted, executed - started, fetched - executed, rows, error.empty() ? nullptr : error.c_str(), streams.empty());
+}
+
+/**
+ *  Report a slow execution of the statement
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ *
+ *  @param  parameters  The parameters the statement was executed with
+ *  @param  count       The number of parameters
+ *  @param  reference   The token keeping the loop alive
+ *  @param  queued      Time spent before the statement was sent to the server
+ *  @param  execution   Time spent executing the statement
+ *  @param  fetch       Time spent fetching the result
+ *  @param  rows        The number of rows received
+ *  @param  error       The error, or a nullptr on success
+ *  @param  explainable Can the statement be explained with these parameters
+ */
+void Statement::report(Parameter *parameters, size_t count, const InFlight &reference, uint64_t queued, uint64_t execution, uint64_t fetch, uint64_t rows, const char *error, bool explainable)
+{
+    // the types of the parameters
+    std::vector<std::string> types;
+    types.reserve(count);
+    for (size_t i = 0; i < count; ++i) types.push_back(parameters[i].type());
+
+    // report the statement, long data parameters were consumed and cannot be used to explain
+    _connection->report(reference, SlowQuery(_query, _digest, std::move(types), queued, execution, fetch, rows, error), explainable ? [this, parameters]() { return explain(parameters); } : std::function<std::string()>());
+}
+
+/**
+ *  Explain the statement with the given parameters
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ *
+ *  @param  parameters  The parameters to explain with
+ *  @return the query plan in json format, or an empty string
+ */
+std::string Statement::explain(Parameter *parameters)
+{
+    // the query plan
+    std::string plan;
+
+    // create a separate statement for the explain
+    auto *statement = mysql_stmt_init(_connection->_connection);
+    if (statement == nullptr) return plan;
+
+    // the explain has the same placeholders as the statement itself
+    auto query = "EXPLAIN FORMAT=JSON " + _query;
+
+    // prepare and execute it with the same parameters
+    if (mysql_stmt_prepare(statement, query.c_str(), query.size()) == 0 && mysql_stmt_bind_param(statement, parameters) == 0 && mysql_stmt_execute(statement) == 0)
+    {
+        // bind the plan without a buffer, so we learn its length
+        unsigned long length = 0;
+        MYSQL_BIND bind;
+        memset(&bind, 0, sizeof(bind));
+        bind.buffer_type = MYSQL_TYPE_STRING;
+        bind.length = &length;
+
+        // fetch the row, which is truncated because there is no buffer
+        auto result = mysql_stmt_bind_result(statement, &bind) ? 1 : mysql_stmt_fetch(statement);
+        if ((result == 0 || result == MYSQL_DATA_TRUNCATED) && length > 0)
+        {
+            // now fetch the plan itself
+            plan.resize(length);
+            bind.buffer = &plan[0];
+            bind.buffer_length = length;
+            if (mysql_stmt_fetch_column(statement, &bind, 0, 0)) plan.clear();
+        }
+    }
+
+    // clean up the statement
+    mysql_stmt_close(statement);
+
+    // done
+    return plan;
+}
+
+/**
+ *  Send the long data parameters to the server
+ *
+ *  @note:  This function is to be executed from
+ *          worker context only
+ *
+ *  @param  streams     The long data parameters and their index
+ *  @return did we succeed in sending all data
+ */
+bool Statement::send(const std::vector<std::pair<unsigned int, LongData>> &streams)
+{
+    // the buffer to produce the chunks in, shared by all parameters
+    std::vector<char> buffer;
+
+    // process all long data parameters
+    for (auto &stream : streams)
+    {
+        // make sure the buffer can hold a complete chunk
+        if (buffer.size() < stream.second.chunk()) buffer.resize(stream.second.chunk());
+
+        // keep sending chunks until the producer is done
+        while (auto size = stream.second.produce(buffer.data(), stream.second.chunk()))
+        {
+            // send the chunk to the server
+            if (mysql_stmt_send_long_data(_statement, stream.first, buffer.data(), size)) return false;
+        }
     }
+
+    // all data was sent
+    return true;
 }
 
 /**
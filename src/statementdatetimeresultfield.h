@@ -37,6 +37,14 @@ public:
      */
     StatementDateTimeResultField() : StatementResultField() {}
 
+    /**
+     *  The number of bytes in the value
+     */
+    virtual size_t size() const override
+    {
+        return sizeof(MYSQL_TIME);
+    }
+
     /**
      *  Cast to a number
      */
@@ -63,6 +63,14 @@ public:
         std::free(_value);
     }
 
+    /**
+     *  The number of bytes in the value
+     */
+    virtual size_t size() const override
+    {
+        return _size;
+    }
+
     /**
      *  Cast to a number
      */
@@ -38,6 +38,14 @@ public:
     StatementIntegralResultField() : StatementResultField()
     {}
 
+    /**
+     *  The number of bytes in the value
+     */
+    virtual size_t size() const override
+    {
+        return sizeof(T);
+    }
+
     /**
      *  Cast to a number
      */
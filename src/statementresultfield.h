@@ -63,6 +63,11 @@ public:
         return _null;
     }
 
+    /**
+     *  The number of bytes in the value
+     */
+    virtual size_t size() const = 0;
+
     /**
      *  Cast to a number
      */
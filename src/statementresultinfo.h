@@ -32,13 +32,30 @@ private:
      */
     std::map<std::string, size_t> _fields;
 
+    /**
+     *  The indices of the bound columns that are materialized
+     */
+    std::vector<size_t> _columns;
+
+    /**
+     *  The names of all bound columns
+     */
+    std::vector<std::string> _names;
+
+    /**
+     *  The number of bytes of field data in the last result
+     */
+    size_t _bytes = 0;
+
 public:
     /**
      *  Constructor
      *
-     *  @param  result  field result set
+     *  @param  statement   the statement to retrieve results from
+     *  @param  result      field result set
+     *  @param  projection  the columns to materialize
      */
-    StatementResultInfo(MYSQL_STMT *statement, MYSQL_RES *result) :
+    StatementResultInfo(MYSQL_STMT *statement, MYSQL_RES *result, const Projection& projection) :
         _statement(statement)
     {
         // get the number of fields in the statement
@@ -54,6 +71,23 @@ public:
             MYSQL_BIND bind;
             std::memset(&bind, 0, sizeof(bind));
 
+            // the name of the field
+            std::string name(field->name, field->name_length);
+            _names.push_back(name);
+
+            // is the caller not interested in this field?
+            if (!projection.contains(name))
+            {
+                // we bind it as a zero-length string buffer, mysql will
+                // then report the field as truncated, but never copies
+                // any of the data, and the field is never fetched
+                bind.buffer_type = MYSQL_TYPE_STRING;
+
+                // add the bound field to the list
+                _bind.push_back(bind);
+                continue;
+            }
+
             // if we are a numeric field, we should store whether we are unsigned
             if (IS_NUM(field->type)) bind.is_unsigned = field->flags & UNSIGNED_FLAG;
 
@@ -101,8 +135,9 @@ public:
                     break;
             }
 
-            // store name of the field
-            _fields[std::string(field->name, field->name_length)] = _bind.size();
+            // store name of the field and remember where to find it
+            _fields[name] = _columns.size();
+            _columns.push_back(_bind.size());
 
             // add the bound field to the list
             _bind.push_back(bind);
@@ -128,6 +163,217 @@ public:
         return _bind.size();
     }
 
+    /**
+     *  The number of bytes of field data in the last result
+     */
+    size_t bytes() const
+    {
+        return _bytes;
+    }
+
+private:
+    /**
+     *  The number of bytes of field data in a row
+     *
+     *  @param  row     the fetched row
+     */
+    static size_t bytes(const std::vector<std::unique_ptr<ResultFieldImpl>>& row)
+    {
+        // the number of bytes
+        size_t result = 0;
+
+        // add the size of all fields that hold a value
+        for (auto &field : row)
+        {
+            // skip skipped and NULL fields
+            if (field == nullptr || field->isNULL()) continue;
+
+            // add the size of the value
+            result += static_cast<StatementResultField*>(field.get())->size();
+        }
+
+        // return the total
+        return result;
+    }
+
+    /**
+     *  Create the fields for a single row and bind them to the statement
+     *
+     *  @param  row     the row to fill with fields
+     *  @param  skip    index of a bound column that should not be materialized
+     */
+    void bind(std::vector<std::unique_ptr<ResultFieldImpl>>& row, size_t skip = std::string::npos)
+    {
+        // prepare the row for data
+        row.reserve(_columns.size());
+
+        // prepare all materialized fields
+        for (auto column : _columns)
+        {
+            // the bound field
+            auto &bind = _bind[column];
+
+            // the streamed column is not materialized
+            if (column == skip)
+            {
+                row.emplace_back(nullptr);
+                continue;
+            }
+
+            // the field we are creating
+            StatementResultField *field = nullptr;
+
+            // create the field
+            switch (bind.buffer_type)
+            {
+                case MYSQL_TYPE_TINY:
+                    field = new StatementSignedCharResultField();
+                    break;
+                case MYSQL_TYPE_SHORT:
+                    if (bind.is_unsigned)   field = new StatementUnsignedShortResultField();
+                    else                    field = new StatementSignedShortResultField();
+                    break;
+                case MYSQL_TYPE_INT24:
+                case MYSQL_TYPE_LONG:
+                    if (bind.is_unsigned)   field = new StatementUnsignedLongResultField();
+                    else                    field = new StatementSignedLongResultField();
+                    break;
+                case MYSQL_TYPE_LONGLONG:
+                    if (bind.is_unsigned)   field = new StatementUnsignedLongLongResultField();
+                    else                    field = new StatementSignedLongLongResultField();
+                    break;
+                case MYSQL_TYPE_FLOAT:
+                    field = new StatementFloatResultField();
+                    break;
+                case MYSQL_TYPE_DOUBLE:
+                    field = new StatementDoubleResultField();
+                    break;
+                case MYSQL_TYPE_DECIMAL:
+                case MYSQL_TYPE_NEWDECIMAL:
+                    // yes, really, we get a char array back
+                case MYSQL_TYPE_ENUM:
+                case MYSQL_TYPE_SET:
+                case MYSQL_TYPE_GEOMETRY:
+                case MYSQL_TYPE_BIT:
+                case MYSQL_TYPE_VARCHAR:
+                case MYSQL_TYPE_VAR_STRING:
+                case MYSQL_TYPE_STRING:
+                case MYSQL_TYPE_TINY_BLOB:
+                case MYSQL_TYPE_MEDIUM_BLOB:
+                case MYSQL_TYPE_LONG_BLOB:
+                case MYSQL_TYPE_BLOB:
+                    field = new StatementDynamicResultField();
+                    break;
+                case MYSQL_TYPE_YEAR:
+                case MYSQL_TYPE_TIME:
+                case MYSQL_TYPE_DATE:
+                case MYSQL_TYPE_NEWDATE:
+                case MYSQL_TYPE_DATETIME:
+                case MYSQL_TYPE_TIMESTAMP:
+                    field = new StatementDateTimeResultField();
+                    break;
+                case MYSQL_TYPE_NULL:
+                    // field is always null, no need to do anything
+                    break;
+
+                default:
+                    // TODO: temporal fields
+                    break;
+            }
+
+            // if we have no field data, we must be an unknown field
+            // or really a NULL field. we simply add this to the list
+            if (field == nullptr)
+            {
+                row.emplace_back(nullptr);
+                continue;
+            }
+
+            // if we have a fixed-size field, we can assign the data- and null-pointer
+            if (!field->dynamic())
+            {
+                // assign the data buffer and the null pointer to the bind structure
+                bind.buffer  = field->getValue();
+                bind.is_null = field->getNULL();
+            }
+            else
+            {
+                // field is dynamic, cast to get access to properties
+                StatementDynamicResultField *dynamic = static_cast<StatementDynamicResultField*>(field);
+
+                // set the buffer to be a null pointer and give MySQL a pointer to store the length
+                bind.buffer  = nullptr;
+                bind.is_null = field->getNULL();
+                bind.length  = &dynamic->_size;
+                bind.buffer_length = 0;
+            }
+
+            // add the field
+            row.emplace_back(field);
+        }
+
+        // bind the output parameters to the statement (this has to be done every time)
+        if (mysql_stmt_bind_result(_statement, _bind.data())) throw Exception(mysql_stmt_error(_statement));
+    }
+
+    /**
+     *  Fetch the next row into previously bound fields
+     *
+     *  @param  row     the row that was bound
+     *  @return was a row fetched, false when there are no more rows
+     */
+    bool fetch(std::vector<std::unique_ptr<ResultFieldImpl>>& row)
+    {
+        // fetch the data into the buffers
+        switch (mysql_stmt_fetch(_statement))
+        {
+            case 0:
+                // fetch successful, all data loaded
+                return true;
+            case 1:
+                // something went horribly wrong
+                throw Exception(mysql_stmt_error(_statement));
+            case MYSQL_NO_DATA:
+                // there are no more rows
+                return false;
+            case MYSQL_DATA_TRUNCATED:
+                // some fields need more data, fetch it
+                // we should know the required size by now
+                for (size_t i = 0; i < _columns.size(); ++i)
+                {
+                    // get bind property and field
+                    auto &bind  = _bind[_columns[i]];
+                    auto *field = static_cast<StatementResultField*>(row[i].get());
+
+                    // skip unknown fields, fixed-size fields and NULL fields
+                    if (field == nullptr || !field->dynamic() || field->isNULL()) continue;
+
+                    // cast to a dynamic field
+                    StatementDynamicResultField *dynamic = static_cast<StatementDynamicResultField*>(field);
+
+                    // no need to allocate if it is an empty field
+                    if (!dynamic->_size) continue;
+
+                    // allocate memory and retrieve the field
+                    dynamic->_value = static_cast<char*>(std::malloc(dynamic->_size));
+
+                    // assign the buffer and indicate the size to MySQL
+                    bind.buffer = dynamic->_value;
+                    bind.buffer_length = dynamic->_size;
+
+                    // fetch the field from MySQL
+                    mysql_stmt_fetch_column(_statement, &bind, _columns[i], 0);
+                }
+
+                // done
+                return true;
+        }
+
+        // this is not reached, but keeps the compiler happy
+        return false;
+    }
+
+public:
     /**
      *  Retrieve the rows in the result
      */
@@ -136,6 +382,9 @@ public:
         // store all the rows locally
         if (mysql_stmt_store_result(_statement)) throw Exception(mysql_stmt_error(_statement));
 
+        // nothing was received yet
+        _bytes = 0;
+
         // retrieve the number of rows
         size_t count = mysql_stmt_num_rows(_statement);
 
@@ -145,153 +394,140 @@ public:
         // fetch all rows
         for (auto &row : result)
         {
-            // prepare the row for data
-            row.reserve(_bind.size());
+            // create the fields for the row
+            bind(row);
+
+            // we only fetch as many rows as were indicated to be present,
+            // so running out of rows means the result set is corrupted
+            if (!fetch(row)) throw Exception("Result set corrupted");
+
+            // count the received data
+            _bytes += bytes(row);
+        }
+
+        // all done, wrap the data in a result container
+        return std::make_shared<StatementResultImpl>(_fields, std::move(result));
+    }
+
+    /**
+     *  Find the bound index of a column
+     *
+     *  @param  name    name of the column
+     *  @return the index, or std::string::npos if there is no such column
+     */
+    size_t column(const std::string& name) const
+    {
+        // look for the column
+        for (size_t i = 0; i < _names.size(); ++i) if (_names[i] == name) return i;
+
+        // the column does not exist
+        return std::string::npos;
+    }
+
+    /**
+     *  Throw away the rows that were not fetched
+     *
+     *  When the rows are not stored locally, they keep waiting on the
+     *  connection, and every next command fails until they are gone.
+     */
+    void discard()
+    {
+        // free the rows and clear the state of the statement
+        mysql_stmt_free_result(_statement);
+        mysql_stmt_reset(_statement);
+    }
+
+    /**
+     *  Retrieve the rows in the result, while streaming one column to a sink
+     *
+     *  The rows are not stored locally first, but fetched from the server
+     *  one at a time. The streamed column is bound with a zero-length
+     *  buffer and then read in chunks with increasing offsets, so that
+     *  the value is never held in a buffer bigger than the chunk size.
+     *  In the returned rows, the streamed column is NULL.
+     *
+     *  @param  streamed    bound index of the column to stream
+     *  @param  sink        the sink to hand the chunks to
+     */
+    std::shared_ptr<StatementResultImpl> rows(size_t streamed, ColumnSink *sink)
+    {
+        // the result value with all the rows
+        std::vector<std::vector<std::unique_ptr<ResultFieldImpl>>> result;
+
+        // nothing was received yet
+        _bytes = 0;
+
+        // remember how the column is normally bound
+        MYSQL_BIND original = _bind[streamed];
+
+        // the length and null indicator of the streamed column
+        unsigned long length = 0;
+        my_bool null = false;
+
+        // bind the streamed column to a zero-length buffer
+        auto &target = _bind[streamed];
+        std::memset(&target, 0, sizeof(target));
+        target.buffer_type = MYSQL_TYPE_BLOB;
+        target.length = &length;
+        target.is_null = &null;
 
-            // prepare all fields
-            for (auto &bind : _bind)
+        // the buffer to read a chunk into, allocated only once
+        std::vector<char> buffer(std::max<size_t>(sink->chunk(), 1));
+
+        // the structure to fetch a chunk with
+        MYSQL_BIND chunk;
+        std::memset(&chunk, 0, sizeof(chunk));
+        chunk.buffer_type = MYSQL_TYPE_BLOB;
+        chunk.buffer = buffer.data();
+        chunk.buffer_length = buffer.size();
+
+        try
+        {
+            // fetch all rows
+            while (true)
             {
-                // the field we are creating
-                StatementResultField *field = nullptr;
+                // create a new row and bind the fields
+                std::vector<std::unique_ptr<ResultFieldImpl>> row;
+                bind(row, streamed);
 
-                // create the field
-                switch (bind.buffer_type)
-                {
-                    case MYSQL_TYPE_TINY:
-                        field = new StatementSignedCharResultField();
-                        break;
-                    case MYSQL_TYPE_SHORT:
-                        if (bind.is_unsigned)   field = new StatementUnsignedShortResultField();
-                        else                    field = new StatementSignedShortResultField();
-                        break;
-                    case MYSQL_TYPE_INT24:
-                    case MYSQL_TYPE_LONG:
-                        if (bind.is_unsigned)   field = new StatementUnsignedLongResultField();
-                        else                    field = new StatementSignedLongResultField();
-                        break;
-                    case MYSQL_TYPE_LONGLONG:
-                        if (bind.is_unsigned)   field = new StatementUnsignedLongLongResultField();
-                        else                    field = new StatementSignedLongLongResultField();
-                        break;
-                    case MYSQL_TYPE_FLOAT:
-                        field = new StatementFloatResultField();
-                        break;
-                    case MYSQL_TYPE_DOUBLE:
-                        field = new StatementDoubleResultField();
-                        break;
-                    case MYSQL_TYPE_DECIMAL:
-                    case MYSQL_TYPE_NEWDECIMAL:
-                        // yes, really, we get a char array back
-                    case MYSQL_TYPE_ENUM:
-                    case MYSQL_TYPE_SET:
-                    case MYSQL_TYPE_GEOMETRY:
-                    case MYSQL_TYPE_BIT:
-                    case MYSQL_TYPE_VARCHAR:
-                    case MYSQL_TYPE_VAR_STRING:
-                    case MYSQL_TYPE_STRING:
-                    case MYSQL_TYPE_TINY_BLOB:
-                    case MYSQL_TYPE_MEDIUM_BLOB:
-                    case MYSQL_TYPE_LONG_BLOB:
-                    case MYSQL_TYPE_BLOB:
-                        field = new StatementDynamicResultField();
-                        break;
-                    case MYSQL_TYPE_YEAR:
-                    case MYSQL_TYPE_TIME:
-                    case MYSQL_TYPE_DATE:
-                    case MYSQL_TYPE_NEWDATE:
-                    case MYSQL_TYPE_DATETIME:
-                    case MYSQL_TYPE_TIMESTAMP:
-                        field = new StatementDateTimeResultField();
-                        break;
-                    case MYSQL_TYPE_NULL:
-                        // field is always null, no need to do anything
-                        break;
-
-                    default:
-                        // TODO: temporal fields
-                        break;
-                }
+                // fetch the row, stop when we run out of rows
+                if (!fetch(row)) break;
 
-                // if we have no field data, we must be an unknown field
-                // or really a NULL field. we simply add this to the list
-                if (field == nullptr)
-                {
-                    row.emplace_back(nullptr);
-                    continue;
-                }
+                // did the sink get the complete value?
+                bool complete = !null;
 
-                // if we have a fixed-size field, we can assign the data- and null-pointer
-                if (!field->dynamic())
-                {
-                    // assign the data buffer and the null pointer to the bind structure
-                    bind.buffer  = field->getValue();
-                    bind.is_null = field->getNULL();
-                }
-                else
+                // pass the value of the streamed column in chunks
+                for (unsigned long offset = 0; complete && offset < length; offset += buffer.size())
                 {
-                    // field is dynamic, cast to get access to properties
-                    StatementDynamicResultField *dynamic = static_cast<StatementDynamicResultField*>(field);
+                    // fetch the chunk from mysql
+                    if (mysql_stmt_fetch_column(_statement, &chunk, streamed, offset)) throw Exception(mysql_stmt_error(_statement));
 
-                    // set the buffer to be a null pointer and give MySQL a pointer to store the length
-                    bind.buffer  = nullptr;
-                    bind.is_null = field->getNULL();
-                    bind.length  = &dynamic->_size;
-                    bind.buffer_length = 0;
+                    // give it to the sink, which may not want the rest
+                    complete = sink->data(result.size(), buffer.data(), std::min<unsigned long>(buffer.size(), length - offset));
                 }
 
-                // add the field
-                row.emplace_back(field);
-            }
+                // the value of this row is complete, unless the sink aborted it
+                if (complete) sink->end(result.size());
 
-            // bind the output parameters to the statement (this has to be done every time)
-            if (mysql_stmt_bind_result(_statement, _bind.data())) throw Exception(mysql_stmt_error(_statement));
+                // count the received data
+                _bytes += bytes(row) + (null ? 0 : length);
 
-            // fetch the data into the buffers
-            switch (mysql_stmt_fetch(_statement))
-            {
-                case 0:
-                    // fetch successful, all data loaded
-                    break;
-                case 1:
-                    // something went horribly wrong
-                    throw Exception(mysql_stmt_error(_statement));
-                case MYSQL_NO_DATA:
-                    // this is also not allowed, since we only fetch
-                    // as many rows as were indicated to be present
-                    throw Exception("Result set corrupted");
-                case MYSQL_DATA_TRUNCATED:
-                    // some fields need more data, fetch it
-                    // we should know the required size by now
-                    for (size_t i = 0; i < _bind.size(); ++i)
-                    {
-                        // get bind property and field
-                        auto &bind  = _bind[i];
-                        auto *field = static_cast<StatementResultField*>(row[i].get());
-
-                        // skip fixed-size fields and NULL fields
-                        if (!field->dynamic() || field->isNULL()) continue;
-
-                        // cast to a dynamic field
-                        StatementDynamicResultField *dynamic = static_cast<StatementDynamicResultField*>(field);
-
-                        // no need to allocate if it is an empty field
-                        if (!dynamic->_size) continue;
-
-                        // allocate memory and retrieve the field
-                        dynamic->_value = static_cast<char*>(std::malloc(dynamic->_size));
-
-                        // assign the buffer and indicate the size to MySQL
-                        bind.buffer = dynamic->_value;
-                        bind.buffer_length = dynamic->_size;
-
-                        // fetch the field from MySQL
-                        mysql_stmt_fetch_column(_statement, &bind, i, 0);
-                    }
-
-                    // done
-                    break;
+                // add the row to the result
+                result.push_back(std::move(row));
             }
         }
+        catch (...)
+        {
+            // the rows that were not fetched would block the connection
+            discard();
+
+            // restore the binding before passing on the error
+            _bind[streamed] = original;
+            throw;
+        }
+
+        // restore the binding for regular executions
+        _bind[streamed] = original;
 
         // all done, wrap the data in a result container
         return std::make_shared<StatementResultImpl>(_fields, std::move(result));
@@ -0,0 +1,188 @@
+/**
+ *  StatisticsRecorder.h
+ *
+ *  Records the statistics of a connection. Everything that happens
+ *  in the worker thread (waiting, execution, fetching and traffic)
+ *  is only ever written by the worker, and the handoff delay is only
+ *  written by the master thread. Recording is therefore just a few
+ *  relaxed loads and stores, and cheap enough to always leave on.
+ *  The per-thread values are merged when a snapshot is taken.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Statistics recorder class
+ */
+class StatisticsRecorder
+{
+private:
+    /**
+     *  Time spent waiting for the worker (written by the worker)
+     */
+    HistogramRecorder _queued;
+
+    /**
+     *  Time spent executing queries (written by the worker)
+     */
+    HistogramRecorder _execution;
+
+    /**
+     *  Time spent fetching results (written by the worker)
+     */
+    HistogramRecorder _fetch;
+
+    /**
+     *  Time spent in the master queue (written by the master)
+     */
+    HistogramRecorder _handoff;
+
+    /**
+     *  Traffic counters (written by the worker)
+     */
+    std::atomic<uint64_t> _queries;
+    std::atomic<uint64_t> _rows;
+    std::atomic<uint64_t> _bytes;
+    std::atomic<uint64_t> _errors;
+    std::atomic<uint64_t> _reconnects;
+    std::atomic<uint64_t> _retries;
+
+    /**
+     *  Increment a counter that is only written by the current thread
+     *
+     *  @param  counter     the counter to increment
+     *  @param  value       the value to add
+     */
+    static void increment(std::atomic<uint64_t> &counter, uint64_t value = 1)
+    {
+        // we are the only writer, so a plain load and store suffices
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+public:
+    /**
+     *  Constructor
+     */
+    StatisticsRecorder() : _queries(0), _rows(0), _bytes(0), _errors(0), _reconnects(0), _retries(0) {}
+
+    /**
+     *  The current time of the monotonic clock, in nanoseconds
+     */
+    static uint64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     *  The worker picked up an operation
+     *
+     *  @param  duration    the time it spent in the queue
+     */
+    void queued(uint64_t duration)
+    {
+        _queued.record(duration);
+        increment(_queries);
+    }
+
+    /**
+     *  The server finished executing an operation
+     *
+     *  @param  duration    the time the execution took
+     */
+    void executed(uint64_t duration)
+    {
+        _execution.record(duration);
+    }
+
+    /**
+     *  The result of an operation was fetched
+     *
+     *  @param  duration    the time the fetch took
+     */
+    void fetched(uint64_t duration)
+    {
+        _fetch.record(duration);
+    }
+
+    /**
+     *  A result was handed over to the master
+     *
+     *  @param  duration    the time it took to run the callback
+     */
+    void delivered(uint64_t duration)
+    {
+        _handoff.record(duration);
+    }
+
+    /**
+     *  Data was received
+     *
+     *  @param  rows        the number of rows
+     *  @param  bytes       the number of bytes of field data
+     */
+    void received(uint64_t rows, uint64_t bytes)
+    {
+        increment(_rows, rows);
+        increment(_bytes, bytes);
+    }
+
+    /**
+     *  An operation failed
+     */
+    void failed()
+    {
+        increment(_errors);
+    }
+
+    /**
+     *  The connection was reestablished
+     */
+    void reconnected()
+    {
+        increment(_reconnects);
+    }
+
+    /**
+     *  A transaction was retried
+     */
+    void retried()
+    {
+        increment(_retries);
+    }
+
+    /**
+     *  Take a snapshot of the statistics
+     */
+    Statistics snapshot() const
+    {
+        // the statistics to fill
+        Statistics result;
+
+        // copy all histograms
+        _queued.snapshot(result._queued);
+        _execution.snapshot(result._execution);
+        _fetch.snapshot(result._fetch);
+        _handoff.snapshot(result._handoff);
+
+        // and the counters
+        result._queries     = _queries.load(std::memory_order_relaxed);
+        result._rows        = _rows.load(std::memory_order_relaxed);
+        result._bytes       = _bytes.load(std::memory_order_relaxed);
+        result._errors      = _errors.load(std::memory_order_relaxed);
+        result._reconnects  = _reconnects.load(std::memory_order_relaxed);
+        result._retries     = _retries.load(std::memory_order_relaxed);
+
+        // return the snapshot
+        return result;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,216 @@
+/**
+ *  StreamedResultImpl.h
+ *
+ *  Result implementation for rows that were read one by one from an
+ *  unbuffered result. Every row owns a copy of its data, since the
+ *  mysql library reuses its buffer for the next row. The rows are
+ *  shared, so a result can be assembled from the rows of others
+ *  without copying them again.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  A single streamed row
+ */
+class StreamedRow
+{
+private:
+    /**
+     *  The data of all fields, each of them terminated by a null byte
+     */
+    std::unique_ptr<char[]> _data;
+
+    /**
+     *  The start of every field, or a nullptr for NULL fields
+     */
+    std::vector<const char*> _values;
+
+    /**
+     *  The length of every field
+     */
+    std::vector<size_t> _lengths;
+
+    /**
+     *  The fields
+     */
+    std::vector<std::unique_ptr<ResultFieldImpl>> _fields;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  values      the values of the fields, nullptr for NULL
+     *  @param  lengths     the lengths of the values
+     *  @param  count       the number of fields
+     */
+    StreamedRow(const char * const *values, const unsigned long *lengths, size_t count) :
+        _values(count),
+        _lengths(lengths, lengths + count)
+    {
+        // the space we need for all fields and their terminators
+        size_t size = std::accumulate(_lengths.begin(), _lengths.end(), count);
+
+        // copy the data in one buffer
+        _data.reset(new char[size]);
+        char *position = _data.get();
+
+        // reserve space for the fields
+        _fields.reserve(count);
+
+        // process all fields
+        for (size_t i = 0; i < count; ++i)
+        {
+            // NULL fields have no data
+            if (values[i])
+            {
+                // copy the value, and terminate it like the mysql library does
+                memcpy(position, values[i], _lengths[i]);
+                position[_lengths[i]] = '\0';
+
+                // this is where the field starts
+                _values[i] = position;
+                position += _lengths[i] + 1;
+            }
+
+            // create field implementation
+            _fields.emplace_back(new QueryResultField(_values[i], _lengths[i]));
+        }
+    }
+
+    /**
+     *  The value of a field, or a nullptr if it is NULL
+     *
+     *  @param  index       index of the field
+     */
+    const char *value(size_t index) const { return _values[index]; }
+
+    /**
+     *  The length of a field
+     *
+     *  @param  index       index of the field
+     */
+    size_t length(size_t index) const { return _lengths[index]; }
+
+    /**
+     *  The number of fields
+     */
+    size_t size() const { return _values.size(); }
+
+    /**
+     *  The fields
+     */
+    const std::vector<std::unique_ptr<ResultFieldImpl>>& fields() const { return _fields; }
+};
+
+/**
+ *  Streamed result class
+ */
+class StreamedResultImpl : public ResultImpl
+{
+private:
+    /**
+     *  Field info, shared by all results of the same query
+     */
+    std::shared_ptr<const std::map<std::string, size_t>> _fields;
+
+    /**
+     *  Which fields hold numbers, by index, shared in the same way
+     */
+    std::shared_ptr<const std::vector<bool>> _numeric;
+
+    /**
+     *  The rows
+     */
+    std::vector<std::shared_ptr<StreamedRow>> _rows;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  fields      the fields and their index
+     *  @param  numeric     which fields hold numbers, if known
+     */
+    StreamedResultImpl(std::shared_ptr<const std::map<std::string, size_t>> fields, std::shared_ptr<const std::vector<bool>> numeric = nullptr) :
+        _fields(std::move(fields)),
+        _numeric(std::move(numeric)) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~StreamedResultImpl() {}
+
+    /**
+     *  Add a row
+     *
+     *  @param  row         the row to add
+     */
+    void add(std::shared_ptr<StreamedRow> row)
+    {
+        _rows.push_back(std::move(row));
+    }
+
+    /**
+     *  Retrieve a row
+     *
+     *  @param  index       index of the row
+     */
+    const std::shared_ptr<StreamedRow>& row(size_t index) const
+    {
+        return _rows[index];
+    }
+
+    /**
+     *  The fields and their index, as shared by all results of the query
+     */
+    const std::shared_ptr<const std::map<std::string, size_t>>& shared() const
+    {
+        return _fields;
+    }
+
+    /**
+     *  Which fields hold numbers, as shared by all results of the query
+     */
+    const std::shared_ptr<const std::vector<bool>>& numeric() const
+    {
+        return _numeric;
+    }
+
+    /**
+     *  Get the fields and their index
+     */
+    const std::map<std::string, size_t>& fields() const override
+    {
+        return *_fields;
+    }
+
+    /**
+     *  Get the number of rows in this result set
+     */
+    size_t size() const override
+    {
+        return _rows.size();
+    }
+
+    /**
+     *  Retrieve row at the given index
+     */
+    const std::vector<std::unique_ptr<ResultFieldImpl>>& fetch(size_t index) override
+    {
+        // check whether the index is valid
+        if (index >= size()) throw Exception("Invalid result offset");
+
+        // return the fields of the row
+        return _rows[index]->fields();
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
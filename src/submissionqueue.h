@@ -0,0 +1,225 @@
+/**
+ *  SubmissionQueue.h
+ *
+ *  The worker thread of a connection, with the queue that feeds it.
+ *  Tasks are moved into the preallocated slots of a lock-free queue,
+ *  and the worker runs all waiting tasks every time it wakes up. The
+ *  worker is only woken up when it is actually sleeping, so a busy
+ *  worker costs the submitter no system calls at all. When the queue
+ *  is full, tasks go to a locked overflow list instead, so that the
+ *  event loop never has to wait for the worker.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Submission queue class
+ */
+class SubmissionQueue
+{
+private:
+    /**
+     *  The waiting tasks
+     */
+    LockFreeQueue<Task> _tasks;
+
+    /**
+     *  Lock for the overflow list, and for sleeping
+     */
+    std::mutex _mutex;
+
+    /**
+     *  The tasks that did not fit in the queue, these are
+     *  always newer than the tasks in the queue
+     */
+    std::deque<Task> _overflow;
+
+    /**
+     *  Are there tasks in the overflow list?
+     */
+    std::atomic<bool> _overflowing;
+
+    /**
+     *  Condition to wake up the worker
+     */
+    std::condition_variable _condition;
+
+    /**
+     *  Is the worker sleeping?
+     */
+    std::atomic<bool> _sleeping;
+
+    /**
+     *  Should the worker stop?
+     */
+    std::atomic<bool> _stop;
+
+    /**
+     *  The number of tasks submitted (by the master) and completed (by the worker)
+     */
+    std::atomic<size_t> _submitted;
+    std::atomic<size_t> _completed;
+
+    /**
+     *  The worker thread
+     */
+    std::thread _thread;
+
+    /**
+     *  Are there tasks waiting?
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     */
+    bool pending() const
+    {
+        return !_tasks.empty() || _overflowing.load(std::memory_order_acquire);
+    }
+
+    /**
+     *  Run a single task
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     *
+     *  @param  task        the task to run
+     */
+    void perform(Task &task)
+    {
+        // run it
+        task();
+
+        // we are the only writer, so a plain load and store suffices
+        _completed.store(_completed.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     *  Run the worker thread
+     */
+    void run()
+    {
+        // the task to run
+        Task task;
+
+        // keep running tasks
+        while (true)
+        {
+            // run all tasks in the queue
+            while (_tasks.pop(task)) perform(task);
+
+            // are there tasks in the overflow list?
+            if (_overflowing.load(std::memory_order_acquire))
+            {
+                // take the tasks from the list
+                std::deque<Task> overflow;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    overflow.swap(_overflow);
+                    _overflowing.store(false, std::memory_order_release);
+                }
+
+                // run them, and check the queue again
+                for (auto &task : overflow) perform(task);
+                continue;
+            }
+
+            // lock to go to sleep
+            std::unique_lock<std::mutex> lock(_mutex);
+
+            // tell the submitters to wake us up, before checking one last time
+            _sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // we stop when all tasks are done
+            if (_stop.load(std::memory_order_relaxed) && !pending()) return;
+
+            // wait for new tasks
+            _condition.wait(lock, [this]() { return pending() || _stop.load(std::memory_order_relaxed); });
+            _sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  capacity    the number of preallocated task slots
+     */
+    SubmissionQueue(size_t capacity = 256) :
+        _tasks(capacity),
+        _overflowing(false),
+        _sleeping(false),
+        _stop(false),
+        _submitted(0),
+        _completed(0),
+        _thread(&SubmissionQueue::run, this) {}
+
+    /**
+     *  Destructor
+     *
+     *  The tasks that are still waiting are run before the thread stops.
+     */
+    ~SubmissionQueue()
+    {
+        // tell the worker to stop
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop.store(true, std::memory_order_relaxed);
+        }
+
+        // wake it up, and wait for it
+        _condition.notify_one();
+        _thread.join();
+    }
+
+    /**
+     *  Run a task in the worker thread
+     *
+     *  @param  callable    the callable to run
+     */
+    template <typename F>
+    void execute(F&& callable)
+    {
+        // move the callable into a task
+        Task task(std::forward<F>(callable));
+
+        // count it
+        _submitted.fetch_add(1, std::memory_order_relaxed);
+
+        // add it to the queue, or to the overflow list if the queue is full
+        // or if older tasks are already waiting in the overflow list
+        if (_overflowing.load(std::memory_order_acquire) || !_tasks.push(std::move(task)))
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _overflow.push_back(std::move(task));
+            _overflowing.store(true, std::memory_order_release);
+        }
+
+        // is the worker sleeping? the fence makes sure it either sees
+        // our task before it goes to sleep, or we see that it sleeps
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!_sleeping.load(std::memory_order_relaxed)) return;
+
+        // wake it up
+        std::lock_guard<std::mutex> lock(_mutex);
+        _condition.notify_one();
+    }
+
+    /**
+     *  The number of tasks that are waiting or running
+     */
+    size_t size() const
+    {
+        return _submitted.load(std::memory_order_relaxed) - _completed.load(std::memory_order_acquire);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
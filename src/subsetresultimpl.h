@@ -0,0 +1,74 @@
+/**
+ *  SubsetResultImpl.h
+ *
+ *  A selection of the rows of another result. The rows are not copied,
+ *  the result they come from is shared.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Subset result class
+ */
+class SubsetResultImpl : public ResultImpl
+{
+private:
+    /**
+     *  The result the rows come from
+     */
+    std::shared_ptr<ResultImpl> _result;
+
+    /**
+     *  The index of the selected rows in that result
+     */
+    std::vector<size_t> _rows;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  result      the result the rows come from
+     *  @param  rows        the index of the selected rows
+     */
+    SubsetResultImpl(std::shared_ptr<ResultImpl> result, std::vector<size_t> rows) :
+        _result(std::move(result)),
+        _rows(std::move(rows)) {}
+
+    /**
+     *  Get the fields and their index
+     */
+    const std::map<std::string, size_t>& fields() const override
+    {
+        return _result->fields();
+    }
+
+    /**
+     *  Get the number of rows in this result set
+     */
+    size_t size() const override
+    {
+        return _rows.size();
+    }
+
+    /**
+     *  Retrieve row at the given index
+     */
+    const std::vector<std::unique_ptr<ResultFieldImpl>>& fetch(size_t index) override
+    {
+        // check whether the row exists
+        if (index >= size()) throw Exception("Invalid result offset");
+
+        // retrieve it from the result it comes from
+        return _result->fetch(_rows[index]);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
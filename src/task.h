@@ -0,0 +1,181 @@
+/**
+ *  Task.h
+ *
+ *  A callable without arguments, like std::function<void()>, but with
+ *  room for the captures of a typical lambda inside the object itself.
+ *  Moving a task into a preallocated slot therefore does not allocate.
+ *  Only callables that do not fit are stored on the heap.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Task class
+ */
+class Task
+{
+private:
+    /**
+     *  The room for the callable
+     */
+    static const size_t capacity = 192;
+
+    /**
+     *  The storage for the callable, or for a pointer to it
+     */
+    typename std::aligned_storage<capacity, alignof(std::max_align_t)>::type _storage;
+
+    /**
+     *  The operations on the stored callable
+     */
+    struct Operations
+    {
+        void (*invoke)(void *storage);
+        void (*relocate)(void *from, void *to);
+        void (*destroy)(void *storage);
+    };
+
+    /**
+     *  The operations for the stored callable, or a nullptr when empty
+     */
+    const Operations *_operations = nullptr;
+
+    /**
+     *  The operations for a callable stored inside the task
+     */
+    template <typename F>
+    struct Inline
+    {
+        static void invoke(void *storage) { (*static_cast<F*>(storage))(); }
+        static void relocate(void *from, void *to) { new (to) F(std::move(*static_cast<F*>(from))); static_cast<F*>(from)->~F(); }
+        static void destroy(void *storage) { static_cast<F*>(storage)->~F(); }
+        static const Operations *operations() { static const Operations result{ &invoke, &relocate, &destroy }; return &result; }
+    };
+
+    /**
+     *  The operations for a callable stored on the heap
+     */
+    template <typename F>
+    struct Heap
+    {
+        static void invoke(void *storage) { (**static_cast<F**>(storage))(); }
+        static void relocate(void *from, void *to) { *static_cast<F**>(to) = *static_cast<F**>(from); }
+        static void destroy(void *storage) { delete *static_cast<F**>(storage); }
+        static const Operations *operations() { static const Operations result{ &invoke, &relocate, &destroy }; return &result; }
+    };
+
+    /**
+     *  Store a callable that fits inside the task
+     *
+     *  @param  callable    the callable to store
+     */
+    template <typename F>
+    void store(F&& callable, std::true_type)
+    {
+        typedef typename std::decay<F>::type Type;
+        new (&_storage) Type(std::forward<F>(callable));
+        _operations = Inline<Type>::operations();
+    }
+
+    /**
+     *  Store a callable that does not fit inside the task
+     *
+     *  @param  callable    the callable to store
+     */
+    template <typename F>
+    void store(F&& callable, std::false_type)
+    {
+        typedef typename std::decay<F>::type Type;
+        *reinterpret_cast<Type**>(&_storage) = new Type(std::forward<F>(callable));
+        _operations = Heap<Type>::operations();
+    }
+
+public:
+    /**
+     *  Constructor for an empty task
+     */
+    Task() {}
+
+    /**
+     *  Constructor
+     *
+     *  @param  callable    the callable to run
+     */
+    template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& callable)
+    {
+        // check whether the callable fits
+        typedef typename std::decay<F>::type Type;
+        store(std::forward<F>(callable), std::integral_constant<bool, sizeof(Type) <= capacity && alignof(Type) <= alignof(std::max_align_t)>());
+    }
+
+    /**
+     *  Move constructor
+     *
+     *  @param  that        the task to move
+     */
+    Task(Task&& that) : _operations(that._operations)
+    {
+        // move the callable over
+        if (_operations) _operations->relocate(&that._storage, &_storage);
+        that._operations = nullptr;
+    }
+
+    /**
+     *  Tasks cannot be copied
+     */
+    Task(const Task& that) = delete;
+
+    /**
+     *  Destructor
+     */
+    ~Task()
+    {
+        if (_operations) _operations->destroy(&_storage);
+    }
+
+    /**
+     *  Move assignment
+     *
+     *  @param  that        the task to move
+     */
+    Task& operator=(Task&& that)
+    {
+        // check for self assignment
+        if (this == &that) return *this;
+
+        // destroy our own callable
+        if (_operations) _operations->destroy(&_storage);
+
+        // move the other callable over
+        _operations = that._operations;
+        if (_operations) _operations->relocate(&that._storage, &_storage);
+        that._operations = nullptr;
+
+        // allow chaining
+        return *this;
+    }
+
+    /**
+     *  Run the task, and destroy the callable
+     */
+    void operator()()
+    {
+        // run the callable
+        _operations->invoke(&_storage);
+
+        // the callable is no longer needed, release what it captured
+        _operations->destroy(&_storage);
+        _operations = nullptr;
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,119 @@
+/**
+ *  Throttle.h
+ *
+ *  Limits the number of batches of rows that a worker streams to the
+ *  master thread before the master is done with them. The worker waits
+ *  on a condition variable until the master releases a batch, or until
+ *  the stream is stopped, so a worker that is ahead sleeps instead of
+ *  polling.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Throttle class
+ */
+class Throttle
+{
+private:
+    /**
+     *  Lock for the counter, and for sleeping
+     */
+    std::mutex _mutex;
+
+    /**
+     *  Condition to wake up the worker
+     */
+    std::condition_variable _condition;
+
+    /**
+     *  The number of batches the master is not done with
+     */
+    size_t _pending;
+
+    /**
+     *  The number of batches that can be pending
+     */
+    size_t _backlog;
+
+    /**
+     *  Should the worker stop reading rows?
+     */
+    std::atomic<bool> _stopped;
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  backlog     the number of batches that can be pending
+     */
+    Throttle(size_t backlog) : _pending(0), _backlog(backlog), _stopped(false) {}
+
+    /**
+     *  Count a batch that is passed to the master, after waiting until
+     *  there is room for it, or until the stream is stopped
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     */
+    void acquire()
+    {
+        // wait for room, the master or a stop wakes us up
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _pending < _backlog || _stopped.load(std::memory_order_relaxed); });
+
+        // count the batch
+        ++_pending;
+    }
+
+    /**
+     *  The master is done with a batch
+     *
+     *  @note:  This function is to be executed from
+     *          master context only
+     */
+    void release()
+    {
+        // uncount the batch
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_pending;
+        }
+
+        // the worker may be waiting for room
+        _condition.notify_one();
+    }
+
+    /**
+     *  Stop the stream, the worker no longer waits and reads no more rows
+     */
+    void stop()
+    {
+        // raise the flag under the lock, so a worker that is about to sleep sees it
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopped.store(true, std::memory_order_relaxed);
+        }
+
+        // wake up the worker
+        _condition.notify_one();
+    }
+
+    /**
+     *  Was the stream stopped?
+     */
+    bool stopped() const
+    {
+        return _stopped.load(std::memory_order_relaxed);
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,260 @@
+/**
+ *  Tracer.h
+ *
+ *  Collects trace spans for the queries on a connection. The master
+ *  and worker thread each append the phases they see to their own
+ *  lock-free ring buffer, and a background thread drains the buffers,
+ *  joins the phases into spans and writes them to a file. When the
+ *  buffers are full, phases are dropped rather than slowing down the
+ *  queries.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Tracer class
+ */
+class Tracer
+{
+public:
+    /**
+     *  The phases of a query
+     */
+    enum Phase : uint8_t
+    {
+        enqueue,
+        start,
+        execute,
+        fetch,
+        deliver
+    };
+
+private:
+    /**
+     *  A single phase of a query
+     */
+    struct Event
+    {
+        uint64_t query;
+        uint64_t trace;
+        uint64_t time;
+        Phase phase;
+    };
+
+    /**
+     *  A complete span, this is also the binary format
+     */
+    struct Span
+    {
+        uint64_t trace;
+        uint64_t connection;
+        uint64_t query;
+        uint64_t enqueue;
+        uint64_t start;
+        uint64_t execute;
+        uint64_t fetch;
+        uint64_t deliver;
+    };
+
+    /**
+     *  The phases seen by the master and the worker
+     */
+    RingBuffer<Event> _master;
+    RingBuffer<Event> _worker;
+
+    /**
+     *  The spans that were not delivered yet, by query id
+     */
+    std::map<uint64_t, Span> _pending;
+
+    /**
+     *  The maximum number of pending spans
+     */
+    size_t _capacity;
+
+    /**
+     *  The connection id
+     */
+    uint64_t _connection;
+
+    /**
+     *  The difference between the steady clock and the wall clock
+     */
+    uint64_t _offset;
+
+    /**
+     *  The file to write to, and its format
+     */
+    FILE *_file;
+    TraceFormat _format;
+
+    /**
+     *  Should the thread stop?
+     */
+    std::atomic<bool> _stop;
+
+    /**
+     *  The thread draining the buffers
+     */
+    std::thread _thread;
+
+    /**
+     *  Write a span to the file
+     *
+     *  @param  span        the span to write
+     */
+    void write(const Span &span)
+    {
+        // binary spans are written as they are
+        if (_format == TraceFormat::binary) { fwrite(&span, sizeof(span), 1, _file); return; }
+
+        // write the span as a json object
+        fprintf(_file, "{\"trace\":%" PRIu64 ",\"connection\":%" PRIu64 ",\"query\":%" PRIu64 ",\"enqueue\":%" PRIu64 ",\"start\":%" PRIu64 ",\"execute\":%" PRIu64 ",\"fetch\":%" PRIu64 ",\"deliver\":%" PRIu64 "}\n",
+            span.trace, span.connection, span.query, span.enqueue, span.start, span.execute, span.fetch, span.deliver);
+    }
+
+    /**
+     *  Drain the buffers and write the delivered spans
+     */
+    void drain()
+    {
+        // the queries that were delivered
+        std::vector<uint64_t> delivered;
+
+        // the event we are processing
+        Event event;
+
+        // the master buffer is drained first: when a delivery is seen, the
+        // worker already added its phases, so we will find them below
+        while (_master.pop(event))
+        {
+            // find the span, later deliveries for the same query are ignored
+            auto iter = _pending.find(event.query);
+            if (event.phase == deliver && (iter == _pending.end() || iter->second.deliver)) continue;
+
+            // create the span if it does not exist yet
+            if (iter == _pending.end()) iter = _pending.emplace(event.query, Span{0, _connection, event.query, 0, 0, 0, 0, 0}).first;
+
+            // store the phase
+            if (event.phase == enqueue) iter->second.enqueue = event.time + _offset;
+            else
+            {
+                iter->second.deliver = event.time + _offset;
+                iter->second.trace = event.trace;
+                delivered.push_back(event.query);
+            }
+        }
+
+        // and now the worker buffer
+        while (_worker.pop(event))
+        {
+            // find or create the span
+            auto iter = _pending.find(event.query);
+            if (iter == _pending.end()) iter = _pending.emplace(event.query, Span{0, _connection, event.query, 0, 0, 0, 0, 0}).first;
+
+            // store the phase
+            switch (event.phase)
+            {
+            case start:     iter->second.start = event.time + _offset; break;
+            case execute:   iter->second.execute = event.time + _offset; break;
+            case fetch:     iter->second.fetch = event.time + _offset; break;
+            default:        break;
+            }
+        }
+
+        // write the delivered spans
+        for (auto query : delivered)
+        {
+            // find the span
+            auto iter = _pending.find(query);
+            if (iter == _pending.end()) continue;
+
+            // write and forget it
+            write(iter->second);
+            _pending.erase(iter);
+        }
+
+        // spans that are never delivered (queries without callbacks) should not pile up
+        while (_pending.size() > _capacity) _pending.erase(_pending.begin());
+
+        // make the spans available to readers
+        if (!delivered.empty()) fflush(_file);
+    }
+
+    /**
+     *  Run the thread
+     */
+    void run()
+    {
+        // drain the buffers until we are stopped
+        while (!_stop.load(std::memory_order_acquire))
+        {
+            drain();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        // and once more, for the final phases
+        drain();
+    }
+
+public:
+    /**
+     *  Constructor
+     *
+     *  @param  connection  the connection id
+     *  @param  file        the file to write to
+     *  @param  format      the format to write in
+     *  @param  capacity    the capacity of the buffers
+     */
+    Tracer(uint64_t connection, FILE *file, TraceFormat format, size_t capacity) :
+        _master(capacity),
+        _worker(capacity),
+        _capacity(capacity),
+        _connection(connection),
+        _offset(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() - StatisticsRecorder::now()),
+        _file(file),
+        _format(format),
+        _stop(false),
+        _thread(&Tracer::run, this) {}
+
+    /**
+     *  Destructor
+     */
+    ~Tracer()
+    {
+        // stop the thread
+        _stop.store(true, std::memory_order_release);
+        _thread.join();
+
+        // close the file
+        fclose(_file);
+    }
+
+    /**
+     *  Record a phase of a query
+     *
+     *  The enqueue and deliver phases must be recorded from the
+     *  master thread, all other phases from the worker thread.
+     *
+     *  @param  query       the query id
+     *  @param  phase       the phase of the query
+     *  @param  time        the moment, as returned by StatisticsRecorder::now()
+     *  @param  trace       the trace id, for the deliver phase
+     */
+    void record(uint64_t query, Phase phase, uint64_t time, uint64_t trace = 0)
+    {
+        // add it to the buffer of the thread, drop it if the buffer is full
+        auto &buffer = phase == enqueue || phase == deliver ? _master : _worker;
+        buffer.push(Event{query, trace, time, phase});
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
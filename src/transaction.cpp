@@ -0,0 +1,138 @@
+/**
+ *  Transaction.cpp
+ *
+ *  Class for running a number of statements in a transaction
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+#include "includes.h"
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Start a transaction
+ *
+ *  @param  connection  the connection to run the transaction on
+ */
+Transaction::Transaction(Connection *connection) :
+    _connection(connection),
+    _work(new TransactionWork())
+{}
+
+/**
+ *  Destructor
+ */
+Transaction::~Transaction()
+{
+    // roll back if the transaction was not finished
+    if (_work) finish(false);
+}
+
+/**
+ *  Add a query to the transaction
+ *
+ *  @param  query       the query to execute
+ *  @throws Exception   when the transaction was already finished
+ */
+Deferred& Transaction::query(std::string query)
+{
+    // the transaction must still be open
+    if (!_work) throw Exception("Transaction already finished");
+
+    // the first query starts the transaction on the server, unless the queries are sent at once
+    if (!_session && _work->statements.empty() && !_connection->_group && _work->policy.attempts() == 0) _session = _connection->begin();
+
+    // run the query in the transaction on the server
+    if (_session) return _connection->interact(_session, std::move(query));
+
+    // or add the query, with a new deferred handler
+    _work->statements.emplace_back(std::move(query), _connection->allocate());
+
+    // return the deferred handler
+    return *_work->statements.back().deferred;
+}
+
+/**
+ *  Retry the transaction when it fails because of lock contention
+ *
+ *  @param  policy      the retry policy
+ *  @throws Exception   when the transaction was already finished
+ */
+Transaction& Transaction::retry(const RetryPolicy& policy)
+{
+    // the transaction must still be open, and the queries should not be sent yet
+    if (!_work) throw Exception("Transaction already finished");
+    if (_session) throw Exception("Retry policy set after the first query");
+
+    // store the policy
+    _work->policy = policy;
+    return *this;
+}
+
+/**
+ *  Commit the transaction
+ *
+ *  @throws Exception   when the transaction was already finished
+ */
+Deferred& Transaction::commit()
+{
+    // the transaction must still be open
+    if (!_work) throw Exception("Transaction already finished");
+
+    // hand it over
+    return finish(true);
+}
+
+/**
+ *  Roll back the transaction
+ *
+ *  @throws Exception   when the transaction was already finished
+ */
+Deferred& Transaction::rollback()
+{
+    // the transaction must still be open
+    if (!_work) throw Exception("Transaction already finished");
+
+    // hand it over
+    return finish(false);
+}
+
+/**
+ *  Hand the transaction to the connection
+ *
+ *  @param  commit      should the transaction be committed?
+ */
+Deferred& Transaction::finish(bool commit)
+{
+    // a transaction on the server is finished there
+    if (_session)
+    {
+        auto &deferred = _connection->conclude(_session, commit);
+        _session.reset();
+        _work.reset();
+        return deferred;
+    }
+
+    // the deferred handler for the outcome
+    auto deferred = _connection->allocate();
+
+    // complete the work
+    _work->deferred = deferred;
+    _work->commit = commit;
+
+    // the connection takes it from here
+    _connection->commit(std::move(*_work));
+    _work.reset();
+
+    // return the deferred handler
+    return *deferred;
+}
+
+/**
+ *  End namespace
+ */
+}}
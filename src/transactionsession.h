@@ -0,0 +1,132 @@
+/**
+ *  TransactionSession.h
+ *
+ *  A transaction that runs its statements as they are added. While it
+ *  is open, the worker of the connection is pinned to it: it runs the
+ *  statements of the transaction as they come in, and nothing else, so
+ *  no other queries on the connection can end up in the transaction.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Transaction session class
+ */
+class TransactionSession
+{
+private:
+    /**
+     *  Lock for the waiting tasks, and for sleeping
+     */
+    std::mutex _mutex;
+
+    /**
+     *  Condition to wake up the worker
+     */
+    std::condition_variable _condition;
+
+    /**
+     *  The tasks waiting for the worker
+     */
+    std::deque<Task> _tasks;
+
+    /**
+     *  Were all tasks added?
+     */
+    bool _closed = false;
+
+public:
+    /**
+     *  The error that doomed the transaction, after which nothing is run anymore
+     *
+     *  @note:  This member is only accessed from worker context
+     */
+    std::string error;
+
+    /**
+     *  The number of rows affected by all statements
+     *
+     *  @note:  This member is only accessed from worker context
+     */
+    size_t affectedRows = 0;
+
+    /**
+     *  Was the transaction committed or rolled back?
+     *
+     *  @note:  This member is only accessed from worker context
+     */
+    bool finished = false;
+
+    /**
+     *  Add a task for the worker
+     *
+     *  @param  task        the task to run
+     */
+    void execute(Task&& task)
+    {
+        // add it to the tasks
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+
+        // the worker may be waiting for it
+        _condition.notify_one();
+    }
+
+    /**
+     *  No more tasks are added, the worker runs the waiting tasks and is released
+     */
+    void close()
+    {
+        // mark it under the lock, so a worker that is about to sleep sees it
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+
+        // wake up the worker
+        _condition.notify_one();
+    }
+
+    /**
+     *  Run the tasks as they come in, until the session is closed
+     *
+     *  @note:  This function is to be executed from
+     *          worker context only
+     */
+    void run()
+    {
+        while (true)
+        {
+            // the next task to run
+            Task task;
+
+            // wait for it, or for the session to be closed
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() { return !_tasks.empty() || _closed; });
+
+                // are we done?
+                if (_tasks.empty()) return;
+
+                // take the task
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+
+            // run it
+            task();
+        }
+    }
+};
+
+/**
+ *  End namespace
+ */
+}}
@@ -0,0 +1,102 @@
+/**
+ *  TransactionWork.h
+ *
+ *  The statements of a transaction, as they are handed to the worker
+ *  to be executed in one go, and the outcome that is handed back.
+ *
+ *  @copyright 2014 Copernica BV
+ */
+
+/**
+ *  Set up namespace
+ */
+namespace React { namespace MySQL {
+
+/**
+ *  Transaction work class
+ */
+class TransactionWork
+{
+public:
+    /**
+     *  A statement in the transaction
+     */
+    struct Entry
+    {
+        /**
+         *  The query to execute
+         */
+        std::string query;
+
+        /**
+         *  The deferred handler to report to
+         */
+        std::shared_ptr<Deferred> deferred;
+
+        /**
+         *  The result sets produced by the query
+         */
+        std::vector<Result> results;
+
+        /**
+         *  Constructor
+         *
+         *  @param  query       the query to execute
+         *  @param  deferred    the deferred handler to report to
+         */
+        Entry(std::string&& query, std::shared_ptr<Deferred>&& deferred) :
+            query(std::move(query)), deferred(std::move(deferred)) {}
+    };
+
+    /**
+     *  The statements, in order
+     */
+    std::vector<Entry> statements;
+
+    /**
+     *  The deferred handler for the commit or rollback
+     */
+    std::shared_ptr<Deferred> deferred;
+
+    /**
+     *  Should the transaction be committed, or rolled back?
+     */
+    bool commit = false;
+
+    /**
+     *  When to retry the transaction, and the number of retries done
+     */
+    RetryPolicy policy;
+    size_t retries = 0;
+
+    /**
+     *  Did the transaction fail on its own, and does it wait to be run
+     *  again, after the server transaction it was in is committed?
+     */
+    bool waiting = false;
+
+    /**
+     *  Was the transaction committed?
+     */
+    bool committed = false;
+
+    /**
+     *  The number of rows affected by all statements
+     */
+    size_t affectedRows = 0;
+
+    /**
+     *  The GTIDs of the committed transaction, if tracked
+     */
+    std::string gtids;
+
+    /**
+     *  The error that caused the transaction to be rolled back
+     */
+    std::string error;
+};
+
+/**
+ *  End namespace
+ */
+}}